@@ -0,0 +1,272 @@
+﻿#include "Handlers.h"
+#include "LoggingModule.h"
+#include "RequestParsing.h"
+
+#include <charconv>
+
+void printConnectionInfo(tcp::socket& socket) {
+    beast::error_code ec;
+    tcp::endpoint remote_ep = socket.remote_endpoint(ec);
+    if (ec) {
+        Log::warning("Error getting connection info", { {"error", ec.message()} });
+        return;
+    }
+    Log::info("Client connected", { {"ip", remote_ep.address().to_string()}, {"port", remote_ep.port()} });
+}
+
+// Исключение обработчика — 500 с текстом ошибки, а не обрыв потока, на котором он выполнялся
+static void runGuarded(const RequestHandler::RouteHandler& handler, const sRequest& req, sResponce& res) {
+    try {
+        handler(req, res);
+    }
+    catch (const std::exception& e) {
+        res.result(http::status::internal_server_error);
+        res.set(http::field::content_type, "text/plain");
+        res.body() = e.what();
+    }
+}
+
+RequestHandler::AsyncRouteHandler offloadToDatabase(DatabaseModule* dbModule, RequestHandler::RouteHandler handler) {
+    return [dbModule, handler = std::move(handler)](const sRequest& req, sResponce& res, RequestHandler::ResponseCompletion done) {
+        dbModule->post([&req, &res, handler, done = std::move(done)]() {
+            runGuarded(handler, req, res);
+            done();
+            });
+        };
+}
+
+// GET отвечает из EntityStore сразу на I/O-потоке, остальные методы уходят в writer (поток БД)
+static RequestHandler::AsyncRouteHandler readFromMemory(RequestHandler::RouteHandler reader, RequestHandler::AsyncRouteHandler writer) {
+    return [reader = std::move(reader), writer = std::move(writer)](const sRequest& req, sResponce& res, RequestHandler::ResponseCompletion done) {
+        if (req.method() == http::verb::get) {
+            runGuarded(reader, req, res);  // FIXED: исключение на I/O-потоке уходило в ioc.run()
+            return done();
+        }
+        writer(req, res, std::move(done));
+        };
+}
+
+static void addMemoryReadRoute(RequestHandler* module, const std::string& regexPattern, RequestHandler::RouteHandler reader) {
+    module->addDynamicRouteHandler(regexPattern, [reader = std::move(reader)](const sRequest& req, sResponce& res) {
+        if (req.method() == http::verb::get) {
+            runGuarded(reader, req, res);
+        }
+        else {
+            res.result(http::status::method_not_allowed);
+        }
+        });
+}
+
+void CreateAPIHandlers(RequestHandler* module, ApiProcessor* apiProcessor, DatabaseModule* dbModule, RequestCoalescer* coalescer) {
+    // Основной эндпоинт — возвращает все данные для фронтенда
+    // NEW: одновременные одинаковые запросы ждут один проход по БД (девять запросов) и делят его ответ
+    auto allDataFromDatabase = coalescer->wrap(offloadToDatabase(dbModule, [apiProcessor](const sRequest& req, sResponce& res) {
+        if (req.method() != http::verb::get) {
+            res.result(http::status::method_not_allowed);
+            res.set(http::field::content_type, "text/plain");
+            res.body() = "Method Not Allowed. Use GET.";
+            return;
+        }
+        // Реплика загружена, но тело устарело: перерисовать его здесь, на потоке БД, — дешевле девяти SQL
+        if (apiProcessor->serveAllDataFromMemory(req, res, true)) return;
+        apiProcessor->handleGetAllData(req, res);
+        }));
+    // NEW: из памяти, пока EntityStore загружен и тело актуально; устаревшее тело перерисовывается на потоке БД,
+    // до загрузки и после сброса — SQL там же. Одновременные такие запросы объединяет coalescer
+    module->addAsyncRouteHandler("/api/all-data", [apiProcessor, allDataFromDatabase](const sRequest& req, sResponce& res, RequestHandler::ResponseCompletion done) {
+        if (apiProcessor->serveAllDataFromMemory(req, res, false)) return done();
+        allDataFromDatabase(req, res, std::move(done));
+        });
+
+    // NEW: выборки по внешним ключам — только из памяти
+    addMemoryReadRoute(module, "/api/clients/\\d+/campaigns(?:/)?", [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleGetClientCampaigns(req, res);
+        });
+    addMemoryReadRoute(module, "/api/campaigns/\\d+/tasks(?:/)?", [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleGetCampaignTasks(req, res);
+        });
+    addMemoryReadRoute(module, "/api/team/\\d+/tasks(?:/)?", [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleGetTeamMemberTasks(req, res);
+        });
+
+    // ==================== CLIENTS ====================
+    module->addAsyncRouteHandler("/api/clients", offloadToDatabase(dbModule, [apiProcessor](const sRequest& req, sResponce& res) {
+        if (req.method() == http::verb::post) {
+            apiProcessor->handleAddClient(req, res);
+        }
+        else {
+            res.result(http::status::method_not_allowed);
+        }
+        }));
+
+    // NEW: удаление клиента со всем, что от него зависит, одним запросом вместо удаления кампаний по одной
+    module->addAsyncDynamicRouteHandler("/api/clients/\\d+/cascade(?:/)?", offloadToDatabase(dbModule, [apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleDeleteClientCascade(req, res);
+        }));
+
+    module->addAsyncDynamicRouteHandler("/api/clients/\\d+(?:/)?", readFromMemory([apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleGetClient(req, res);
+        }, offloadToDatabase(dbModule, [apiProcessor](const sRequest& req, sResponce& res) {
+        if (req.method() == http::verb::put) {
+            apiProcessor->handleUpdateClient(req, res);
+        }
+        else if (req.method() == http::verb::delete_) {
+            apiProcessor->handleDeleteClient(req, res);
+        }
+        else {
+            res.result(http::status::method_not_allowed);
+        }
+        })));
+
+    // ==================== CAMPAIGNS ====================
+    module->addAsyncRouteHandler("/api/campaigns", offloadToDatabase(dbModule, [apiProcessor](const sRequest& req, sResponce& res) {
+        if (req.method() == http::verb::post) {
+            apiProcessor->handleAddCampaign(req, res);
+        }
+        else {
+            res.result(http::status::method_not_allowed);
+        }
+        }));
+
+    module->addAsyncDynamicRouteHandler("/api/campaigns/\\d+(?:/)?", readFromMemory([apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleGetCampaign(req, res);
+        }, offloadToDatabase(dbModule, [apiProcessor](const sRequest& req, sResponce& res) {
+        if (req.method() == http::verb::put) {
+            apiProcessor->handleUpdateCampaign(req, res);
+        }
+        else if (req.method() == http::verb::delete_) {
+            apiProcessor->handleDeleteCampaign(req, res);
+        }
+        else {
+            res.result(http::status::method_not_allowed);
+        }
+        })));
+
+    // ==================== TASKS ====================
+    module->addAsyncRouteHandler("/api/tasks", offloadToDatabase(dbModule, [apiProcessor](const sRequest& req, sResponce& res) {
+        if (req.method() == http::verb::post) {
+            apiProcessor->handleAddTask(req, res);
+        }
+        else {
+            res.result(http::status::method_not_allowed);
+        }
+        }));
+
+    module->addAsyncDynamicRouteHandler("/api/tasks/\\d+(?:/)?", readFromMemory([apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleGetTask(req, res);
+        }, offloadToDatabase(dbModule, [apiProcessor](const sRequest& req, sResponce& res) {
+        if (req.method() == http::verb::put) {
+            apiProcessor->handleUpdateTask(req, res);
+        }
+        else if (req.method() == http::verb::delete_) {
+            apiProcessor->handleDeleteTask(req, res);
+        }
+        else {
+            res.result(http::status::method_not_allowed);
+        }
+        })));
+
+    // ==================== TEAM ====================
+    module->addAsyncRouteHandler("/api/team", offloadToDatabase(dbModule, [apiProcessor](const sRequest& req, sResponce& res) {
+        if (req.method() == http::verb::post) {
+            apiProcessor->handleAddTeamMember(req, res);
+        }
+        else {
+            res.result(http::status::method_not_allowed);
+        }
+        }));
+
+    module->addAsyncDynamicRouteHandler("/api/team/\\d+(?:/)?", readFromMemory([apiProcessor](const sRequest& req, sResponce& res) {
+        apiProcessor->handleGetTeamMember(req, res);
+        }, offloadToDatabase(dbModule, [apiProcessor](const sRequest& req, sResponce& res) {
+        if (req.method() == http::verb::put) {
+            apiProcessor->handleUpdateTeamMember(req, res);
+        }
+        else if (req.method() == http::verb::delete_) {
+            apiProcessor->handleDeleteTeamMember(req, res);
+        }
+        else {
+            res.result(http::status::method_not_allowed);
+        }
+        })));
+}
+
+void CreateNewHandlers(RequestHandler* module, std::string staticFolder) {
+    // Тестовый маршрут
+    module->addRouteHandler("/test", [](const sRequest& req, sResponce& res) {
+        if (req.method() != http::verb::get) {
+            res.result(http::status::method_not_allowed);
+            res.set(http::field::content_type, "text/plain");
+            res.body() = "Method Not Allowed. Use GET.";
+            return;
+        }
+        res.set(http::field::content_type, "text/plain");
+        res.body() = "Advertising Agency MVP Backend is running!\nРусский язык тоже поддерживается.";
+        res.result(http::status::ok);
+        });
+
+    module->addRouteHandler("/*", [](const sRequest& req, sResponce& res) {
+        });
+}
+
+void CreateMetricsHandlers(RequestHandler* module, MetricsModule* metrics) {
+    module->addRouteHandler("/metrics", [metrics](const sRequest& req, sResponce& res) {
+        res.set(http::field::content_type, "text/plain; version=0.0.4");
+        res.set(http::field::cache_control, "no-cache");
+        res.body() = metrics->renderPrometheus();
+        res.result(http::status::ok);
+        });
+}
+
+void CreateVersionHandlers(RequestHandler* module, ChangeFeed* changeFeed, std::string nodeName) {
+    module->addRouteHandler("/api/version", [changeFeed, nodeName = std::move(nodeName)](const sRequest& req, sResponce& res) {
+        if (req.method() != http::verb::get) {
+            res.result(http::status::method_not_allowed);
+            res.set(http::field::content_type, "text/plain");
+            res.body() = "Method Not Allowed. Use GET.";
+            return;
+        }
+        auto stats = changeFeed->getStats();
+        bj::object body;
+        body["version"] = stats.data_version;
+        body["node"] = nodeName;
+        body["connected"] = stats.connected;
+        res.set(http::field::content_type, "application/json");
+        res.set(http::field::cache_control, "no-store");
+        res.body() = bj::serialize(body);
+        res.result(http::status::ok);
+        });
+}
+
+void CreateTracingHandlers(RequestHandler* module, TracingModule* tracing) {
+    module->addRouteHandler("/admin/trace", [tracing](const sRequest& req, sResponce& res) {
+        if (req.method() != http::verb::get) {
+            res.result(http::status::method_not_allowed);
+            res.set(http::field::content_type, "text/plain");
+            res.body() = "Method Not Allowed. Use GET.";
+            return;
+        }
+        std::string target(req.target());
+        if (auto sample = RequestParsing::getQueryParam(target, "sample")) {
+            // FIXED: std::stoul принимал "-1" и после static_cast<uint32_t> давал 0xFFFFFFFF
+            uint32_t every = 0;
+            const char* end = sample->data() + sample->size();
+            auto [ptr, ec] = std::from_chars(sample->data(), end, every);
+            if (sample->empty() || ec != std::errc() || ptr != end) {
+                res.result(http::status::bad_request);
+                res.set(http::field::content_type, "text/plain");
+                res.body() = "sample must be a non-negative 32-bit integer";
+                return;
+            }
+            TracingModule::setSampleEvery(every);
+            Log::info("Trace sampling changed", { {"sample_every", every} });
+        }
+        res.set(http::field::content_type, "application/json");
+        res.set(http::field::cache_control, "no-cache");
+        res.body() = tracing->renderChromeTrace();
+        if (RequestParsing::getQueryParam(target, "clear") == std::optional<std::string>("1")) {
+            tracing->clear();
+        }
+        res.result(http::status::ok);
+        });
+}
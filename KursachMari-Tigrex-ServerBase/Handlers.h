@@ -2,142 +2,39 @@
 
 #include "RequestHandler.h"
 #include "ApiProcessor.h"
+#include "DatabaseModule.h"
+#include "ChangeFeed.h"
+#include "RequestCoalescer.h"
+#include "MetricsModule.h"
+#include "TracingModule.h"
 
 #include <string>
+#include <boost/asio/ip/tcp.hpp>
 #include <boost/beast/http.hpp>
 
 namespace http = boost::beast::http;
 
-void printConnectionInfo(tcp::socket& socket) {
-    try {
-        tcp::endpoint remote_ep = socket.remote_endpoint();
-        boost::asio::ip::address client_address = remote_ep.address();
-        unsigned short client_port = remote_ep.port();
+// Регистрация маршрутов приложения. Реализация — Handlers.cpp
 
-        std::cout << "Client connected from: "
-            << client_address.to_string()
-            << ":" << client_port << std::endl;
-    }
-    catch (const boost::system::system_error& e) {
-        std::cerr << "Error getting connection info: " << e.what() << std::endl;
-    }
-}
+void printConnectionInfo(boost::asio::ip::tcp::socket& socket);
 
-void CreateAPIHandlers(RequestHandler* module, ApiProcessor* apiProcessor) {
-    // Основной эндпоинт — возвращает все данные для фронтенда
-    module->addRouteHandler("/api/all-data", [apiProcessor](const sRequest& req, sResponce& res) {
-        if (req.method() != http::verb::get) {
-            res.result(http::status::method_not_allowed);
-            res.set(http::field::content_type, "text/plain");
-            res.body() = "Method Not Allowed. Use GET.";
-            return;
-        }
-        apiProcessor->handleGetAllData(req, res);
-        });
+// Переносит синхронный обработчик API на поток БД: I/O-поток только ставит задачу в очередь,
+// ответ отправляется из completion, когда обработчик отработал
+RequestHandler::AsyncRouteHandler offloadToDatabase(DatabaseModule* dbModule, RequestHandler::RouteHandler handler);
 
-    // ==================== CLIENTS ====================
-    module->addRouteHandler("/api/clients", [apiProcessor](const sRequest& req, sResponce& res) {
-        if (req.method() == http::verb::post) {
-            apiProcessor->handleAddClient(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
-        }
-        });
+// coalescer объединяет одинаковые одновременные GET /api/all-data, которые идут в БД
+void CreateAPIHandlers(RequestHandler* module, ApiProcessor* apiProcessor, DatabaseModule* dbModule, RequestCoalescer* coalescer);
 
-    module->addDynamicRouteHandler("/api/clients/\\d+(?:/)?", [apiProcessor](const sRequest& req, sResponce& res) {
-        if (req.method() == http::verb::put) {
-            apiProcessor->handleUpdateClient(req, res);
-        }
-        else if (req.method() == http::verb::delete_) {
-            apiProcessor->handleDeleteClient(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
-        }
-        });
+void CreateNewHandlers(RequestHandler* module, std::string staticFolder);
 
-    // ==================== CAMPAIGNS ====================
-    module->addRouteHandler("/api/campaigns", [apiProcessor](const sRequest& req, sResponce& res) {
-        if (req.method() == http::verb::post) {
-            apiProcessor->handleAddCampaign(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
-        }
-        });
+// Служебные маршруты: метрики в формате Prometheus
+void CreateMetricsHandlers(RequestHandler* module, MetricsModule* metrics);
 
-    module->addDynamicRouteHandler("/api/campaigns/\\d+(?:/)?", [apiProcessor](const sRequest& req, sResponce& res) {
-        if (req.method() == http::verb::put) {
-            apiProcessor->handleUpdateCampaign(req, res);
-        }
-        else if (req.method() == http::verb::delete_) {
-            apiProcessor->handleDeleteCampaign(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
-        }
-        });
+// Экспорт трассировки: GET /admin/trace — Chrome trace JSON из кольцевого буфера.
+// ?sample=N меняет частоту сэмплирования (0 — выключить), ?clear=1 очищает буфер после выгрузки.
+// Регистрируется только с --trace-admin: проверки прав у маршрута нет
+void CreateTracingHandlers(RequestHandler* module, TracingModule* tracing);
 
-    // ==================== TASKS ====================
-    module->addRouteHandler("/api/tasks", [apiProcessor](const sRequest& req, sResponce& res) {
-        if (req.method() == http::verb::post) {
-            apiProcessor->handleAddTask(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
-        }
-        });
-
-    module->addDynamicRouteHandler("/api/tasks/\\d+(?:/)?", [apiProcessor](const sRequest& req, sResponce& res) {
-        if (req.method() == http::verb::put) {
-            apiProcessor->handleUpdateTask(req, res);
-        }
-        else if (req.method() == http::verb::delete_) {
-            apiProcessor->handleDeleteTask(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
-        }
-        });
-
-    // ==================== TEAM ====================
-    module->addRouteHandler("/api/team", [apiProcessor](const sRequest& req, sResponce& res) {
-        if (req.method() == http::verb::post) {
-            apiProcessor->handleAddTeamMember(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
-        }
-        });
-
-    module->addDynamicRouteHandler("/api/team/\\d+(?:/)?", [apiProcessor](const sRequest& req, sResponce& res) {
-        if (req.method() == http::verb::put) {
-            apiProcessor->handleUpdateTeamMember(req, res);
-        }
-        else if (req.method() == http::verb::delete_) {
-            apiProcessor->handleDeleteTeamMember(req, res);
-        }
-        else {
-            res.result(http::status::method_not_allowed);
-        }
-        });
-}
-
-void CreateNewHandlers(RequestHandler* module, std::string staticFolder) {
-    // Тестовый маршрут
-    module->addRouteHandler("/test", [](const sRequest& req, sResponce& res) {
-        if (req.method() != http::verb::get) {
-            res.result(http::status::method_not_allowed);
-            res.set(http::field::content_type, "text/plain");
-            res.body() = "Method Not Allowed. Use GET.";
-            return;
-        }
-        res.set(http::field::content_type, "text/plain");
-        res.body() = "Advertising Agency MVP Backend is running!\nРусский язык тоже поддерживается.";
-        res.result(http::status::ok);
-        });
-
-    module->addRouteHandler("/*", [](const sRequest& req, sResponce& res) {
-        });
-}
\ No newline at end of file
+// Согласованность узлов: GET /api/version — {"version","node","connected"}. version — наибольшая версия
+// данных, которую этот узел уже применил к своим кэшам (ChangeFeed::dataVersion)
+void CreateVersionHandlers(RequestHandler* module, ChangeFeed* changeFeed, std::string nodeName);
@@ -4,13 +4,22 @@
 #include "FileCache.h"
 #include "macros.h"
 #include "Session.h"
+#include "HotRestart.h"
+#include "EventHub.h"
 
 #include "DatabaseModule.h"
+#include "ChangeFeed.h"
 #include "ApiProcessor.h"
 #include "DoSProtectionModule.h"
 #include "ServerConfig.h"
+#include "LoggingModule.h"
+#include "MetricsModule.h"
+#include "TracingModule.h"
 
+#include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/thread.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/program_options.hpp>
@@ -32,25 +41,166 @@ int main(int argc, char* argv[]) {
     std::cout << "OEMCP: " << GetOEMCP() << std::endl;
 #endif //_WIN32
 
+    // Реестр и учёт сессий объявлены раньше io_context: при выходе сначала разрушается ioc вместе с ещё
+    // не отработавшими обработчиками (а с ними последние сессии и их ConnectionGuard), и только потом — модули
+    ModuleRegistry registry;
+    SessionTracker sessions;
     net::io_context ioc;
 
-    const char* databaseStr = "dbname=postgres user=postgres password=postgres host=127.0.0.1 port=54855";//TODO: Перенести хардкод в параметры
-
-    ModuleRegistry registry;
+    auto* loggingModule = registry.registerModule<LoggingModule>();
+    auto* metricsModule = registry.registerModule<MetricsModule>();
+    TracingModule::Settings traceSettings;
+    traceSettings.sample_every = config.trace_sample;
+    traceSettings.capacity = config.trace_buffer;
+    auto* tracingModule = registry.registerModule<TracingModule>(traceSettings);
     auto* cacheModule = registry.registerModule<FileCache>(config.directory.c_str(), true, 100);
     auto* requestModule = registry.registerModule<RequestHandler>();
-    auto* dosProtectionModule = registry.registerModule<DoSProtectionModule>();
-    auto* dbModule = registry.registerModule<DatabaseModule>(ioc, databaseStr);
+    DoSProtectionModule::Settings dosSettings;
+    dosSettings.nft_table = config.nft_table;
+    dosSettings.refill_per_second = config.rate_limit;
+    dosSettings.capacity = config.rate_burst;
+    dosSettings.max_connections = config.max_connections;
+    dosSettings.max_connections_per_ip = config.max_connections_per_ip;
+    auto* dosProtectionModule = registry.registerModule<DoSProtectionModule>(dosSettings);
+    auto* dbModule = registry.registerModule<DatabaseModule>(ioc, config.database);
+    dbModule->setConsistencyCheckInterval(std::chrono::seconds(config.consistency_check));
+    // NEW: изменения в БД (LISTEN/NOTIFY) уходят открытым страницам через SSE на /api/events
+    auto* eventHub = registry.registerModule<EventHub>(ioc);
+    auto* changeFeed = registry.registerModule<ChangeFeed>(config.database);
+    changeFeed->setListener([eventHub](std::string_view event, const std::string& data) { eventHub->publish(event, data); });
+    // NEW: реплика таблиц в памяти узла: записи других узлов — из ChangeFeed, после (пере)подключения — полная перезагрузка.
+    // FIXED: первая загрузка — тоже по resync после LISTEN, а не ещё и при старте БД: раньше при запуске было два полных чтения
+    dbModule->setLoadEntitiesOnStart(false);
+    changeFeed->addInvalidationHook([dbModule](const ChangeFeed::Change& change, const pqxx::row* row) {
+        if (change.op == "resync") {
+            dbModule->reloadEntities();
+        }
+        else {
+            dbModule->entities().apply(change.table, change.id, change.op == "delete" ? nullptr : row, change.version);
+        }
+        });
 
     ApiProcessor apiProcessor(dbModule); //TODO: Не совсем подходит моей идеологии управления жизнью через реестр модулей. Однако это по сути обёртка
 
-    CreateAPIHandlers(requestModule, &apiProcessor);
+    RequestCoalescer coalescer;
+    CreateAPIHandlers(requestModule, &apiProcessor, dbModule, &coalescer);
 
     CreateNewHandlers(requestModule, config.directory);
 
-    registry.initializeAll();
+    CreateMetricsHandlers(requestModule, metricsModule);
+
+    // FIXED: /admin/trace меняет сэмплирование и чистит буфер — только по явному --trace-admin
+    if (config.trace_admin) CreateTracingHandlers(requestModule, tracingModule);
+
+    CreateVersionHandlers(requestModule, changeFeed, net::ip::host_name() + ":" + std::to_string(config.port));
+
+    // Значения, которые модули считают сами, — снимаются в момент запроса /metrics
+    metricsModule->addCollector([dosProtectionModule, cacheModule, loggingModule, tracingModule, dbModule,
+        eventHub, changeFeed, &coalescer](std::string& out) {
+        auto dos = dosProtectionModule->getStats();
+        out += "# TYPE dos_rejected_connections_total counter\n";
+        out += "dos_rejected_connections_total " + std::to_string(dos.rejected_connections) + "\n";
+        out += "# TYPE dos_rejected_requests_total counter\n";
+        out += "dos_rejected_requests_total " + std::to_string(dos.rejected_requests) + "\n";
+        out += "# TYPE dos_bans_total counter\n";
+        out += "dos_bans_total " + std::to_string(dos.bans) + "\n";
+        out += "# TYPE dos_connection_limit_rejections_total counter\n";
+        out += "dos_connection_limit_rejections_total " + std::to_string(dos.limited_connections) + "\n";
+        out += "# TYPE connections_active gauge\n";
+        out += "connections_active " + std::to_string(dos.active_connections) + "\n";
+
+        auto cache = cacheModule->get_cache_info();
+        out += "# TYPE filecache_cached_files gauge\n";
+        out += "filecache_cached_files " + std::to_string(cache.cached_files_count) + "\n";
+        out += "# TYPE filecache_size_bytes gauge\n";
+        out += "filecache_size_bytes " + std::to_string(cache.total_cache_size_bytes) + "\n";
+
+        out += "# TYPE log_records_dropped_total counter\n";
+        out += "log_records_dropped_total " + std::to_string(loggingModule->getDroppedCount()) + "\n";
+
+        auto trace = tracingModule->getStats();
+        out += "# TYPE trace_requests_sampled_total counter\n";
+        out += "trace_requests_sampled_total " + std::to_string(trace.traces_started) + "\n";
+        out += "# TYPE trace_spans_overwritten_total counter\n";
+        out += "trace_spans_overwritten_total " + std::to_string(trace.spans_overwritten) + "\n";
+
+        out += "# TYPE db_counter_repairs_total counter\n";
+        out += "db_counter_repairs_total " + std::to_string(dbModule->getCounterRepairs()) + "\n";
 
-    static_cast<RequestHandler*>(requestModule)->setFileCache(cacheModule);
+        auto coalescing = coalescer.getStats();
+        out += "# TYPE api_coalesced_executions_total counter\n";
+        out += "api_coalesced_executions_total " + std::to_string(coalescing.executed) + "\n";
+        out += "# TYPE api_coalesced_requests_total counter\n";
+        out += "api_coalesced_requests_total " + std::to_string(coalescing.coalesced) + "\n";
+
+        auto entities = dbModule->entities().getStats();
+        out += "# TYPE entity_store_loaded gauge\n";
+        out += "entity_store_loaded " + std::string(entities.loaded ? "1" : "0") + "\n";
+        out += "# TYPE entity_store_rows gauge\n";
+        out += "entity_store_rows{table=\"clients\"} " + std::to_string(entities.clients) + "\n";
+        out += "entity_store_rows{table=\"campaigns\"} " + std::to_string(entities.campaigns) + "\n";
+        out += "entity_store_rows{table=\"tasks\"} " + std::to_string(entities.tasks) + "\n";
+        out += "entity_store_rows{table=\"team\"} " + std::to_string(entities.team) + "\n";
+        out += "# TYPE entity_store_loads_total counter\n";
+        out += "entity_store_loads_total " + std::to_string(entities.loads) + "\n";
+        out += "# TYPE entity_store_all_data_renders_total counter\n";
+        out += "entity_store_all_data_renders_total " + std::to_string(entities.all_data_renders) + "\n";
+
+        auto events = eventHub->getStats();
+        out += "# TYPE sse_subscribers gauge\n";
+        out += "sse_subscribers " + std::to_string(events.subscribers) + "\n";
+        out += "# TYPE sse_events_total counter\n";
+        out += "sse_events_total " + std::to_string(events.events) + "\n";
+        out += "# TYPE sse_dropped_slow_total counter\n";
+        out += "sse_dropped_slow_total " + std::to_string(events.dropped_slow) + "\n";
+        out += "# TYPE sse_rejected_total counter\n";
+        out += "sse_rejected_total " + std::to_string(events.rejected) + "\n";
+
+        auto feed = changeFeed->getStats();
+        out += "# TYPE change_feed_notifications_total counter\n";
+        out += "change_feed_notifications_total " + std::to_string(feed.notifications) + "\n";
+        out += "# TYPE change_feed_reconnects_total counter\n";
+        out += "change_feed_reconnects_total " + std::to_string(feed.reconnects) + "\n";
+        out += "# TYPE data_version gauge\n";
+        out += "data_version " + std::to_string(feed.data_version) + "\n";
+        out += "# TYPE change_feed_connected gauge\n";
+        out += "change_feed_connected " + std::string(feed.connected ? "1" : "0") + "\n";
+        });
+
+    // Стоимость запросов для rate limiter: тяжёлые эндпоинты расходуют больше токенов
+    dosProtectionModule->setRouteCost("/api/", 2.0);
+    dosProtectionModule->setRouteCost("/api/all-data", 10.0);
+
+    // FIXED: модули останавливаются на любом выходе из main, в том числе по исключению (порт занят, нечего забрать
+    // при --takeover), и всегда до разрушения ioc: таймеры EventHub и post из потока ChangeFeed ещё держат его.
+    // Порядок — обратный топологический (dependsOn): ChangeFeed останавливается раньше БД,
+    // а БД дорабатывает очередь раньше, чем уходят логирование и метрики.
+    // Инструментированная PGO-сборка записывает профиль при штатном выходе из main
+    struct ShutdownGuard {
+        ModuleRegistry& registry;
+        ~ShutdownGuard() { registry.shutdownAll(); }
+    } shutdownGuard{ registry };
+
+    // Модули без общих зависимостей (прогрев FileCache, подключение к БД, DoS, логирование) стартуют параллельно
+    bool initialized = false;
+    try {
+        initialized = registry.initializeAll();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+    if (!initialized) {
+        // При --takeover старый процесс так и продолжает работать: сокет ещё не забран
+        std::cerr << "Module initialization failed, exiting" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    SessionLimits sessionLimits;
+    sessionLimits.idle_timeout = std::chrono::seconds(config.idle_timeout);
+    sessionLimits.read_timeout = std::chrono::seconds(config.read_timeout);
+    sessionLimits.write_timeout = std::chrono::seconds(config.write_timeout);
+    sessionLimits.header_limit = config.header_limit;
+    sessionLimits.body_limit = config.body_limit;
 
 
     ///////////////////////////////////////////////////////////
@@ -58,37 +208,138 @@ int main(int argc, char* argv[]) {
     try {
         auto const net_address = net::ip::make_address(config.address);
         auto const net_port = static_cast<unsigned short>(config.port);
-        tcp::acceptor acceptor{ ioc, {net_address, net_port} };
-        std::cout << "Server started on http://" << config.address << ":" << config.port << std::endl;
+        tcp::acceptor acceptor{ ioc };
+        HotRestart hotRestart(ioc, config.control_socket);
+        if (config.takeover) {
+            // NEW: горячий перезапуск — слушающий сокет (и очередь accept) достаётся от работающего процесса
+            int listener = hotRestart.takeListener();
+            acceptor.assign(net_address.is_v6() ? tcp::v6() : tcp::v4(), listener);
+            std::cout << "Server took over http://" << acceptor.local_endpoint() << " via " << config.control_socket << std::endl;
+        }
+        else {
+            tcp::endpoint endpoint{ net_address, net_port };
+            acceptor.open(endpoint.protocol());
+            acceptor.set_option(net::socket_base::reuse_address(true));
+            acceptor.bind(endpoint);
+            acceptor.listen(net::socket_base::max_listen_connections);
+            std::cout << "Server started on http://" << config.address << ":" << config.port << std::endl;
+        }
 
         // UPDATED: Do_accept с std::function для safe recursive (avoid self-ref UB)
-        std::function<void()> do_accept_func = [&acceptor, &ioc, requestModule, &do_accept_func, &dosProtectionModule]() {  // NEW: Explicit function, self-capture by ref
+        std::function<void()> do_accept_func = [&acceptor, &ioc, requestModule, &do_accept_func, &dosProtectionModule, &sessionLimits, &sessions, eventHub]() {  // NEW: Explicit function, self-capture by ref
             auto socket = std::make_shared<tcp::socket>(ioc);
             acceptor.async_accept(*socket,
-                [socket_ptr = socket, &do_accept_func, requestModule, &dosProtectionModule](beast::error_code ec) {
+                [socket_ptr = socket, &acceptor, &do_accept_func, requestModule, &dosProtectionModule, &sessionLimits, &sessions, eventHub](beast::error_code ec) {
                     if (!ec) {
-                        printConnectionInfo(*socket_ptr);
-                        std::string ip = (*socket_ptr).remote_endpoint().address().to_string();
-                        if (dosProtectionModule->isAllowed(ip)) {
-                            std::make_shared<session>(std::move(*socket_ptr), requestModule)->run();
+                        beast::error_code ep_ec;
+                        auto address = socket_ptr->remote_endpoint(ep_ec).address();
+                        // На accept отсекаем забаненных и тех, кто упёрся в лимит соединений; лимит запросов проверяет session
+                        DoSProtectionModule::ConnectionGuard connection;
+                        if (dosProtectionModule->isBanned(address)) {
+                            dosProtectionModule->recordRejectedConnection();
+                        }
+                        else {
+                            connection = dosProtectionModule->acquireConnection(address);
+                        }
+                        if (connection) {
+                            printConnectionInfo(*socket_ptr);
+                            std::make_shared<session>(std::move(*socket_ptr), requestModule, dosProtectionModule,
+                                sessionLimits, std::move(connection), &sessions, eventHub)->run();
                         }
                         else {
-                            std::cout << "[" << ip << "] Connection terminated: DoS protection triggered (rate limit exceeded)\n";
+                            // Без вывода в консоль: отказ только считается, сводку пишет DoSProtectionModule.
+                            // linger(0) закрывает RST'ом — без FIN-рукопожатия и TIME_WAIT
+                            beast::error_code close_ec;
+                            socket_ptr->set_option(net::socket_base::linger(true, 0), close_ec);
+                            socket_ptr->close(close_ec);
                         }
                     }
-                    else {
-                        std::cerr << "Accept error: " << ec.message() << std::endl;
+                    else if (ec != net::error::operation_aborted) {
+                        Log::error("Accept error", { {"error", ec.message()} });
                     }
+                    // Остановка: acceptor закрыт. Уже принятое выше соединение обслуживается (получит Connection: close),
+                    // иначе сокет закрылся бы с непрочитанным запросом — клиент увидел бы RST
+                    if (!acceptor.is_open()) return;
                     do_accept_func();  // Рекурсия via function call (safe)
                 });
             };
 
         do_accept_func();
+        // Accept уже ждёт на переданном сокете — старый процесс может закрывать свой acceptor
+        if (config.takeover) hotRestart.confirmTakeover();
+
+        // NEW: плавная остановка. Новые соединения больше не принимаются, простаивающие закрываются сразу,
+        // занятые отвечают на текущий запрос с Connection: close. Кто не успел за drain_timeout — закрывается
+        net::signal_set signals(ioc, SIGINT, SIGTERM);
+        net::steady_timer drainTimer(ioc);
+        bool stopping = false;
+        bool forced = false;
+        auto drainDeadline = std::chrono::steady_clock::now();
+
+        std::function<void()> waitDrained = [&]() {
+            auto now = std::chrono::steady_clock::now();
+            if (sessions.active() == 0) {
+                Log::info("Sessions drained");
+                ioc.stop();
+                return;
+            }
+            if (!forced && now >= drainDeadline) {
+                forced = true;
+                Log::warning("Drain timeout, closing sessions", { {"sessions", sessions.active()} });
+                sessions.closeAll();
+            }
+            else if (forced && now >= drainDeadline + std::chrono::seconds(1)) {
+                // Остались сессии, ждущие ответа БД: их допишет shutdownAll, разрушит ioc
+                ioc.stop();
+                return;
+            }
+            drainTimer.expires_after(std::chrono::milliseconds(50));
+            drainTimer.async_wait([&](const beast::error_code& ec) {
+                if (!ec) waitDrained();
+                });
+            };
+
+        auto beginShutdown = [&](const char* reason) {
+            if (stopping) return;
+            stopping = true;
+            beast::error_code ec;
+            acceptor.close(ec);  // После передачи сокета закрывается только наша копия, очередь accept у нового процесса
+            hotRestart.stop();
+            Log::info("Shutting down", { {"reason", reason}, {"sessions", sessions.active()},
+                {"drain_timeout_s", config.drain_timeout} });
+            sessions.drainAll();
+            eventHub->closeAll();  // Потоки событий бесконечны: EventSource сам переподключится к новому процессу
+            drainDeadline = std::chrono::steady_clock::now() + std::chrono::seconds(config.drain_timeout);
+            waitDrained();
+            };
+
+        // Повторный сигнал во время слива — не ждать срока
+        std::function<void()> waitSignal = [&]() {
+            signals.async_wait([&](const beast::error_code& ec, int) {
+                if (ec) return;
+                if (stopping) drainDeadline = std::chrono::steady_clock::now();
+                else beginShutdown("signal");
+                waitSignal();
+                });
+            };
+        waitSignal();
+
+        if (!config.control_socket.empty()) {
+            if (HotRestart::supported()) {
+                hotRestart.listen(static_cast<int>(acceptor.native_handle()), [&]() { beginShutdown("hot restart"); });
+            }
+            else {
+                std::cerr << "Warning: hot restart is not supported on this platform, --control-socket ignored\n";
+            }
+        }
+
+        MetricsModule::prepareThread();
         ioc.run();  // Блокирует, обрабатывает все async
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return EXIT_FAILURE;
     }
-    return 0;
+
+    return 0;  // Модули остановит shutdownGuard
 }
\ No newline at end of file
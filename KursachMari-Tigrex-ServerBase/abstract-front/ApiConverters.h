@@ -0,0 +1,382 @@
+﻿#pragma once
+
+#include "Entities.h"
+#include "JsonWriter.h"
+
+#include <boost/json.hpp>
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace bj = boost::json;
+
+/*
+# ApiConverters
+    Строки БД -> JSON для фронтенда.
+    Шаблоны по типу строки: в сервере это pqxx::row, в микробенчмарках — синтетическая строка
+    с тем же интерфейсом (row["column"], row[index], is_null(), c_str(), size(), as<T>()), без PostgreSQL.
+    Поля каждой таблицы описаны constexpr-таблицей (kClientFields и т.д.): конвертер разворачивается из неё
+    при компиляции, без ветвлений по типу поля на каждой строке. Числа разбираются std::from_chars.
+    clientToJson(row) ищет столбцы по имени — для одиночных строк (RETURNING *) и уведомлений ChangeFeed.
+    Перегрузки для Entities (EntityStore) дают тот же JSON, что и из строки: ответы из памяти и из БД
+    не должны различаться.
+    Для больших ответов (/api/all-data) — RowWriter и writeJson: пишут текст прямо в JsonWriter, без bj::object
+    на строку. Ключи с кавычками и разделителями ("{\"id\":", ",\"name\":") собираются из тех же таблиц
+    при компиляции. Вывод байт в байт как у bj::serialize(clientToJson(...)).
+*/
+
+namespace ApiConverters {
+
+    // NEW: как поле попадает в JSON. TextOrEmpty — NULL превращается в "" (contact клиента),
+    // NumberOrZero — в 0 (workload сотрудника). Одинаково для строк БД и для записей EntityStore
+    enum class FieldKind { Int, Number, NumberOrZero, Text, TextOrEmpty };
+
+    struct FieldSpec {
+        const char* column;  // Столбец в БД
+        const char* key;     // Ключ в JSON
+        FieldKind kind;
+        bool nullable;       // NULL -> null; у остальных NULL — ошибка, как у as<T>()
+    };
+
+    // Порядок — порядок ключей в ответе
+    inline constexpr FieldSpec kClientFields[] = {
+        { "id", "id", FieldKind::Int, false },
+        { "name", "name", FieldKind::Text, false },
+        { "contact", "contact", FieldKind::TextOrEmpty, false },
+        { "status", "status", FieldKind::Text, false },
+        { "total_budget", "totalBudget", FieldKind::Number, false },
+        { "campaigns_count", "campaignsCount", FieldKind::Int, false },
+    };
+
+    inline constexpr FieldSpec kCampaignFields[] = {
+        { "id", "id", FieldKind::Int, false },
+        { "client_id", "clientId", FieldKind::Int, false },
+        { "name", "name", FieldKind::Text, false },
+        { "status", "status", FieldKind::Text, false },
+        { "budget", "budget", FieldKind::Number, false },
+        { "spent", "spent", FieldKind::Number, false },
+        { "start_date", "startDate", FieldKind::Text, true },
+        { "end_date", "endDate", FieldKind::Text, true },
+        { "roi", "roi", FieldKind::Number, true },
+    };
+
+    inline constexpr FieldSpec kTaskFields[] = {
+        { "id", "id", FieldKind::Int, false },
+        { "campaign_id", "campaignId", FieldKind::Int, false },
+        { "assignee_id", "assigneeId", FieldKind::Int, true },
+        { "title", "title", FieldKind::Text, false },
+        { "description", "description", FieldKind::Text, true },
+        { "status", "status", FieldKind::Text, false },
+        { "due_date", "dueDate", FieldKind::Text, true },
+    };
+
+    inline constexpr FieldSpec kTeamMemberFields[] = {
+        { "id", "id", FieldKind::Int, false },
+        { "fullname", "fullname", FieldKind::Text, false },
+        { "role", "role", FieldKind::Text, false },
+        { "workload", "workload", FieldKind::NumberOrZero, false },  // FIXED: NULL из БД больше не бросает
+    };
+
+    namespace detail {
+
+        // Текст NUMERIC/INTEGER без локали и исключений. Чего from_chars не понял (и NULL) — разбирает as<T>(),
+        // чтобы ошибки остались прежними
+        template<class T, class Field>
+        T parseNumber(const Field& field) {
+            if (!field.is_null()) {
+                const char* begin = field.c_str();
+                const char* end = begin + field.size();
+                T value{};
+                auto [ptr, ec] = std::from_chars(begin, end, value);
+                if (ec == std::errc() && ptr == end) return value;
+            }
+            return field.template as<T>();
+        }
+
+        template<FieldKind Kind, bool Nullable, class Field>
+        void putField(bj::object& obj, const char* key, const Field& field) {
+            if constexpr (Nullable) {
+                if (field.is_null()) {
+                    obj.emplace(key, nullptr);
+                    return;
+                }
+            }
+            if constexpr (Kind == FieldKind::Int) {
+                obj.emplace(key, parseNumber<int>(field));
+            }
+            else if constexpr (Kind == FieldKind::Number) {
+                obj.emplace(key, parseNumber<double>(field));
+            }
+            else if constexpr (Kind == FieldKind::NumberOrZero) {
+                obj.emplace(key, field.is_null() ? 0.0 : parseNumber<double>(field));
+            }
+            else if constexpr (Kind == FieldKind::TextOrEmpty) {
+                obj.emplace(key, field.is_null() ? bj::string_view() : bj::string_view(field.c_str(), field.size()));
+            }
+            else {
+                obj.emplace(key, bj::string_view(field.c_str(), field.size()));
+            }
+        }
+
+        // Номера столбцов полей в результате: ищутся по имени один раз
+        template<const auto& Fields, class Result>
+        std::array<int, std::size(Fields)> resolveColumns(const Result& result) {
+            std::array<int, std::size(Fields)> columns{};
+            for (std::size_t i = 0; i < std::size(Fields); ++i) {
+                columns[i] = static_cast<int>(result.column_number(Fields[i].column));
+            }
+            return columns;
+        }
+
+        // Все ключи таблицы подряд: "{\"id\":" ",\"name\":" ... и границы каждого
+        template<std::size_t Count, std::size_t Length>
+        struct KeyTable {
+            std::array<char, Length> text{};
+            std::array<std::size_t, Count + 1> offsets{};
+
+            constexpr std::string_view operator[](std::size_t i) const {
+                return std::string_view(text.data() + offsets[i], offsets[i + 1] - offsets[i]);
+            }
+        };
+
+        template<const auto& Fields>
+        constexpr std::size_t keysLength() {
+            std::size_t length = 0;
+            for (const auto& field : Fields) {
+                length += std::char_traits<char>::length(field.key) + 4;  // разделитель, две кавычки, ':'
+            }
+            return length;
+        }
+
+        template<const auto& Fields>
+        constexpr auto buildKeys() {
+            KeyTable<std::size(Fields), keysLength<Fields>()> keys;
+            std::size_t pos = 0;
+            for (std::size_t i = 0; i < std::size(Fields); ++i) {
+                keys.offsets[i] = pos;
+                keys.text[pos++] = i == 0 ? '{' : ',';
+                keys.text[pos++] = '"';
+                for (const char* c = Fields[i].key; *c; ++c) keys.text[pos++] = *c;
+                keys.text[pos++] = '"';
+                keys.text[pos++] = ':';
+            }
+            keys.offsets[std::size(Fields)] = pos;
+            return keys;
+        }
+
+        template<const auto& Fields>
+        inline constexpr auto kKeys = buildKeys<Fields>();
+
+        // Поле строки БД -> JSON-текст. INTEGER копируется как есть: текст PostgreSQL уже в том виде,
+        // в каком его пишет bj::serialize
+        template<FieldKind Kind, bool Nullable, class Field>
+        void writeField(JsonWriter& out, const Field& field) {
+            if constexpr (Nullable) {
+                if (field.is_null()) return out.null();
+            }
+            if constexpr (Kind == FieldKind::Int) {
+                if (field.is_null()) parseNumber<int>(field);  // as<T>() бросит то же исключение, что раньше
+                out.raw(std::string_view(field.c_str(), field.size()));
+            }
+            else if constexpr (Kind == FieldKind::Number) {
+                out.number(parseNumber<double>(field));
+            }
+            else if constexpr (Kind == FieldKind::NumberOrZero) {
+                out.number(field.is_null() ? 0.0 : parseNumber<double>(field));
+            }
+            else if constexpr (Kind == FieldKind::TextOrEmpty) {
+                out.string(field.is_null() ? std::string_view() : std::string_view(field.c_str(), field.size()));
+            }
+            else {
+                out.string(std::string_view(field.c_str(), field.size()));
+            }
+        }
+
+        // Член записи Entities -> JSON-текст. NULL у не-nullable полей — как в перегрузках *ToJson(Entities):
+        // "" для TextOrEmpty, 0 для чисел
+        template<FieldKind Kind, bool Nullable, class T>
+        void writeMember(JsonWriter& out, const T& value) {
+            if constexpr (std::is_same_v<T, std::string>) {
+                out.string(value);
+            }
+            else if constexpr (std::is_same_v<T, int>) {
+                out.integer(value);
+            }
+            else if constexpr (std::is_same_v<T, double>) {
+                out.number(value);
+            }
+            else {
+                if (value) return writeMember<Kind, Nullable>(out, *value);
+                if constexpr (Nullable) out.null();
+                else if constexpr (Kind == FieldKind::TextOrEmpty || Kind == FieldKind::Text) out.string(std::string_view());
+                else if constexpr (Kind == FieldKind::Int) out.integer(0);
+                else out.number(0.0);
+            }
+        }
+
+        // column(i) — чем адресовать i-е поле в строке: именем или номером столбца
+        template<const auto& Fields, class Row, class Column>
+        bj::object convert(const Row& row, const Column& column) {
+            constexpr std::size_t count = std::size(Fields);
+            bj::object obj;
+            obj.reserve(count);
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                (putField<Fields[I].kind, Fields[I].nullable>(obj, Fields[I].key, row[column(I)]), ...);
+            }(std::make_index_sequence<count>{});
+            return obj;
+        }
+
+    }
+
+    // Строка -> JSON с поиском столбцов по имени
+    template<const auto& Fields, class Row>
+    bj::object rowToJson(const Row& row) {
+        return detail::convert<Fields>(row, [](std::size_t i) { return Fields[i].column; });
+    }
+
+    // NEW: конвертер для всего результата: номера столбцов ищутся в конструкторе, строка сразу пишется
+    // текстом в JsonWriter
+    template<const auto& Fields>
+    class RowWriter {
+    public:
+        template<class Result>
+        explicit RowWriter(const Result& result) : columns_(detail::resolveColumns<Fields>(result)) {}
+
+        template<class Row>
+        void operator()(JsonWriter& out, const Row& row) const {
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ((out.raw(detail::kKeys<Fields>[I]),
+                  detail::writeField<Fields[I].kind, Fields[I].nullable>(out, row[columns_[I]])), ...);
+            }(std::make_index_sequence<std::size(Fields)>{});
+            out.raw('}');
+        }
+
+        // Верхняя оценка размера JSON-массива из всех строк результата — чтобы выделить буфер один раз.
+        // Текст полей плюс ключи; запас на экранирование и на запись чисел через E
+        template<class Result>
+        std::size_t estimate(const Result& result) const {
+            std::size_t size = 2;
+            for (std::size_t i = 0; i < result.size(); ++i) {
+                const auto row = result[i];
+                size += detail::kKeys<Fields>.offsets[std::size(Fields)] + 1 + 8 * std::size(Fields);
+                for (int column : columns_) size += row[column].size();
+            }
+            return size;
+        }
+
+    private:
+        std::array<int, std::size(Fields)> columns_{};
+    };
+
+    using ClientWriter = RowWriter<kClientFields>;
+    using CampaignWriter = RowWriter<kCampaignFields>;
+    using TaskWriter = RowWriter<kTaskFields>;
+    using TeamMemberWriter = RowWriter<kTeamMemberFields>;
+
+    // Весь результат — JSON-массивом
+    template<class Writer, class Result>
+    void writeArray(JsonWriter& out, const Writer& writer, const Result& result) {
+        out.raw('[');
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            if (i) out.raw(',');
+            writer(out, result[i]);
+        }
+        out.raw(']');
+    }
+
+    template<class Row>
+    bj::object clientToJson(const Row& row) { return rowToJson<kClientFields>(row); }
+
+    template<class Row>
+    bj::object campaignToJson(const Row& row) { return rowToJson<kCampaignFields>(row); }
+
+    template<class Row>
+    bj::object taskToJson(const Row& row) { return rowToJson<kTaskFields>(row); }
+
+    template<class Row>
+    bj::object teamMemberToJson(const Row& row) { return rowToJson<kTeamMemberFields>(row); }
+
+    // NEW: записи EntityStore. Порядок и вид полей — как у шаблонов выше
+    inline bj::object clientToJson(const Entities::Client& c) {
+        bj::object obj;
+        obj["id"] = c.id;
+        obj["name"] = c.name;
+        obj["contact"] = c.contact ? *c.contact : std::string();
+        obj["status"] = c.status;
+        obj["totalBudget"] = c.total_budget;
+        obj["campaignsCount"] = c.campaigns_count;
+        return obj;
+    }
+
+    inline bj::object campaignToJson(const Entities::Campaign& c) {
+        bj::object obj;
+        obj["id"] = c.id;
+        obj["clientId"] = c.client_id;
+        obj["name"] = c.name;
+        obj["status"] = c.status;
+        obj["budget"] = c.budget;
+        obj["spent"] = c.spent;
+        if (c.start_date) obj["startDate"] = *c.start_date; else obj["startDate"] = nullptr;
+        if (c.end_date) obj["endDate"] = *c.end_date; else obj["endDate"] = nullptr;
+        if (c.roi) obj["roi"] = *c.roi; else obj["roi"] = nullptr;
+        return obj;
+    }
+
+    inline bj::object taskToJson(const Entities::Task& t) {
+        bj::object obj;
+        obj["id"] = t.id;
+        obj["campaignId"] = t.campaign_id;
+        if (t.assignee_id) obj["assigneeId"] = *t.assignee_id; else obj["assigneeId"] = nullptr;
+        obj["title"] = t.title;
+        if (t.description) obj["description"] = *t.description; else obj["description"] = nullptr;
+        obj["status"] = t.status;
+        if (t.due_date) obj["dueDate"] = *t.due_date; else obj["dueDate"] = nullptr;
+        return obj;
+    }
+
+    inline bj::object teamMemberToJson(const Entities::TeamMember& m) {
+        bj::object obj;
+        obj["id"] = m.id;
+        obj["fullname"] = m.fullname;
+        obj["role"] = m.role;
+        obj["workload"] = m.workload.value_or(0.0);
+        return obj;
+    }
+
+    // NEW: записи EntityStore текстом. Члены — в порядке полей таблицы kXxxFields
+    inline constexpr auto kClientMembers = std::make_tuple(&Entities::Client::id, &Entities::Client::name,
+        &Entities::Client::contact, &Entities::Client::status, &Entities::Client::total_budget, &Entities::Client::campaigns_count);
+    inline constexpr auto kCampaignMembers = std::make_tuple(&Entities::Campaign::id, &Entities::Campaign::client_id,
+        &Entities::Campaign::name, &Entities::Campaign::status, &Entities::Campaign::budget, &Entities::Campaign::spent,
+        &Entities::Campaign::start_date, &Entities::Campaign::end_date, &Entities::Campaign::roi);
+    inline constexpr auto kTaskMembers = std::make_tuple(&Entities::Task::id, &Entities::Task::campaign_id,
+        &Entities::Task::assignee_id, &Entities::Task::title, &Entities::Task::description, &Entities::Task::status,
+        &Entities::Task::due_date);
+    inline constexpr auto kTeamMemberMembers = std::make_tuple(&Entities::TeamMember::id, &Entities::TeamMember::fullname,
+        &Entities::TeamMember::role, &Entities::TeamMember::workload);
+
+    namespace detail {
+        template<const auto& Fields, const auto& Members, class Entity>
+        void writeEntity(JsonWriter& out, const Entity& entity) {
+            static_assert(std::tuple_size_v<std::decay_t<decltype(Members)>> == std::size(Fields));
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ((out.raw(kKeys<Fields>[I]),
+                  writeMember<Fields[I].kind, Fields[I].nullable>(out, entity.*std::get<I>(Members))), ...);
+            }(std::make_index_sequence<std::size(Fields)>{});
+            out.raw('}');
+        }
+    }
+
+    inline void writeJson(JsonWriter& out, const Entities::Client& c) { detail::writeEntity<kClientFields, kClientMembers>(out, c); }
+    inline void writeJson(JsonWriter& out, const Entities::Campaign& c) { detail::writeEntity<kCampaignFields, kCampaignMembers>(out, c); }
+    inline void writeJson(JsonWriter& out, const Entities::Task& t) { detail::writeEntity<kTaskFields, kTaskMembers>(out, t); }
+    inline void writeJson(JsonWriter& out, const Entities::TeamMember& m) { detail::writeEntity<kTeamMemberFields, kTeamMemberMembers>(out, m); }
+
+}
@@ -1,155 +1,154 @@
 ﻿#include "ApiProcessor.h"
 #include "DatabaseModule.h"
+#include "EntityStore.h"
+#include "ApiConverters.h"
+#include "JsonBody.h"
+#include "JsonWriter.h"
+#include "RequestParsing.h"
+#include "TracingModule.h"
 
-#include <boost/algorithm/string.hpp>
 #include <boost/json.hpp>
 #include <pqxx/pqxx>
 
+#include <boost/algorithm/string.hpp>
+
 #include <iostream>
-#include <regex>
+#include <vector>
 
 namespace bj = boost::json;
 namespace http = boost::beast::http;
 
-ApiProcessor::ApiProcessor(DatabaseModule* db_module) : db_module_(db_module) {}
+using ApiConverters::clientToJson;
+using ApiConverters::campaignToJson;
+using ApiConverters::taskToJson;
+using ApiConverters::teamMemberToJson;
+using RequestParsing::getQueryParam;
+using RequestParsing::parseIdFromPath;
 
-pqxx::connection* ApiProcessor::getConn() {
-    if (!db_module_ || !db_module_->isDatabaseReady()) {
-        return nullptr;
-    }
-    return db_module_->getConnection();
-}
+namespace {
+    // Агрегаты дашборда: та же выборка для /api/all-data и для ответов записи, пока нет реплики в памяти
+    bj::object queryDashboard(pqxx::work& txn) {
+        bj::object dashboard;
 
-void ApiProcessor::sendJsonError(http::response<http::string_body>& res,
-    http::status status,
-    const std::string& message) {
-    bj::object err;
-    err["error"] = message;
-    res.result(status);
-    res.set(http::field::content_type, "application/json");
-    res.body() = bj::serialize(err);
-    res.prepare_payload();
-}
+        // Активные клиенты
+        auto active_clients_res = traced("sql.active_clients", [&] { return txn.exec("SELECT COUNT(*) FROM clients WHERE status = 'active'"); });
+        int active_clients = active_clients_res[0][0].as<int>();
 
-// Конвертеры
-bj::object ApiProcessor::clientToJson(const pqxx::row& row) {
-    bj::object obj;
-    obj["id"] = row["id"].as<int>();
-    obj["name"] = row["name"].c_str();
-    obj["contact"] = row["contact"].is_null() ? "" : row["contact"].c_str();
-    obj["status"] = row["status"].c_str();
-    obj["totalBudget"] = row["total_budget"].as<double>();
-    obj["campaignsCount"] = row["campaigns_count"].as<int>();
-    return obj;
-}
+        // Активные кампании и бюджеты
+        auto campaigns_agg = traced("sql.campaigns_agg", [&] { return txn.exec(R"(
+            SELECT 
+                COUNT(*) AS running_count,
+                COALESCE(SUM(budget), 0) AS total_budget,
+                COALESCE(SUM(spent), 0) AS total_spent
+            FROM campaigns 
+            WHERE status = 'running'
+        )"); });
+        int active_campaigns = campaigns_agg[0]["running_count"].as<int>();
+        double total_budget = campaigns_agg[0]["total_budget"].as<double>();
+        double total_spent = campaigns_agg[0]["total_spent"].as<double>();
 
-bj::object ApiProcessor::campaignToJson(const pqxx::row& row) {
-    bj::object obj;
-    obj["id"] = row["id"].as<int>();
-    obj["clientId"] = row["client_id"].as<int>();
-    obj["name"] = row["name"].c_str();
-    obj["status"] = row["status"].c_str();
-    obj["budget"] = row["budget"].as<double>();
-    obj["spent"] = row["spent"].as<double>();
+        // Средний ROI по завершённым кампаниям
+        auto roi_res = traced("sql.avg_roi", [&] { return txn.exec(R"(
+            SELECT AVG(roi) AS avg_roi 
+            FROM campaigns 
+            WHERE status = 'completed' AND roi IS NOT NULL
+        )"); });
+        double avg_roi = roi_res[0]["avg_roi"].is_null() ? 0.0 : roi_res[0]["avg_roi"].as<double>();
 
-    // start_date, end_date, roi — могут быть NULL
-    if (row["start_date"].is_null()) {
-        obj["startDate"] = nullptr;  // boost::json понимает nullptr как null
-    }
-    else {
-        obj["startDate"] = row["start_date"].c_str();
-    }
+        // Средняя загрузка команды
+        auto workload_res = traced("sql.avg_workload", [&] { return txn.exec("SELECT AVG(workload) AS avg_workload FROM team"); });
+        double team_workload = workload_res[0]["avg_workload"].is_null() ? 0.0 : workload_res[0]["avg_workload"].as<double>();
+        team_workload = std::round(team_workload);
 
-    if (row["end_date"].is_null()) {
-        obj["endDate"] = nullptr;
-    }
-    else {
-        obj["endDate"] = row["end_date"].c_str();
+        dashboard["activeClients"] = active_clients;
+        dashboard["activeCampaigns"] = active_campaigns;
+        dashboard["totalBudget"] = total_budget;
+        dashboard["totalSpent"] = total_spent;
+        dashboard["avgRoi"] = std::round(avg_roi * 100.0) / 100.0; // 2 знака
+        dashboard["teamWorkload"] = static_cast<int>(team_workload);
+        return dashboard;
     }
 
-    if (row["roi"].is_null()) {
-        obj["roi"] = nullptr;  // Вот здесь правильный способ!
+    bj::array idsOf(const pqxx::result& result) {
+        bj::array ids;
+        for (const auto& row : result) ids.emplace_back(row["id"].as<int>());
+        return ids;
     }
-    else {
-        obj["roi"] = row["roi"].as<double>();
-    }
-
-    return obj;
-}
-
-bj::object ApiProcessor::taskToJson(const pqxx::row& row) {
-    bj::object obj;
-    obj["id"] = row["id"].as<int>();
-    obj["campaignId"] = row["campaign_id"].as<int>();
 
-    if (row["assignee_id"].is_null()) {
-        obj["assigneeId"] = nullptr;
-    }
-    else {
-        obj["assigneeId"] = row["assignee_id"].as<int>();
+    bj::array arrayOf(bj::object obj) {
+        bj::array arr;
+        arr.emplace_back(std::move(obj));
+        return arr;
     }
 
-    obj["title"] = row["title"].c_str();
+    // Кампании и задачи клиента, которые заберёт ON DELETE CASCADE
+    struct ClientChildren {
+        bj::array campaigns;
+        bj::array tasks;
+    };
 
-    if (row["description"].is_null()) {
-        obj["description"] = nullptr;
-    }
-    else {
-        obj["description"] = row["description"].c_str();
+    // Каскад вручную, чтобы узнать удалённые id: ON DELETE CASCADE их не возвращает. Итог тот же
+    ClientChildren deleteClientChildren(pqxx::work& txn, int client_id) {
+        ClientChildren children;
+        children.tasks = idsOf(txn.exec_params(
+            "DELETE FROM tasks WHERE campaign_id IN (SELECT id FROM campaigns WHERE client_id = $1) RETURNING id", client_id));
+        children.campaigns = idsOf(txn.exec_params("DELETE FROM campaigns WHERE client_id = $1 RETURNING id", client_id));
+        return children;
     }
 
-    obj["status"] = row["status"].c_str();
-
-    if (row["due_date"].is_null()) {
-        obj["dueDate"] = nullptr;
+    ClientChildren selectClientChildren(pqxx::work& txn, int client_id) {
+        ClientChildren children;
+        children.tasks = idsOf(txn.exec_params(
+            "SELECT id FROM tasks WHERE campaign_id IN (SELECT id FROM campaigns WHERE client_id = $1) ORDER BY id", client_id));
+        children.campaigns = idsOf(txn.exec_params("SELECT id FROM campaigns WHERE client_id = $1 ORDER BY id", client_id));
+        return children;
     }
-    else {
-        obj["dueDate"] = row["due_date"].c_str();
+
+    bj::object countsOf(const ClientChildren& children) {
+        bj::object counts;
+        counts["campaigns"] = children.campaigns.size();
+        counts["tasks"] = children.tasks.size();
+        return counts;
     }
 
-    return obj;
-}
+    // "column = $N, " в SET и значение в params; N идёт следом за уже добавленными ($1 — id)
+    template <typename T>
+    void setParam(std::string& set_clause, pqxx::params& params, std::string_view column, const T& value) {
+        set_clause.append(column).append(" = $").append(std::to_string(params.size() + 1)).append(", ");
+        params.append(value);
+    }
 
-bj::object ApiProcessor::teamMemberToJson(const pqxx::row& row) {
-    bj::object obj;
-    obj["id"] = row["id"].as<int>();
-    obj["fullname"] = row["fullname"].c_str();
-    obj["role"] = row["role"].c_str();
-    obj["workload"] = row["workload"].as<double>();
-    return obj;
+    // Необязательная колонка: null в теле -> "column = NULL"
+    void setNullable(std::string& set_clause, pqxx::params& params, std::string_view column,
+        const std::optional<pqxx::zview>& value) {
+        if (value) setParam(set_clause, params, column, *value);
+        else set_clause.append(column).append(" = NULL, ");
+    }
 }
 
-std::optional<std::string> ApiProcessor::getQueryParam(const std::string& target,
-    const std::string& param_name) {
-    size_t pos = target.find('?');
-    if (pos == std::string::npos) return std::nullopt;
-
-    std::string query = target.substr(pos + 1);
-    std::vector<std::string> pairs;
-    boost::split(pairs, query, boost::is_any_of("&"));
+ApiProcessor::ApiProcessor(DatabaseModule* db_module) : db_module_(db_module) {}
 
-    for (const auto& pair : pairs) {
-        std::vector<std::string> kv;
-        boost::split(kv, pair, boost::is_any_of("="));
-        if (kv.size() == 2 && kv[0] == param_name) {
-            return kv[1];
-        }
+pqxx::connection* ApiProcessor::getConn() {
+    if (!db_module_ || !db_module_->isDatabaseReady()) {
+        return nullptr;
     }
-    return std::nullopt;
+    return db_module_->getConnection();
 }
 
-std::optional<int> ApiProcessor::parseIdFromPath(const std::string& path,
-    const std::string& prefix) {
-    std::regex re(prefix + "(\\d+)");
-    std::smatch match;
-    if (std::regex_search(path, match, re) && match.size() > 1) {
-        return std::stoi(match.str(1));
-    }
-    return std::nullopt;
+void ApiProcessor::sendJsonError(http::response<http::string_body>& res,
+    http::status status,
+    const std::string& message) {
+    bj::object err;
+    err["error"] = message;
+    res.result(status);
+    res.set(http::field::content_type, "application/json");
+    res.body() = bj::serialize(err);
+    res.prepare_payload();
 }
 
 void ApiProcessor::handleGetAllData(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.get_all_data");
     auto* conn = getConn();
     if (!conn) {
         return sendJsonError(res, http::status::service_unavailable, "Database not ready");
@@ -163,64 +162,16 @@ void ApiProcessor::handleGetAllData(const http::request<http::string_body>& req,
         pqxx::work txn(*conn);
 
         // Дашборд: вычисления на сервере
-        bj::object dashboard;
-
-        // Активные клиенты
-        auto active_clients_res = txn.exec("SELECT COUNT(*) FROM clients WHERE status = 'active'");
-        int active_clients = active_clients_res[0][0].as<int>();
-
-        // Активные кампании и бюджеты
-        auto campaigns_agg = txn.exec(R"(
-            SELECT 
-                COUNT(*) AS running_count,
-                COALESCE(SUM(budget), 0) AS total_budget,
-                COALESCE(SUM(spent), 0) AS total_spent
-            FROM campaigns 
-            WHERE status = 'running'
-        )");
-        int active_campaigns = campaigns_agg[0]["running_count"].as<int>();
-        double total_budget = campaigns_agg[0]["total_budget"].as<double>();
-        double total_spent = campaigns_agg[0]["total_spent"].as<double>();
-
-        // Средний ROI по завершённым кампаниям
-        auto roi_res = txn.exec(R"(
-            SELECT AVG(roi) AS avg_roi 
-            FROM campaigns 
-            WHERE status = 'completed' AND roi IS NOT NULL
-        )");
-        double avg_roi = roi_res[0]["avg_roi"].is_null() ? 0.0 : roi_res[0]["avg_roi"].as<double>();
-
-        // Средняя загрузка команды
-        auto workload_res = txn.exec("SELECT AVG(workload) AS avg_workload FROM team");
-        double team_workload = workload_res[0]["avg_workload"].is_null() ? 0.0 : workload_res[0]["avg_workload"].as<double>();
-        team_workload = std::round(team_workload);
-
-        dashboard["activeClients"] = active_clients;
-        dashboard["activeCampaigns"] = active_campaigns;
-        dashboard["totalBudget"] = total_budget;
-        dashboard["totalSpent"] = total_spent;
-        dashboard["avgRoi"] = std::round(avg_roi * 100.0) / 100.0; // 2 знака
-        dashboard["teamWorkload"] = static_cast<int>(team_workload);
+        bj::object dashboard = queryDashboard(txn);
 
         // Массивы данных
-        bj::array clients_arr;
-        auto clients_res = txn.exec("SELECT * FROM clients ORDER BY id");
-        for (const auto& row : clients_res) clients_arr.emplace_back(clientToJson(row));
-
-        bj::array campaigns_arr;
-        auto campaigns_res = txn.exec("SELECT * FROM campaigns ORDER BY id");
-        for (const auto& row : campaigns_res) campaigns_arr.emplace_back(campaignToJson(row));
-
-        bj::array tasks_arr;
-        auto tasks_res = txn.exec("SELECT * FROM tasks ORDER BY id");
-        for (const auto& row : tasks_res) tasks_arr.emplace_back(taskToJson(row));
-
-        bj::array team_arr;
-        auto team_res = txn.exec("SELECT * FROM team ORDER BY id");
-        for (const auto& row : team_res) team_arr.emplace_back(teamMemberToJson(row));
+        auto clients_res = traced("sql.clients", [&] { return txn.exec("SELECT * FROM clients ORDER BY id"); });
+        auto campaigns_res = traced("sql.campaigns", [&] { return txn.exec("SELECT * FROM campaigns ORDER BY id"); });
+        auto tasks_res = traced("sql.tasks", [&] { return txn.exec("SELECT * FROM tasks ORDER BY id"); });
+        auto team_res = traced("sql.team", [&] { return txn.exec("SELECT * FROM team ORDER BY id"); });
 
         // Последнее обновление
-        auto last_updated_res = txn.exec(R"(
+        auto last_updated_res = traced("sql.last_updated", [&] { return txn.exec(R"(
             SELECT GREATEST(
                 COALESCE(MAX(updated_at), '1970-01-01'::timestamp),
                 COALESCE(MAX(created_at), '1970-01-01'::timestamp)
@@ -234,22 +185,39 @@ void ApiProcessor::handleGetAllData(const http::request<http::string_body>& req,
                 UNION ALL
                 SELECT updated_at, created_at FROM team
             ) AS all_updates
-        )");
+        )"); });
 
         std::string last_updated = last_updated_res[0]["ts"].as<std::string>();
 
-        // Финальный ответ
-        bj::object response;
-        response["dashboard"] = dashboard;
-        response["clients"] = std::move(clients_arr);
-        response["campaigns"] = std::move(campaigns_arr);
-        response["tasks"] = std::move(tasks_arr);
-        response["team"] = std::move(team_arr);
-        response["lastUpdated"] = last_updated;
+        // Финальный ответ: строки пишутся текстом сразу в тело, в буфер, выделенный один раз.
+        // Тот же JSON, что у bj::serialize объекта {dashboard, clients, campaigns, tasks, team, lastUpdated}
+        ApiConverters::ClientWriter client_writer(clients_res);
+        ApiConverters::CampaignWriter campaign_writer(campaigns_res);
+        ApiConverters::TaskWriter task_writer(tasks_res);
+        ApiConverters::TeamMemberWriter team_writer(team_res);
+        std::string dashboard_json = bj::serialize(dashboard);
+
+        std::string body;
+        body.reserve(dashboard_json.size() + last_updated.size() + 128 + client_writer.estimate(clients_res)
+            + campaign_writer.estimate(campaigns_res) + task_writer.estimate(tasks_res) + team_writer.estimate(team_res));
+        JsonWriter out(body);
+        out.raw("{\"dashboard\":");
+        out.raw(dashboard_json);
+        out.raw(",\"clients\":");
+        traced("json.clients", [&] { ApiConverters::writeArray(out, client_writer, clients_res); });
+        out.raw(",\"campaigns\":");
+        traced("json.campaigns", [&] { ApiConverters::writeArray(out, campaign_writer, campaigns_res); });
+        out.raw(",\"tasks\":");
+        traced("json.tasks", [&] { ApiConverters::writeArray(out, task_writer, tasks_res); });
+        out.raw(",\"team\":");
+        traced("json.team", [&] { ApiConverters::writeArray(out, team_writer, team_res); });
+        out.raw(",\"lastUpdated\":");
+        out.string(last_updated);
+        out.raw('}');
 
         res.result(http::status::ok);
         res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(response);
+        res.body() = std::move(body);
         res.prepare_payload();
     }
     catch (const std::exception& e) {
@@ -257,26 +225,171 @@ void ApiProcessor::handleGetAllData(const http::request<http::string_body>& req,
     }
 }
 
+// ==================== ЧТЕНИЕ ИЗ ПАМЯТИ ====================
+
+namespace {
+    void sendJson(http::response<http::string_body>& res, const bj::value& json) {
+        res.result(http::status::ok);
+        res.set(http::field::content_type, "application/json");
+        res.body() = bj::serialize(json);
+        res.prepare_payload();
+    }
+}
+
+bool ApiProcessor::serveAllDataFromMemory(const http::request<http::string_body>& req,
+    http::response<http::string_body>& res, bool render_if_stale) {
+    if (!db_module_ || req.method() != http::verb::get) return false;
+    TraceSpan span("api.get_all_data_memory");
+    // FIXED: первый GET после записи рендерил весь документ на I/O-потоке под shared-блокировкой реплики
+    EntityStore& store = db_module_->entities();
+    auto body = render_if_stale ? store.allDataJson() : store.cachedAllDataJson();
+    if (!body) return false;
+
+    res.result(http::status::ok);
+    res.set(http::field::content_type, "application/json");
+    res.body() = *body;
+    res.prepare_payload();
+    return true;
+}
+
+void ApiProcessor::serveFromStore(const http::request<http::string_body>& req,
+    http::response<http::string_body>& res, const std::string& prefix,
+    const std::string& invalid_id, const std::string& not_found, const StoreLookup& lookup) {
+    auto id_opt = parseIdFromPath(std::string(req.target()), prefix);
+    if (!id_opt) return sendJsonError(res, http::status::bad_request, invalid_id);
+
+    EntityStore& store = db_module_->entities();
+    if (!store.isLoaded()) return sendJsonError(res, http::status::service_unavailable, "Data not loaded");
+
+    auto found = lookup(store, *id_opt);
+    if (!found) return sendJsonError(res, http::status::not_found, not_found);
+    sendJson(res, *found);
+}
+
+void ApiProcessor::handleGetClient(const http::request<http::string_body>& req,
+    http::response<http::string_body>& res) {
+    TraceSpan span("api.get_client");
+    serveFromStore(req, res, "/api/clients/", "Invalid client ID", "Client not found",
+        [](const EntityStore& store, int id) -> std::optional<bj::value> { return store.client(id); });
+}
+
+void ApiProcessor::handleGetCampaign(const http::request<http::string_body>& req,
+    http::response<http::string_body>& res) {
+    TraceSpan span("api.get_campaign");
+    serveFromStore(req, res, "/api/campaigns/", "Invalid campaign ID", "Campaign not found",
+        [](const EntityStore& store, int id) -> std::optional<bj::value> { return store.campaign(id); });
+}
+
+void ApiProcessor::handleGetTask(const http::request<http::string_body>& req,
+    http::response<http::string_body>& res) {
+    TraceSpan span("api.get_task");
+    serveFromStore(req, res, "/api/tasks/", "Invalid task ID", "Task not found",
+        [](const EntityStore& store, int id) -> std::optional<bj::value> { return store.task(id); });
+}
+
+void ApiProcessor::handleGetTeamMember(const http::request<http::string_body>& req,
+    http::response<http::string_body>& res) {
+    TraceSpan span("api.get_team_member");
+    serveFromStore(req, res, "/api/team/", "Invalid team member ID", "Team member not found",
+        [](const EntityStore& store, int id) -> std::optional<bj::value> { return store.teamMember(id); });
+}
+
+void ApiProcessor::handleGetClientCampaigns(const http::request<http::string_body>& req,
+    http::response<http::string_body>& res) {
+    TraceSpan span("api.get_client_campaigns");
+    serveFromStore(req, res, "/api/clients/", "Invalid client ID", "Client not found",
+        [](const EntityStore& store, int id) -> std::optional<bj::value> { return store.campaignsOfClient(id); });
+}
+
+void ApiProcessor::handleGetCampaignTasks(const http::request<http::string_body>& req,
+    http::response<http::string_body>& res) {
+    TraceSpan span("api.get_campaign_tasks");
+    serveFromStore(req, res, "/api/campaigns/", "Invalid campaign ID", "Campaign not found",
+        [](const EntityStore& store, int id) -> std::optional<bj::value> { return store.tasksOfCampaign(id); });
+}
+
+void ApiProcessor::handleGetTeamMemberTasks(const http::request<http::string_body>& req,
+    http::response<http::string_body>& res) {
+    TraceSpan span("api.get_team_member_tasks");
+    serveFromStore(req, res, "/api/team/", "Invalid team member ID", "Team member not found",
+        [](const EntityStore& store, int id) -> std::optional<bj::value> { return store.tasksOfAssignee(id); });
+}
+
+// ==================== ОТВЕТЫ ЗАПИСИ ====================
+
+ApiProcessor::MutationIncludes ApiProcessor::parseIncludes(const http::request<http::string_body>& req) {
+    MutationIncludes include;
+    auto value = getQueryParam(std::string(req.target()), "include");
+    if (!value) return include;
+    std::vector<std::string> parts;
+    boost::split(parts, *value, boost::is_any_of(","));
+    for (const auto& part : parts) {
+        if (part == "dashboard") include.dashboard = true;
+        else if (part == "cascade") include.cascade = true;
+        else if (part == "version") include.version = true;
+    }
+    return include;
+}
+
+void ApiProcessor::readExtras(pqxx::work& txn, const MutationIncludes& include, MutationExtras& extras) {
+    // currval — последний номер, выданный триггером в этой сессии, то есть версия именно этой записи.
+    // Нужен всегда: с ним write-through не затрёт более новое изменение, уже пришедшее через ChangeFeed
+    extras.data_version = txn.query_value<uint64_t>("SELECT currval('data_version_seq')");
+    if (include.version) extras.version = extras.data_version;
+    if (include.dashboard && !db_module_->entities().isLoaded()) {
+        extras.dashboard = queryDashboard(txn);
+    }
+}
+
+void ApiProcessor::sendMutation(http::response<http::string_body>& res, http::status status, bj::value data,
+    const MutationIncludes& include, MutationExtras&& extras) {
+    res.result(status);
+    res.set(http::field::content_type, "application/json");
+    if (!include.any()) {
+        res.body() = bj::serialize(data);
+        res.prepare_payload();
+        return;
+    }
+
+    bj::object envelope;
+    envelope["data"] = std::move(data);
+    if (include.dashboard) {
+        if (!extras.dashboard) extras.dashboard = db_module_->entities().dashboardJson();
+        // Реплику сбросили между commit и ответом — клиент посчитает дашборд сам
+        if (extras.dashboard) envelope["dashboard"] = std::move(*extras.dashboard);
+    }
+    if (include.cascade) {
+        bj::object cascade;
+        cascade["deleted"] = std::move(extras.deleted);
+        cascade["updated"] = std::move(extras.updated);
+        envelope["cascade"] = std::move(cascade);
+    }
+    if (include.version && extras.version) {
+        envelope["version"] = *extras.version;
+    }
+    res.body() = bj::serialize(envelope);
+    res.prepare_payload();
+}
+
 // ==================== CLIENTS ====================
 
 void ApiProcessor::handleAddClient(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.add_client");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
     if (req.method() != http::verb::post)
         return sendJsonError(res, http::status::method_not_allowed, "Only POST allowed");
 
+    MutationIncludes include = parseIncludes(req);
     try {
-        bj::value jv = bj::parse(req.body());
-        if (!jv.is_object()) return sendJsonError(res, http::status::bad_request, "Expected JSON object");
-        const bj::object& body = jv.as_object();
+        JsonBody body;
+        if (!body.parse(req.body())) return sendJsonError(res, body.errorStatus(), body.error());
 
-        std::string name = body.at("name").as_string().c_str();
-        std::optional<std::string> contact = body.contains("contact") && !body.at("contact").is_null()
-            ? std::make_optional(std::string(body.at("contact").as_string().c_str()))
-            : std::nullopt;
-        std::string status = body.contains("status") ? std::string(body.at("status").as_string().c_str()) : "prospect";
+        pqxx::zview name = body.text("name");
+        std::optional<pqxx::zview> contact = body.optionalText("contact");
+        pqxx::zview status = body.textOr("status", "prospect");
 
         if (name.empty()) return sendJsonError(res, http::status::bad_request, "Name is required");
 
@@ -284,13 +397,13 @@ void ApiProcessor::handleAddClient(const http::request<http::string_body>& req,
         pqxx::row r = txn.exec_params1(
             "INSERT INTO clients (name, contact, status) VALUES ($1, $2, $3) RETURNING *",
             name, contact, status);
+        MutationExtras extras;
+        readExtras(txn, include, extras);
 
         txn.commit();
+        db_module_->entities().upsert(Entities::clientFromRow(r), extras.data_version);
 
-        res.result(http::status::created);
-        res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(clientToJson(r));
-        res.prepare_payload();
+        sendMutation(res, http::status::created, clientToJson(r), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::bad_request, std::string("Invalid data: ") + e.what());
@@ -299,6 +412,7 @@ void ApiProcessor::handleAddClient(const http::request<http::string_body>& req,
 
 void ApiProcessor::handleUpdateClient(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.update_client");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
@@ -309,32 +423,19 @@ void ApiProcessor::handleUpdateClient(const http::request<http::string_body>& re
     if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid client ID");
     int id = *id_opt;
 
+    MutationIncludes include = parseIncludes(req);
     try {
-        bj::value jv = bj::parse(req.body());
-        if (!jv.is_object()) return sendJsonError(res, http::status::bad_request, "Expected JSON object");
-        const bj::object& body = jv.as_object();
+        JsonBody body;
+        if (!body.parse(req.body())) return sendJsonError(res, body.errorStatus(), body.error());
 
         std::string set_clause;
-        std::vector<std::string> params;
-        params.push_back(std::to_string(id));
+        pqxx::params params;
+        params.append(id);  // $1 = id
 
-        if (body.contains("name")) {
-            set_clause += "name = $" + std::to_string(params.size() + 1) + ", ";
-            params.push_back(std::string(body.at("name").as_string().c_str()));
-        }
-        if (body.contains("contact")) {
-            if (body.at("contact").is_null()) {
-                set_clause += "contact = NULL, ";
-            }
-            else {
-                set_clause += "contact = $" + std::to_string(params.size() + 1) + ", ";
-                params.push_back(std::string(body.at("contact").as_string().c_str()));
-            }
-        }
-        if (body.contains("status")) {
-            set_clause += "status = $" + std::to_string(params.size() + 1) + ", ";
-            params.push_back(std::string(body.at("status").as_string().c_str()));
-        }
+        // Строки идут в params как zview на буфер JsonBody — без копий
+        if (body.has("name")) setParam(set_clause, params, "name", body.text("name"));
+        if (body.has("contact")) setNullable(set_clause, params, "contact", body.optionalText("contact"));
+        if (body.has("status")) setParam(set_clause, params, "status", body.text("status"));
 
         if (set_clause.empty()) return sendJsonError(res, http::status::bad_request, "No fields to update");
 
@@ -345,13 +446,13 @@ void ApiProcessor::handleUpdateClient(const http::request<http::string_body>& re
             "UPDATE clients SET " + set_clause + " WHERE id = $1 RETURNING *", params);
 
         if (result.empty()) return sendJsonError(res, http::status::not_found, "Client not found");
+        MutationExtras extras;
+        readExtras(txn, include, extras);
 
         txn.commit();
+        db_module_->entities().upsert(Entities::clientFromRow(result[0]), extras.data_version);
 
-        res.result(http::status::ok);
-        res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(clientToJson(result[0]));
-        res.prepare_payload();
+        sendMutation(res, http::status::ok, clientToJson(result[0]), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::bad_request, e.what());
@@ -360,6 +461,7 @@ void ApiProcessor::handleUpdateClient(const http::request<http::string_body>& re
 
 void ApiProcessor::handleDeleteClient(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.delete_client");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
@@ -370,18 +472,91 @@ void ApiProcessor::handleDeleteClient(const http::request<http::string_body>& re
     if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid client ID");
     int id = *id_opt;
 
+    MutationIncludes include = parseIncludes(req);
     try {
         pqxx::work txn(*conn);
+        MutationExtras extras;
+        if (include.cascade) {
+            auto children = deleteClientChildren(txn, id);
+            extras.deleted["campaigns"] = std::move(children.campaigns);
+            extras.deleted["tasks"] = std::move(children.tasks);
+        }
         auto result = txn.exec_params("DELETE FROM clients WHERE id = $1 RETURNING id", id);
 
         if (result.empty()) return sendJsonError(res, http::status::not_found, "Client not found");
+        readExtras(txn, include, extras);
 
         txn.commit();
-        res.result(http::status::ok);
-        res.set(http::field::content_type, "application/json");
+        db_module_->entities().eraseClient(id, extras.data_version);  // Вместе с кампаниями и их задачами, как ON DELETE CASCADE
         bj::object obj; obj["deletedId"] = id;
-        res.body() = bj::serialize(obj);
-        res.prepare_payload();
+        sendMutation(res, http::status::ok, std::move(obj), include, std::move(extras));
+    }
+    catch (const std::exception& e) {
+        sendJsonError(res, http::status::internal_server_error, e.what());
+    }
+}
+
+void ApiProcessor::handleDeleteClientCascade(const http::request<http::string_body>& req,
+    http::response<http::string_body>& res) {
+    TraceSpan span("api.delete_client_cascade");
+    auto* conn = getConn();
+    if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
+
+    if (req.method() != http::verb::delete_)
+        return sendJsonError(res, http::status::method_not_allowed, "Only DELETE allowed");
+
+    std::string target(req.target());
+    auto id_opt = parseIdFromPath(target, "/api/clients/");
+    if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid client ID");
+    int id = *id_opt;
+
+    auto dry_run = getQueryParam(target, "dryRun");
+    MutationIncludes include = parseIncludes(req);
+    try {
+        pqxx::work txn(*conn);
+        if (dry_run == std::optional<std::string>("true") || dry_run == std::optional<std::string>("1")) {
+            // Предпросмотр: те же выборки, что у удаления, без записи
+            auto client = txn.exec_params("SELECT id FROM clients WHERE id = $1", id);
+            if (client.empty()) return sendJsonError(res, http::status::not_found, "Client not found");
+            auto children = selectClientChildren(txn, id);
+
+            bj::object affected;
+            affected["campaigns"] = children.campaigns;
+            affected["tasks"] = children.tasks;
+            bj::object obj;
+            obj["dryRun"] = true;
+            obj["clientId"] = id;
+            obj["counts"] = countsOf(children);
+            obj["affected"] = std::move(affected);
+            res.result(http::status::ok);
+            res.set(http::field::content_type, "application/json");
+            res.body() = bj::serialize(obj);
+            res.prepare_payload();
+            return;
+        }
+
+        auto children = deleteClientChildren(txn, id);
+        auto result = txn.exec_params("DELETE FROM clients WHERE id = $1 RETURNING id", id);
+
+        if (result.empty()) return sendJsonError(res, http::status::not_found, "Client not found");
+        MutationExtras extras;
+        if (include.cascade) {
+            extras.deleted["campaigns"] = children.campaigns;
+            extras.deleted["tasks"] = children.tasks;
+        }
+        readExtras(txn, include, extras);
+
+        txn.commit();
+        db_module_->entities().eraseClient(id, extras.data_version);
+
+        bj::object deleted;
+        deleted["campaigns"] = children.campaigns;
+        deleted["tasks"] = children.tasks;
+        bj::object obj;
+        obj["deletedId"] = id;
+        obj["counts"] = countsOf(children);
+        obj["deleted"] = std::move(deleted);
+        sendMutation(res, http::status::ok, std::move(obj), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::internal_server_error, e.what());
@@ -392,21 +567,23 @@ void ApiProcessor::handleDeleteClient(const http::request<http::string_body>& re
 
 void ApiProcessor::handleAddCampaign(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.add_campaign");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
     if (req.method() != http::verb::post)
         return sendJsonError(res, http::status::method_not_allowed, "Only POST allowed");
 
+    MutationIncludes include = parseIncludes(req);
     try {
-        bj::value jv = bj::parse(req.body());
-        if (!jv.is_object()) return sendJsonError(res, http::status::bad_request, "Expected JSON object");
-        const bj::object& body = jv.as_object();
+        JsonBody body;
+        if (!body.parse(req.body())) return sendJsonError(res, body.errorStatus(), body.error());
 
-        int client_id = body.at("clientId").as_int64();
-        std::string name = body.at("name").as_string().c_str();
-        std::string status = body.contains("status") ? std::string(body.at("status").as_string().c_str()) : "planning";
-        double budget = body.contains("budget") ? body.at("budget").as_double() : 0.0;
+        int client_id = body.id("clientId");
+        pqxx::zview name = body.text("name");
+        pqxx::zview status = body.textOr("status", "planning");
+        // FIXED: as_double() бросал на целом JSON ("budget": 50000)
+        double budget = body.numberOr("budget", 0.0);
 
         pqxx::work txn(*conn);
         // Проверка существования клиента
@@ -416,13 +593,17 @@ void ApiProcessor::handleAddCampaign(const http::request<http::string_body>& req
         pqxx::row r = txn.exec_params1(
             "INSERT INTO campaigns (client_id, name, status, budget) VALUES ($1, $2, $3, $4) RETURNING *",
             client_id, name, status, budget);
+        // Счётчики клиента пересчитал триггер — читаем их в той же транзакции
+        pqxx::row client = txn.exec_params1("SELECT * FROM clients WHERE id = $1", client_id);
+        MutationExtras extras;
+        if (include.cascade) extras.updated["clients"] = arrayOf(clientToJson(client));
+        readExtras(txn, include, extras);
 
         txn.commit();
+        db_module_->entities().upsert(Entities::campaignFromRow(r), extras.data_version);
+        db_module_->entities().upsert(Entities::clientFromRow(client), extras.data_version);
 
-        res.result(http::status::created);
-        res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(campaignToJson(r));
-        res.prepare_payload();
+        sendMutation(res, http::status::created, campaignToJson(r), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::bad_request, e.what());
@@ -431,6 +612,7 @@ void ApiProcessor::handleAddCampaign(const http::request<http::string_body>& req
 
 void ApiProcessor::handleUpdateCampaign(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.update_campaign");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
@@ -438,84 +620,45 @@ void ApiProcessor::handleUpdateCampaign(const http::request<http::string_body>&
     if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid campaign ID");
     int id = *id_opt;
 
+    MutationIncludes include = parseIncludes(req);
     try {
-        bj::value jv = bj::parse(req.body());
-        if (!jv.is_object()) return sendJsonError(res, http::status::bad_request, "Expected JSON object");
-        const bj::object& body = jv.as_object();
+        JsonBody body;
+        if (!body.parse(req.body())) return sendJsonError(res, body.errorStatus(), body.error());
 
         std::string set_clause;
-        std::vector<std::string> params;
-        params.emplace_back(std::to_string(id));  // $1 = id
-
-        if (body.contains("name")) {
-            set_clause += "name = $" + std::to_string(params.size() + 1) + ", ";
-            params.emplace_back(body.at("name").as_string().c_str());
-        }
-        if (body.contains("status")) {
-            set_clause += "status = $" + std::to_string(params.size() + 1) + ", ";
-            params.emplace_back(body.at("status").as_string().c_str());
-        }
-        if (body.contains("budget")) {
-            set_clause += "budget = $" + std::to_string(params.size() + 1) + ", ";
-            params.emplace_back(std::to_string(body.at("budget").as_double()));
-        }
-        if (body.contains("spent")) {
-            set_clause += "spent = $" + std::to_string(params.size() + 1) + ", ";
-            params.emplace_back(std::to_string(body.at("spent").as_double()));
-        }
-        if (body.contains("startDate")) {
-            if (body.at("startDate").is_null()) {
-                set_clause += "start_date = NULL, ";
-            }
-            else {
-                set_clause += "start_date = $" + std::to_string(params.size() + 1) + ", ";
-                params.emplace_back(body.at("startDate").as_string().c_str());
-            }
-        }
-        if (body.contains("endDate")) {
-            if (body.at("endDate").is_null()) {
-                set_clause += "end_date = NULL, ";
-            }
-            else {
-                set_clause += "end_date = $" + std::to_string(params.size() + 1) + ", ";
-                params.emplace_back(body.at("endDate").as_string().c_str());
-            }
-        }
-        if (body.contains("roi")) {
-            if (body.at("roi").is_null()) {
-                set_clause += "roi = NULL, ";
-            }
-            else {
-                set_clause += "roi = $" + std::to_string(params.size() + 1) + ", ";
-                params.emplace_back(std::to_string(body.at("roi").as_double()));
-            }
+        pqxx::params params;
+        params.append(id);  // $1 = id
+
+        if (body.has("name")) setParam(set_clause, params, "name", body.text("name"));
+        if (body.has("status")) setParam(set_clause, params, "status", body.text("status"));
+        // Числа — как пришли (целые тоже), без std::to_string с его шестью знаками после запятой
+        if (body.has("budget")) setParam(set_clause, params, "budget", body.number("budget"));
+        if (body.has("spent")) setParam(set_clause, params, "spent", body.number("spent"));
+        if (body.has("startDate")) setNullable(set_clause, params, "start_date", body.optionalText("startDate"));
+        if (body.has("endDate")) setNullable(set_clause, params, "end_date", body.optionalText("endDate"));
+        if (body.has("roi")) {
+            if (body.isNull("roi")) set_clause += "roi = NULL, ";
+            else setParam(set_clause, params, "roi", body.number("roi"));
         }
 
         if (set_clause.empty()) return sendJsonError(res, http::status::bad_request, "No fields to update");
         set_clause.pop_back(); set_clause.pop_back(); // удаляем ", "
 
         pqxx::work txn(*conn);
-        std::string query = "UPDATE campaigns SET " + set_clause + " WHERE id = $1 RETURNING *";
-
-        pqxx::result result;
-        if (params.size() == 1) {
-            result = txn.exec(query);  // только id
-        }
-        else {
-            std::vector<pqxx::zview> zparams;
-            for (size_t i = 1; i < params.size(); ++i)  // пропускаем $1 (id)
-                zparams.emplace_back(params[i]);
-            result = txn.exec_params(query, zparams);
-        }
+        // FIXED: раньше id ($1) не передавался, и номера параметров съезжали на один
+        pqxx::result result = txn.exec_params("UPDATE campaigns SET " + set_clause + " WHERE id = $1 RETURNING *", params);
 
         if (result.empty()) return sendJsonError(res, http::status::not_found, "Campaign not found");
+        auto client = txn.exec_params("SELECT * FROM clients WHERE id = $1", result[0]["client_id"].as<int>());
+        MutationExtras extras;
+        if (include.cascade && !client.empty()) extras.updated["clients"] = arrayOf(clientToJson(client[0]));
+        readExtras(txn, include, extras);
 
         txn.commit();
+        db_module_->entities().upsert(Entities::campaignFromRow(result[0]), extras.data_version);
+        if (!client.empty()) db_module_->entities().upsert(Entities::clientFromRow(client[0]), extras.data_version);
 
-        res.result(http::status::ok);
-        res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(campaignToJson(result[0]));
-        res.prepare_payload();
+        sendMutation(res, http::status::ok, campaignToJson(result[0]), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::bad_request, e.what());
@@ -524,6 +667,7 @@ void ApiProcessor::handleUpdateCampaign(const http::request<http::string_body>&
 
 void ApiProcessor::handleDeleteCampaign(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.delete_campaign");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
@@ -531,17 +675,25 @@ void ApiProcessor::handleDeleteCampaign(const http::request<http::string_body>&
     if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid campaign ID");
     int id = *id_opt;
 
+    MutationIncludes include = parseIncludes(req);
     try {
         pqxx::work txn(*conn);
-        auto result = txn.exec_params("DELETE FROM campaigns WHERE id = $1 RETURNING id", id);
+        MutationExtras extras;
+        if (include.cascade) {
+            extras.deleted["tasks"] = idsOf(txn.exec_params("DELETE FROM tasks WHERE campaign_id = $1 RETURNING id", id));
+        }
+        auto result = txn.exec_params("DELETE FROM campaigns WHERE id = $1 RETURNING id, client_id", id);
 
         if (result.empty()) return sendJsonError(res, http::status::not_found, "Campaign not found");
+        auto client = txn.exec_params("SELECT * FROM clients WHERE id = $1", result[0]["client_id"].as<int>());
+        if (include.cascade && !client.empty()) extras.updated["clients"] = arrayOf(clientToJson(client[0]));
+        readExtras(txn, include, extras);
 
         txn.commit();
-        res.result(http::status::ok);
+        db_module_->entities().eraseCampaign(id, extras.data_version);
+        if (!client.empty()) db_module_->entities().upsert(Entities::clientFromRow(client[0]), extras.data_version);
         bj::object obj; obj["deletedId"] = id;
-        res.body() = bj::serialize(obj);
-        res.prepare_payload();
+        sendMutation(res, http::status::ok, std::move(obj), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::internal_server_error, e.what());
@@ -552,26 +704,21 @@ void ApiProcessor::handleDeleteCampaign(const http::request<http::string_body>&
 
 void ApiProcessor::handleAddTask(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.add_task");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
+    MutationIncludes include = parseIncludes(req);
     try {
-        bj::value jv = bj::parse(req.body());
-        if (!jv.is_object()) return sendJsonError(res, http::status::bad_request, "Expected JSON object");
-        const bj::object& body = jv.as_object();
-
-        int campaign_id = body.at("campaignId").as_int64();
-        std::optional<int> assignee_id = body.contains("assigneeId") && !body.at("assigneeId").is_null()
-            ? std::make_optional(static_cast<int>(body.at("assigneeId").as_int64()))
-            : std::nullopt;
-        std::string title = body.at("title").as_string().c_str();
-        std::optional<std::string> description = body.contains("description") && !body.at("description").is_null()
-            ? std::make_optional(std::string(body.at("description").as_string().c_str()))
-            : std::nullopt;
-        std::string status = body.contains("status") ? std::string(body.at("status").as_string().c_str()) : "todo";
-        std::optional<std::string> due_date = body.contains("dueDate") && !body.at("dueDate").is_null()
-            ? std::make_optional(std::string(body.at("dueDate").as_string().c_str()))
-            : std::nullopt;
+        JsonBody body;
+        if (!body.parse(req.body())) return sendJsonError(res, body.errorStatus(), body.error());
+
+        int campaign_id = body.id("campaignId");
+        std::optional<int> assignee_id = body.optionalId("assigneeId");
+        pqxx::zview title = body.text("title");
+        std::optional<pqxx::zview> description = body.optionalText("description");
+        pqxx::zview status = body.textOr("status", "todo");
+        std::optional<pqxx::zview> due_date = body.optionalText("dueDate");
 
         pqxx::work txn(*conn);
         if (txn.query_value<int>("SELECT 1 FROM campaigns WHERE id = $1", campaign_id) != 1)
@@ -581,12 +728,13 @@ void ApiProcessor::handleAddTask(const http::request<http::string_body>& req,
             "INSERT INTO tasks (campaign_id, assignee_id, title, description, status, due_date) "
             "VALUES ($1, $2, $3, $4, $5, $6) RETURNING *",
             campaign_id, assignee_id, title, description, status, due_date);
+        MutationExtras extras;
+        readExtras(txn, include, extras);
 
         txn.commit();
+        db_module_->entities().upsert(Entities::taskFromRow(r), extras.data_version);
 
-        res.result(http::status::created);
-        res.body() = bj::serialize(taskToJson(r));
-        res.prepare_payload();
+        sendMutation(res, http::status::created, taskToJson(r), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::bad_request, e.what());
@@ -595,6 +743,7 @@ void ApiProcessor::handleAddTask(const http::request<http::string_body>& req,
 
 void ApiProcessor::handleUpdateTask(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.update_task");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
@@ -602,76 +751,39 @@ void ApiProcessor::handleUpdateTask(const http::request<http::string_body>& req,
     if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid task ID");
     int id = *id_opt;
 
+    MutationIncludes include = parseIncludes(req);
     try {
-        bj::value jv = bj::parse(req.body());
-        if (!jv.is_object()) return sendJsonError(res, http::status::bad_request, "Expected JSON object");
-        const bj::object& body = jv.as_object();
+        JsonBody body;
+        if (!body.parse(req.body())) return sendJsonError(res, body.errorStatus(), body.error());
 
         std::string set_clause;
-        std::vector<std::string> params;
-        params.emplace_back(std::to_string(id));
-
-        if (body.contains("title")) {
-            set_clause += "title = $" + std::to_string(params.size() + 1) + ", ";
-            params.emplace_back(body.at("title").as_string().c_str());
-        }
-        if (body.contains("description")) {
-            if (body.at("description").is_null()) {
-                set_clause += "description = NULL, ";
-            }
-            else {
-                set_clause += "description = $" + std::to_string(params.size() + 1) + ", ";
-                params.emplace_back(body.at("description").as_string().c_str());
-            }
-        }
-        if (body.contains("status")) {
-            set_clause += "status = $" + std::to_string(params.size() + 1) + ", ";
-            params.emplace_back(body.at("status").as_string().c_str());
-        }
-        if (body.contains("dueDate")) {
-            if (body.at("dueDate").is_null()) {
-                set_clause += "due_date = NULL, ";
-            }
-            else {
-                set_clause += "due_date = $" + std::to_string(params.size() + 1) + ", ";
-                params.emplace_back(body.at("dueDate").as_string().c_str());
-            }
-        }
-        if (body.contains("assigneeId")) {
-            if (body.at("assigneeId").is_null()) {
-                set_clause += "assignee_id = NULL, ";
-            }
-            else {
-                set_clause += "assignee_id = $" + std::to_string(params.size() + 1) + ", ";
-                params.emplace_back(std::to_string(body.at("assigneeId").as_int64()));
-            }
+        pqxx::params params;
+        params.append(id);  // $1 = id
+
+        if (body.has("title")) setParam(set_clause, params, "title", body.text("title"));
+        if (body.has("description")) setNullable(set_clause, params, "description", body.optionalText("description"));
+        if (body.has("status")) setParam(set_clause, params, "status", body.text("status"));
+        if (body.has("dueDate")) setNullable(set_clause, params, "due_date", body.optionalText("dueDate"));
+        if (body.has("assigneeId")) {
+            if (body.isNull("assigneeId")) set_clause += "assignee_id = NULL, ";
+            else setParam(set_clause, params, "assignee_id", body.id("assigneeId"));
         }
 
         if (set_clause.empty()) return sendJsonError(res, http::status::bad_request, "No fields to update");
         set_clause.pop_back(); set_clause.pop_back();
 
         pqxx::work txn(*conn);
-        std::string query = "UPDATE tasks SET " + set_clause + " WHERE id = $1 RETURNING *";
-
-        pqxx::result result;
-        if (params.size() == 1) {
-            result = txn.exec(query);
-        }
-        else {
-            std::vector<pqxx::zview> zparams;
-            for (size_t i = 1; i < params.size(); ++i)
-                zparams.emplace_back(params[i]);
-            result = txn.exec_params(query, zparams);
-        }
+        // FIXED: id ($1) теперь передаётся вместе с остальными параметрами
+        pqxx::result result = txn.exec_params("UPDATE tasks SET " + set_clause + " WHERE id = $1 RETURNING *", params);
 
         if (result.empty()) return sendJsonError(res, http::status::not_found, "Task not found");
+        MutationExtras extras;
+        readExtras(txn, include, extras);
 
         txn.commit();
+        db_module_->entities().upsert(Entities::taskFromRow(result[0]), extras.data_version);
 
-        res.result(http::status::ok);
-        res.set(http::field::content_type, "application/json");
-        res.body() = bj::serialize(taskToJson(result[0]));
-        res.prepare_payload();
+        sendMutation(res, http::status::ok, taskToJson(result[0]), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::bad_request, e.what());
@@ -680,6 +792,7 @@ void ApiProcessor::handleUpdateTask(const http::request<http::string_body>& req,
 
 void ApiProcessor::handleDeleteTask(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.delete_task");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
@@ -687,17 +800,19 @@ void ApiProcessor::handleDeleteTask(const http::request<http::string_body>& req,
     if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid task ID");
     int id = *id_opt;
 
+    MutationIncludes include = parseIncludes(req);
     try {
         pqxx::work txn(*conn);
         auto result = txn.exec_params("DELETE FROM tasks WHERE id = $1 RETURNING id", id);
 
         if (result.empty()) return sendJsonError(res, http::status::not_found, "Task not found");
+        MutationExtras extras;
+        readExtras(txn, include, extras);
 
         txn.commit();
-        res.result(http::status::ok);
+        db_module_->entities().eraseTask(id, extras.data_version);
         bj::object obj; obj["deletedId"] = id;
-        res.body() = bj::serialize(obj);
-        res.prepare_payload();
+        sendMutation(res, http::status::ok, std::move(obj), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::internal_server_error, e.what());
@@ -708,17 +823,18 @@ void ApiProcessor::handleDeleteTask(const http::request<http::string_body>& req,
 
 void ApiProcessor::handleAddTeamMember(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.add_team_member");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
+    MutationIncludes include = parseIncludes(req);
     try {
-        bj::value jv = bj::parse(req.body());
-        if (!jv.is_object()) return sendJsonError(res, http::status::bad_request, "Expected JSON object");
-        const bj::object& body = jv.as_object();
+        JsonBody body;
+        if (!body.parse(req.body())) return sendJsonError(res, body.errorStatus(), body.error());
 
-        std::string fullname = body.at("fullname").as_string().c_str();
-        std::string role = body.at("role").as_string().c_str();
-        double workload = body.contains("workload") ? body.at("workload").as_double() : 0.0;
+        pqxx::zview fullname = body.text("fullname");
+        pqxx::zview role = body.text("role");
+        double workload = body.numberOr("workload", 0.0);
 
         if (fullname.empty() || role.empty()) return sendJsonError(res, http::status::bad_request, "fullname and role required");
 
@@ -726,12 +842,13 @@ void ApiProcessor::handleAddTeamMember(const http::request<http::string_body>& r
         pqxx::row r = txn.exec_params1(
             "INSERT INTO team (fullname, role, workload) VALUES ($1, $2, $3) RETURNING *",
             fullname, role, workload);
+        MutationExtras extras;
+        readExtras(txn, include, extras);
 
         txn.commit();
+        db_module_->entities().upsert(Entities::teamMemberFromRow(r), extras.data_version);
 
-        res.result(http::status::created);
-        res.body() = bj::serialize(teamMemberToJson(r));
-        res.prepare_payload();
+        sendMutation(res, http::status::created, teamMemberToJson(r), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::bad_request, e.what());
@@ -740,6 +857,7 @@ void ApiProcessor::handleAddTeamMember(const http::request<http::string_body>& r
 
 void ApiProcessor::handleUpdateTeamMember(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.update_team_member");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
@@ -747,17 +865,18 @@ void ApiProcessor::handleUpdateTeamMember(const http::request<http::string_body>
     if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid team member ID");
     int id = *id_opt;
 
+    MutationIncludes include = parseIncludes(req);
     try {
-        bj::value jv = bj::parse(req.body());
-        if (!jv.is_object()) return sendJsonError(res, http::status::bad_request, "Expected JSON object");
-        const bj::object& body = jv.as_object();
+        JsonBody body;
+        if (!body.parse(req.body())) return sendJsonError(res, body.errorStatus(), body.error());
 
         std::string set_clause;
-        std::vector<std::string> params{ std::to_string(id) };
+        pqxx::params params;
+        params.append(id);  // $1 = id
 
-        if (body.contains("fullname")) { set_clause += "fullname = $" + std::to_string(params.size() + 1) + ", "; params.push_back(body.at("fullname").as_string().c_str()); }
-        if (body.contains("role")) { set_clause += "role = $" + std::to_string(params.size() + 1) + ", "; params.push_back(body.at("role").as_string().c_str()); }
-        if (body.contains("workload")) { set_clause += "workload = $" + std::to_string(params.size() + 1) + ", "; params.push_back(std::to_string(body.at("workload").as_double())); }
+        if (body.has("fullname")) setParam(set_clause, params, "fullname", body.text("fullname"));
+        if (body.has("role")) setParam(set_clause, params, "role", body.text("role"));
+        if (body.has("workload")) setParam(set_clause, params, "workload", body.number("workload"));
 
         if (set_clause.empty()) return sendJsonError(res, http::status::bad_request, "No fields to update");
 
@@ -767,12 +886,13 @@ void ApiProcessor::handleUpdateTeamMember(const http::request<http::string_body>
         auto result = txn.exec_params("UPDATE team SET " + set_clause + " WHERE id = $1 RETURNING *", params);
 
         if (result.empty()) return sendJsonError(res, http::status::not_found, "Team member not found");
+        MutationExtras extras;
+        readExtras(txn, include, extras);
 
         txn.commit();
+        db_module_->entities().upsert(Entities::teamMemberFromRow(result[0]), extras.data_version);
 
-        res.result(http::status::ok);
-        res.body() = bj::serialize(teamMemberToJson(result[0]));
-        res.prepare_payload();
+        sendMutation(res, http::status::ok, teamMemberToJson(result[0]), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::bad_request, e.what());
@@ -781,6 +901,7 @@ void ApiProcessor::handleUpdateTeamMember(const http::request<http::string_body>
 
 void ApiProcessor::handleDeleteTeamMember(const http::request<http::string_body>& req,
     http::response<http::string_body>& res) {
+    TraceSpan span("api.delete_team_member");
     auto* conn = getConn();
     if (!conn) return sendJsonError(res, http::status::service_unavailable, "Database not ready");
 
@@ -788,17 +909,26 @@ void ApiProcessor::handleDeleteTeamMember(const http::request<http::string_body>
     if (!id_opt) return sendJsonError(res, http::status::bad_request, "Invalid team member ID");
     int id = *id_opt;
 
+    MutationIncludes include = parseIncludes(req);
     try {
         pqxx::work txn(*conn);
+        MutationExtras extras;
+        if (include.cascade) {
+            // То же, что сделает ON DELETE SET NULL, но с RETURNING: клиенту нужны изменённые задачи
+            auto tasks = txn.exec_params("UPDATE tasks SET assignee_id = NULL WHERE assignee_id = $1 RETURNING *", id);
+            bj::array rows;
+            for (const auto& row : tasks) rows.emplace_back(taskToJson(row));
+            extras.updated["tasks"] = std::move(rows);
+        }
         auto result = txn.exec_params("DELETE FROM team WHERE id = $1 RETURNING id", id);
 
         if (result.empty()) return sendJsonError(res, http::status::not_found, "Team member not found");
+        readExtras(txn, include, extras);
 
         txn.commit();
-        res.result(http::status::ok);
+        db_module_->entities().eraseTeamMember(id, extras.data_version);  // assignee_id задач -> NULL, как ON DELETE SET NULL
         bj::object obj; obj["deletedId"] = id;
-        res.body() = bj::serialize(obj);
-        res.prepare_payload();
+        sendMutation(res, http::status::ok, std::move(obj), include, std::move(extras));
     }
     catch (const std::exception& e) {
         sendJsonError(res, http::status::internal_server_error, e.what());
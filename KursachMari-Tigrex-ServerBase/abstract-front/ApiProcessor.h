@@ -2,12 +2,15 @@
 
 #include <boost/json.hpp>
 #include <pqxx/pqxx>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <optional>
 
 #include "macros.h"  // Для http::request, http::response и т.д.
 
 class DatabaseModule;
+class EntityStore;
 
 namespace bj = boost::json;
 namespace http = boost::beast::http;
@@ -22,14 +25,39 @@ private:
         http::status status,
         const std::string& message);
 
-    // Конвертеры в JSON для фронтенда
-    bj::object clientToJson(const pqxx::row& row);
-    bj::object campaignToJson(const pqxx::row& row);
-    bj::object taskToJson(const pqxx::row& row);
-    bj::object teamMemberToJson(const pqxx::row& row);
+    // GET по id из EntityStore: разбор id, 503 до загрузки реплики, 404 без записи
+    using StoreLookup = std::function<std::optional<bj::value>(const EntityStore& store, int id)>;
+    void serveFromStore(const http::request<http::string_body>& req, http::response<http::string_body>& res,
+        const std::string& prefix, const std::string& invalid_id, const std::string& not_found, const StoreLookup& lookup);
 
-    std::optional<std::string> getQueryParam(const std::string& target, const std::string& param_name);
-    std::optional<int> parseIdFromPath(const std::string& path, const std::string& prefix);
+    // NEW: ?include=dashboard,cascade,version у запросов записи. Без параметра ответ прежний — одна строка
+    // или {"deletedId"}; с ним — {"data", "dashboard", "cascade": {"deleted", "updated"}, "version"}
+    struct MutationIncludes {
+        bool dashboard = false;
+        bool cascade = false;
+        bool version = false;
+        bool any() const { return dashboard || cascade || version; }
+    };
+
+    // Что ещё изменила запись: deleted — таблица -> [id] (каскад), updated — таблица -> [строка]
+    // (счётчики клиента из триггеров, задачи после SET NULL). version и dashboard читаются до commit
+    struct MutationExtras {
+        bj::object deleted;
+        bj::object updated;
+        std::optional<uint64_t> version;
+        std::optional<bj::object> dashboard;
+        // Версия записи из data_version_seq — всегда, для write-through в EntityStore
+        uint64_t data_version = 0;
+    };
+
+    static MutationIncludes parseIncludes(const http::request<http::string_body>& req);
+    // В транзакции записи, перед commit. Дашборд — SQL-ем, только если реплика не загружена
+    void readExtras(pqxx::work& txn, const MutationIncludes& include, MutationExtras& extras);
+    // После commit и записи в EntityStore
+    void sendMutation(http::response<http::string_body>& res, http::status status, bj::value data,
+        const MutationIncludes& include, MutationExtras&& extras);
+
+    // Конвертеры строк в JSON — ApiConverters.h, разбор target — RequestParsing.h
 
 public:
     explicit ApiProcessor(DatabaseModule* db_module);
@@ -38,10 +66,28 @@ public:
     void handleGetAllData(const http::request<http::string_body>& req,
         http::response<http::string_body>& res);
 
-    // Заготовки для CRUD (реализуем на следующем шаге)
+    // NEW: чтение из EntityStore, без обращения к БД. render_if_stale = false — для I/O-потока: отдаётся только
+    // готовое тело. true — для потока БД: устаревшее тело перерисовывается из реплики.
+    // false — реплика ещё не загружена (или сброшена) либо тело устарело, ответ нужно собрать на потоке БД
+    bool serveAllDataFromMemory(const http::request<http::string_body>& req, http::response<http::string_body>& res,
+        bool render_if_stale);
+
+    // Одна запись и выборки по внешнему ключу. Пока реплика не загружена — 503
+    void handleGetClient(const http::request<http::string_body>& req, http::response<http::string_body>& res);
+    void handleGetCampaign(const http::request<http::string_body>& req, http::response<http::string_body>& res);
+    void handleGetTask(const http::request<http::string_body>& req, http::response<http::string_body>& res);
+    void handleGetTeamMember(const http::request<http::string_body>& req, http::response<http::string_body>& res);
+    void handleGetClientCampaigns(const http::request<http::string_body>& req, http::response<http::string_body>& res);
+    void handleGetCampaignTasks(const http::request<http::string_body>& req, http::response<http::string_body>& res);
+    void handleGetTeamMemberTasks(const http::request<http::string_body>& req, http::response<http::string_body>& res);
+
+    // CRUD. После коммита записанные строки (RETURNING *) сразу попадают в EntityStore
     void handleAddClient(const http::request<http::string_body>& req, http::response<http::string_body>& res);
     void handleUpdateClient(const http::request<http::string_body>& req, http::response<http::string_body>& res);
     void handleDeleteClient(const http::request<http::string_body>& req, http::response<http::string_body>& res);
+    // NEW: DELETE /api/clients/{id}/cascade — клиент с кампаниями и задачами одной транзакцией, в ответе все
+    // удалённые id и их число. ?dryRun=true — только посчитать, ничего не удаляя
+    void handleDeleteClientCascade(const http::request<http::string_body>& req, http::response<http::string_body>& res);
 
     void handleAddCampaign(const http::request<http::string_body>& req, http::response<http::string_body>& res);
     void handleUpdateCampaign(const http::request<http::string_body>& req, http::response<http::string_body>& res);
@@ -0,0 +1,116 @@
+﻿#include "JsonBody.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace http = boost::beast::http;
+
+namespace {
+    std::invalid_argument fieldError(std::string_view key, const char* what) {
+        return std::invalid_argument("Field '" + std::string(key) + "' " + what);
+    }
+}
+
+JsonBody::JsonBody()
+    : resource_(buffer_, sizeof(buffer_))
+    , value_(bj::storage_ptr(&resource_)) {}
+
+bool JsonBody::fail(http::status status, std::string message) {
+    error_status_ = status;
+    error_ = std::move(message);
+    return false;
+}
+
+bool JsonBody::parse(std::string_view text) {
+    if (text.size() > kMaxBytes) return fail(http::status::payload_too_large, "Request body too large");
+
+    bj::parse_options options;
+    options.max_depth = kMaxDepth;
+    // Стек самого парсера — тоже на стеке, не в куче
+    unsigned char parser_buffer[1024];
+    bj::stream_parser parser(bj::storage_ptr(), options, parser_buffer, sizeof(parser_buffer));
+    parser.reset(bj::storage_ptr(&resource_));
+
+    bj::error_code ec;
+    parser.write(text.data(), text.size(), ec);
+    if (!ec) parser.finish(ec);
+    if (ec) return fail(http::status::bad_request, "Invalid JSON: " + ec.message());
+
+    value_ = parser.release();  // Тот же ресурс — перемещение без копии
+    if (!value_.is_object()) return fail(http::status::bad_request, "Expected JSON object");
+    if (value_.get_object().size() > kMaxFields) return fail(http::status::bad_request, "Too many fields");
+    return true;
+}
+
+const bj::value* JsonBody::find(std::string_view key) const {
+    if (!value_.is_object()) return nullptr;
+    return value_.get_object().if_contains(bj::string_view(key.data(), key.size()));
+}
+
+const bj::value& JsonBody::require(std::string_view key) const {
+    const bj::value* value = find(key);
+    if (!value) throw fieldError(key, "is required");
+    return *value;
+}
+
+bool JsonBody::has(std::string_view key) const {
+    return find(key) != nullptr;
+}
+
+bool JsonBody::isNull(std::string_view key) const {
+    const bj::value* value = find(key);
+    return !value || value->is_null();
+}
+
+pqxx::zview JsonBody::text(std::string_view key) const {
+    const bj::value& value = require(key);
+    if (!value.is_string()) throw fieldError(key, "must be a string");
+    const bj::string& str = value.get_string();
+    return pqxx::zview(str.data(), str.size());
+}
+
+pqxx::zview JsonBody::textOr(std::string_view key, pqxx::zview fallback) const {
+    return has(key) ? text(key) : fallback;
+}
+
+std::optional<pqxx::zview> JsonBody::optionalText(std::string_view key) const {
+    if (isNull(key)) return std::nullopt;
+    return text(key);
+}
+
+int64_t JsonBody::integer(std::string_view key) const {
+    const bj::value& value = require(key);
+    if (value.is_int64()) return value.get_int64();
+    if (value.is_uint64() && value.get_uint64() <= static_cast<uint64_t>(INT64_MAX)) return static_cast<int64_t>(value.get_uint64());
+    throw fieldError(key, "must be an integer");
+}
+
+std::optional<int64_t> JsonBody::optionalInteger(std::string_view key) const {
+    if (isNull(key)) return std::nullopt;
+    return integer(key);
+}
+
+int JsonBody::id(std::string_view key) const {
+    int64_t value = integer(key);
+    // FIXED: static_cast<int> превращал 4294967297 в 1 — запись уходила чужому родителю
+    if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max())
+        throw fieldError(key, "is out of range");
+    return static_cast<int>(value);
+}
+
+std::optional<int> JsonBody::optionalId(std::string_view key) const {
+    if (isNull(key)) return std::nullopt;
+    return id(key);
+}
+
+double JsonBody::number(std::string_view key) const {
+    const bj::value& value = require(key);
+    if (value.is_double()) return value.get_double();
+    if (value.is_int64()) return static_cast<double>(value.get_int64());
+    if (value.is_uint64()) return static_cast<double>(value.get_uint64());
+    throw fieldError(key, "must be a number");
+}
+
+double JsonBody::numberOr(std::string_view key, double fallback) const {
+    return has(key) ? number(key) : fallback;
+}
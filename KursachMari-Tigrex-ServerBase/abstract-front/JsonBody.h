@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <boost/beast/http/status.hpp>
+#include <boost/json.hpp>
+#include <pqxx/pqxx>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace bj = boost::json;
+
+/*
+# JsonBody
+    JSON-тело запроса записи. Разбирается bj::stream_parser в monotonic_resource с буфером внутри объекта
+    (объект живёт на стеке обработчика): тело обычной записи — сотни байт — разбирается без обращений к куче,
+    всё освобождается разом вместе с объектом. Строковые поля отдаются как pqxx::zview прямо на строки
+    в этом буфере (bj::string хранит завершающий '\0') и уходят в параметры запроса без копий в std::string.
+
+    Пределы строже транспортного body_limit сессии: kMaxBytes (413), глубина kMaxDepth и число полей
+    kMaxFields (400). Тело к этому моменту уже прочитано сессией целиком (string_body), поэтому
+    парсер получает его одним куском.
+
+    Ошибки формы (нет поля, не тот тип) — std::invalid_argument с именем поля: обработчики отвечают 400.
+*/
+class JsonBody {
+public:
+    static constexpr std::size_t kMaxBytes = 64 * 1024;
+    static constexpr std::size_t kMaxDepth = 8;
+    static constexpr std::size_t kMaxFields = 64;
+
+    JsonBody();
+    JsonBody(const JsonBody&) = delete;
+    JsonBody& operator=(const JsonBody&) = delete;
+
+    // false — тело не разобрано: errorStatus() и error() для ответа
+    bool parse(std::string_view text);
+    boost::beast::http::status errorStatus() const { return error_status_; }
+    const std::string& error() const { return error_; }
+
+    bool has(std::string_view key) const;     // Поле есть, в том числе null
+    bool isNull(std::string_view key) const;  // Поля нет или оно null
+
+    // Обязательная строка. Действительна, пока жив JsonBody
+    pqxx::zview text(std::string_view key) const;
+    // Нет поля -> fallback; null — ошибка, как и раньше
+    pqxx::zview textOr(std::string_view key, pqxx::zview fallback) const;
+    // Нет поля или null -> nullopt
+    std::optional<pqxx::zview> optionalText(std::string_view key) const;
+
+    int64_t integer(std::string_view key) const;
+    std::optional<int64_t> optionalInteger(std::string_view key) const;
+    // Ссылка на запись (INTEGER в БД): целое в пределах int, иначе ошибка, а не тихий перенос
+    int id(std::string_view key) const;
+    std::optional<int> optionalId(std::string_view key) const;
+    // Целое или дробное: 5000 и 5000.5 одинаково годятся для NUMERIC
+    double number(std::string_view key) const;
+    double numberOr(std::string_view key, double fallback) const;
+
+private:
+    bool fail(boost::beast::http::status status, std::string message);
+    const bj::value* find(std::string_view key) const;
+    const bj::value& require(std::string_view key) const;
+
+    // Порядок важен: value_ держит ссылку на resource_, а тот — на buffer_
+    unsigned char buffer_[4096];
+    bj::monotonic_resource resource_;
+    bj::value value_;
+
+    boost::beast::http::status error_status_ = boost::beast::http::status::bad_request;
+    std::string error_;
+};
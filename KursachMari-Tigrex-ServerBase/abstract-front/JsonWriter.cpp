@@ -0,0 +1,74 @@
+﻿#include "JsonWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+
+namespace {
+
+    // Что писать после '\' для байта; 0 — байт идёт как есть, 'u' — \u00xx. Таблица как в сериализаторе Boost.JSON
+    constexpr std::array<char, 256> kEscapes = [] {
+        std::array<char, 256> table{};
+        for (int c = 0; c < 0x20; ++c) table[c] = 'u';
+        table['\b'] = 'b';
+        table['\t'] = 't';
+        table['\n'] = 'n';
+        table['\f'] = 'f';
+        table['\r'] = 'r';
+        table['"'] = '"';
+        table['\\'] = '\\';
+        return table;
+    }();
+
+    constexpr char kHex[] = "0123456789abcdef";
+
+}
+
+void JsonWriter::string(std::string_view text) {
+    out_.push_back('"');
+    const char* run = text.data();
+    const char* end = run + text.size();
+    for (const char* p = run; p != end; ++p) {
+        char escape = kEscapes[static_cast<unsigned char>(*p)];
+        if (!escape) continue;
+        out_.append(run, static_cast<std::size_t>(p - run));
+        out_.push_back('\\');
+        out_.push_back(escape);
+        if (escape == 'u') {
+            unsigned char c = static_cast<unsigned char>(*p);
+            out_.append("00");
+            out_.push_back(kHex[c >> 4]);
+            out_.push_back(kHex[c & 0x0f]);
+        }
+        run = p + 1;
+    }
+    out_.append(run, static_cast<std::size_t>(end - run));
+    out_.push_back('"');
+}
+
+void JsonWriter::integer(int64_t value) {
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out_.append(buf, static_cast<std::size_t>(result.ptr - buf));
+}
+
+void JsonWriter::number(double value) {
+    // Как Boost.JSON без allow_infinity_and_nan
+    if (std::isnan(value)) return null();
+    if (std::isinf(value)) return raw(value < 0 ? "-1e99999" : "1e99999");
+
+    // to_chars без точности — кратчайшие цифры, те же, что у Ryu; меняется только запись порядка: e+04 -> E4
+    char buf[32];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::scientific);
+    const char* end = result.ptr;
+    const char* e = std::find(static_cast<const char*>(buf), end, 'e');
+    out_.append(buf, static_cast<std::size_t>(e - buf));
+    out_.push_back('E');
+
+    const char* digits = e + 1;
+    if (*digits == '-') out_.push_back('-');
+    if (*digits == '-' || *digits == '+') ++digits;
+    while (digits + 1 < end && *digits == '0') ++digits;  // e+04 -> 4, e+00 -> 0
+    out_.append(digits, static_cast<std::size_t>(end - digits));
+}
@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/*
+# JsonWriter
+    JSON-текст прямо в std::string, без промежуточного дерева bj::value. Значения пишутся байт в байт
+    как у bj::serialize: строки экранируются так же (\" \\ \b \f \n \r \t, прочие управляющие — \u00xx),
+    double — кратчайшая точная запись в научном виде с "E", как у Ryu внутри Boost.JSON
+    (15000 -> 1.5E4, 0.5 -> 5E-1, 0 -> 0E0). Скобки, запятые и ключи пишет вызывающий через raw():
+    ключи полей сущностей заготовлены при компиляции (ApiConverters::RowWriter, writeJson).
+*/
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    void raw(std::string_view text) { out_.append(text); }
+    void raw(char c) { out_.push_back(c); }
+    void string(std::string_view text);
+    void integer(int64_t value);
+    void number(double value);
+    void null() { out_.append("null"); }
+
+    std::size_t size() const { return out_.size(); }
+
+private:
+    std::string& out_;
+};
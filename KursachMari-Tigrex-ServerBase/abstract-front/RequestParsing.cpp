@@ -0,0 +1,42 @@
+﻿#include "RequestParsing.h"
+
+#include <boost/algorithm/string.hpp>
+
+#include <charconv>
+#include <regex>
+#include <vector>
+
+std::optional<std::string> RequestParsing::getQueryParam(const std::string& target,
+    const std::string& param_name) {
+    size_t pos = target.find('?');
+    if (pos == std::string::npos) return std::nullopt;
+
+    std::string query = target.substr(pos + 1);
+    std::vector<std::string> pairs;
+    boost::split(pairs, query, boost::is_any_of("&"));
+
+    for (const auto& pair : pairs) {
+        std::vector<std::string> kv;
+        boost::split(kv, pair, boost::is_any_of("="));
+        if (kv.size() == 2 && kv[0] == param_name) {
+            return kv[1];
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<int> RequestParsing::parseIdFromPath(const std::string& path,
+    const std::string& prefix) {
+    std::regex re(prefix + "(\\d+)");
+    std::smatch match;
+    if (std::regex_search(path, match, re) && match.size() > 1) {
+        // FIXED: std::stoi бросал out_of_range на /api/clients/99999999999 — теперь это просто не id
+        int id = 0;
+        const char* begin = path.data() + match.position(1);
+        const char* end = begin + match.length(1);
+        auto [ptr, ec] = std::from_chars(begin, end, id);
+        if (ec != std::errc() || ptr != end) return std::nullopt;
+        return id;
+    }
+    return std::nullopt;
+}
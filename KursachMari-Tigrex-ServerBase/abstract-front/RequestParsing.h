@@ -0,0 +1,16 @@
+﻿#pragma once
+
+#include <optional>
+#include <string>
+
+// Разбор target запроса для API: без состояния и без зависимостей от БД
+namespace RequestParsing {
+
+    // Значение параметра query-строки (?a=1&b=2), без URL-декодирования
+    std::optional<std::string> getQueryParam(const std::string& target, const std::string& param_name);
+
+    // Число сразу после prefix: parseIdFromPath("/api/clients/42", "/api/clients/") -> 42.
+    // Не влезает в int — nullopt, как и отсутствие числа
+    std::optional<int> parseIdFromPath(const std::string& path, const std::string& prefix);
+
+}
@@ -1,7 +1,10 @@
 ﻿#pragma once
 #include "IModule.h"
 #include <atomic>
+#include <functional>
 #include <string>
+#include <typeindex>
+#include <vector>
 
 class BaseModule : public IModule {
     enum class ModuleStatus : uint8_t { SUCCESS, DISABLED, MODULE_ERROR };
@@ -51,6 +54,22 @@ public:
     friend class ModuleRegistry;
 
 protected:
+    // NEW: зависимость от модуля типа T. Реестр инициализирует его раньше этого модуля
+    // (и останавливает позже), а указатель на него кладёт в slot до вызова onInitialize
+    template<typename T>
+    void dependsOn(T*& slot) {
+        dependencies_.push_back({ std::type_index(typeid(T)), [&slot](IModule* module) {
+            slot = static_cast<T*>(module);
+            } });
+    }
+
+    // Зависимость только по порядку запуска и остановки: указатель не нужен, модулем пользуются
+    // через статический API (Log::, MetricsModule::) или через обработчики, заданные снаружи
+    template<typename T>
+    void dependsOn() {
+        dependencies_.push_back({ std::type_index(typeid(T)), [](IModule*) {} });
+    }
+
     // Для реализации в наследниках
     virtual bool onInitialize() = 0;
     virtual void onShutdown() = 0;
@@ -59,4 +78,11 @@ protected:
     bool isInitialized() const { return initialized_.load(); }
 
     void setId(int id) { id_ = id; }
+
+private:
+    struct Dependency {
+        std::type_index type;
+        std::function<void(IModule*)> inject;
+    };
+    std::vector<Dependency> dependencies_;
 };
\ No newline at end of file
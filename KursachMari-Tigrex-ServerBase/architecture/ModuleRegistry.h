@@ -9,17 +9,35 @@
 #include <iostream>
 #include <mutex>
 #include <stdexcept>
+#include <chrono>
+#include <future>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
 
 
 /*
 # ModuleManager
     Управляет жизненным циклом модулей, сохраняет их атрибуты и позволяет иметь модульную структуру.
-
+    Модули объявляют зависимости (BaseModule::dependsOn), реестр строит по ним граф:
+    initializeAll запускает каждый модуль, как только готовы его зависимости, независимые — параллельно,
+    shutdownAll останавливает в обратном топологическом порядке (сначала потребители, потом их зависимости).
+    Среди независимых модулей порядок — порядок регистрации.
 */
 
 class ModuleRegistry{
 private:
-    std::unordered_map<int, std::unique_ptr<IModule>> modules_;
+    struct Entry {
+        std::unique_ptr<IModule> module;
+        BaseModule* base = nullptr;  // Зависимости есть только у наследников BaseModule
+        std::type_index type;
+    };
+
+    std::unordered_map<int, Entry> modules_;
+    std::unordered_map<std::type_index, int> ids_by_type_;
+    std::vector<int> order_;  // id в порядке регистрации
+    std::vector<int> init_order_;  // Топологический порядок последнего initializeAll
     int nextId_ = 1;
     std::mutex mutex_;
 
@@ -34,51 +52,169 @@ private:
         }
     }
 
+    // Алгоритм Кана по порядку регистрации. Бросает при отсутствующей зависимости или цикле
+    std::vector<int> resolveOrder() const {
+        std::unordered_map<int, std::vector<int>> dependents;
+        std::unordered_map<int, size_t> pending;
+        for (int id : order_) {
+            const Entry& entry = modules_.at(id);
+            pending[id] = 0;
+            if (!entry.base) continue;
+            for (const auto& dependency : entry.base->dependencies_) {
+                auto it = ids_by_type_.find(dependency.type);
+                if (it == ids_by_type_.end()) {
+                    throw std::runtime_error("Module '" + entry.module->getName() + "' depends on unregistered module "
+                        + dependency.type.name());
+                }
+                dependents[it->second].push_back(id);
+                ++pending[id];
+            }
+        }
+
+        std::vector<int> sorted;
+        std::vector<bool> done(nextId_, false);
+        while (sorted.size() < order_.size()) {
+            bool progressed = false;
+            for (int id : order_) {
+                if (done[id] || pending[id] != 0) continue;
+                done[id] = true;
+                sorted.push_back(id);
+                for (int dependent : dependents[id]) --pending[dependent];
+                progressed = true;
+                break;  // Снова с начала: освободившиеся модули встают по порядку регистрации
+            }
+            if (!progressed) {
+                std::string cycle;
+                for (int id : order_) {
+                    if (!done[id]) cycle += (cycle.empty() ? "" : ", ") + modules_.at(id).module->getName();
+                }
+                throw std::runtime_error("Module dependency cycle: " + cycle);
+            }
+        }
+        return sorted;
+    }
+
 public:
     template<typename T, typename... Args>
     T* registerModule(Args&&... args) {
+        static_assert(std::is_base_of_v<IModule, T>, "T must implement IModule");
         auto module = std::make_unique<T>(std::forward<Args>(args)...);
         int id = generateId();
 
         // Устанавливаем id в модуль
-        setModuleId(module.get(), id);
+        BaseModule* base = nullptr;
+        if constexpr (std::is_base_of_v<BaseModule, T>) {
+            base = module.get();
+        }
+        setModuleId(base, id);
 
         // Проверяем, не существует ли уже модуль с таким id
         if (modules_.find(id) != modules_.end()) {
             throw std::runtime_error("Internal error: generated duplicate id " + std::to_string(id));
         }
+        // Тип — ключ зависимостей и get<T>(), поэтому модуль каждого типа один
+        std::type_index type(typeid(T));
+        if (ids_by_type_.find(type) != ids_by_type_.end()) {
+            throw std::runtime_error("Module of this type is already registered: " + module->getName());
+        }
 
         T* ptr = module.get();
-        modules_[id] = std::move(module);
+        modules_.emplace(id, Entry{ std::move(module), base, type });
+        ids_by_type_.emplace(type, id);
+        order_.push_back(id);
         return ptr;
     }
 
     IModule* getModule(const int& id) {
         auto it = modules_.find(id);
-        return it != modules_.end() ? it->second.get() : nullptr;
+        return it != modules_.end() ? it->second.module.get() : nullptr;
     }
 
+    // Типизированный поиск: точный тип сохранён при регистрации и проверяется без dynamic_cast.
+    // FIXED: поиск по базовому классу или интерфейсу снова работает — через dynamic_cast
     template<typename T>
     T* getModuleAs(const int& id) {
-        return dynamic_cast<T*>(getModule(id));
+        auto it = modules_.find(id);
+        if (it == modules_.end()) return nullptr;
+        if (it->second.type == std::type_index(typeid(T))) return static_cast<T*>(it->second.module.get());
+        return dynamic_cast<T*>(it->second.module.get());
+    }
+
+    template<typename T>
+    T* get() {
+        auto it = ids_by_type_.find(std::type_index(typeid(T)));
+        return it != ids_by_type_.end() ? static_cast<T*>(modules_.at(it->second).module.get()) : nullptr;
     }
 
+    // Модуль стартует в своём потоке, когда инициализированы все его зависимости. Если зависимость
+    // выключена или не поднялась, модуль не инициализируется. Возвращает false, если не поднялся хоть один
     bool initializeAll() {
         std::lock_guard<std::mutex> lock(mutex_);
-        bool all_ok = true;
-        for (auto& [id, module] : modules_) {
-            if (module->isEnabled()) {
-                if (!module->initialize()) {
-                    std::cerr << "Failed to initialize module: " << id << std::endl;
-                    all_ok = false;
+        init_order_ = resolveOrder();
+
+        // Внедрение — до запуска потоков: к onInitialize указатели на зависимости уже на месте
+        for (int id : init_order_) {
+            Entry& entry = modules_.at(id);
+            if (!entry.base) continue;
+            for (const auto& dependency : entry.base->dependencies_) {
+                dependency.inject(modules_.at(ids_by_type_.at(dependency.type)).module.get());
+            }
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        std::unordered_map<int, std::shared_future<bool>> results;
+        for (int id : init_order_) {
+            Entry& entry = modules_.at(id);
+            std::vector<std::pair<std::string, std::shared_future<bool>>> dependencies;
+            if (entry.base) {
+                for (const auto& dependency : entry.base->dependencies_) {
+                    int dependency_id = ids_by_type_.at(dependency.type);
+                    dependencies.emplace_back(modules_.at(dependency_id).module->getName(), results.at(dependency_id));
                 }
             }
+            IModule* module = entry.module.get();
+            // Зависимости уже в results: порядок топологический
+            results.emplace(id, std::async(std::launch::async, [module, dependencies = std::move(dependencies), started]() {
+                for (const auto& [name, ready] : dependencies) {
+                    if (!ready.get()) {
+                        std::cerr << "Module '" << module->getName() << "' not initialized: dependency '" << name
+                            << "' is not available" << std::endl;
+                        return false;
+                    }
+                }
+                if (!module->isEnabled()) return false;
+                bool ok = false;
+                try {
+                    ok = module->initialize();
+                }
+                catch (const std::exception& e) {
+                    std::cerr << "Module '" << module->getName() << "' initialization error: " << e.what() << std::endl;
+                }
+                if (!ok) {
+                    std::cerr << "Failed to initialize module: " << module->getName() << " (id " << module->getId() << ")" << std::endl;
+                }
+                else {
+                    // Одной записью: модули стартуют параллельно, и вывод не должен перемешиваться
+                    auto ready_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+                    std::cout << ("Module '" + module->getName() + "' ready at +" + std::to_string(ready_ms.count()) + " ms\n") << std::flush;
+                }
+                return ok;
+                }).share());
+        }
+
+        bool all_ok = true;
+        for (int id : init_order_) {
+            // Выключенный модуль — не ошибка, если от него ничего не зависит
+            if (!results.at(id).get() && modules_.at(id).module->isEnabled()) all_ok = false;
         }
         return all_ok;
     }
 
     void shutdownAll() {
-        for (auto& [id, module] : modules_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::vector<int>& order = init_order_.empty() ? order_ : init_order_;
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            auto& module = modules_.at(*it).module;
             if (module->isEnabled()) {
                 module->shutdown();
             }
@@ -86,11 +222,7 @@ public:
     }
 
     std::vector<int> getModuleIds() const {
-        std::vector<int> ids;
-        for (const auto& [id, module] : modules_) {
-            ids.push_back(id);
-        }
-        return ids;
+        return order_;
     }
 
     size_t size() const {
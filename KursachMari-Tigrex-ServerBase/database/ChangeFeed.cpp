@@ -0,0 +1,234 @@
+﻿#include "ChangeFeed.h"
+#include "ApiConverters.h"
+#include "DatabaseModule.h"
+#include "LoggingModule.h"
+#include "MetricsModule.h"
+
+#include <boost/json.hpp>
+#include <pqxx/pqxx>
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+namespace bj = boost::json;
+
+namespace {
+    // Уведомления копятся во время await_notification и разбираются после: внутри обработчика
+    // libpqxx запросы выполнять нельзя
+    class Receiver : public pqxx::notification_receiver {
+    public:
+        Receiver(pqxx::connection& conn, std::vector<std::string>& out)
+            : pqxx::notification_receiver(conn, ChangeFeed::kChannel), out_(out) {
+        }
+
+        void operator()(const std::string& payload, int) override {
+            out_.push_back(payload);
+        }
+
+    private:
+        std::vector<std::string>& out_;
+    };
+
+    using Change = ChangeFeed::Change;
+
+    // Таблицы, о которых сообщают триггеры, и их представление в API. Имя таблицы попадает в SQL только отсюда
+    struct TableView {
+        const char* table;
+        const char* select;
+        bj::object(*toJson)(const pqxx::row&);
+    };
+
+    const TableView kTables[] = {
+        { "clients", "SELECT * FROM clients WHERE id = $1", &ApiConverters::clientToJson<pqxx::row> },
+        { "campaigns", "SELECT * FROM campaigns WHERE id = $1", &ApiConverters::campaignToJson<pqxx::row> },
+        { "tasks", "SELECT * FROM tasks WHERE id = $1", &ApiConverters::taskToJson<pqxx::row> },
+        { "team", "SELECT * FROM team WHERE id = $1", &ApiConverters::teamMemberToJson<pqxx::row> },
+    };
+
+    const TableView* findTable(std::string_view table) {
+        for (const auto& view : kTables) {
+            if (table == view.table) return &view;
+        }
+        return nullptr;
+    }
+
+    // Разбор и схлопывание пачки: на строку — одно событие с последней операцией
+    std::vector<Change> collapse(const std::vector<std::string>& payloads) {
+        std::vector<Change> changes;
+        for (const auto& payload : payloads) {
+            try {
+                const bj::object& obj = bj::parse(payload).as_object();
+                Change change;
+                change.table = bj::value_to<std::string>(obj.at("table"));
+                change.op = bj::value_to<std::string>(obj.at("op"));
+                change.id = bj::value_to<int>(obj.at("id"));
+                if (const bj::value* version = obj.if_contains("version")) {  // До миграции 4 версии нет
+                    change.version = bj::value_to<uint64_t>(*version);
+                }
+                auto same = std::find_if(changes.begin(), changes.end(), [&](const Change& c) {
+                    return c.id == change.id && c.table == change.table;
+                    });
+                if (same == changes.end()) {
+                    changes.push_back(std::move(change));
+                }
+                else {
+                    // Строка новая для клиентов — insert после update остаётся insert
+                    if (!(same->op == "insert" && change.op == "update")) same->op = std::move(change.op);
+                    same->version = std::max(same->version, change.version);
+                }
+            }
+            catch (const std::exception& e) {
+                Log::warning("ChangeFeed: bad notification", { {"payload", payload}, {"error", e.what()} });
+            }
+        }
+        return changes;
+    }
+}
+
+ChangeFeed::ChangeFeed(std::string conn_str)
+    : BaseModule("ChangeFeed"), conn_str_(std::move(conn_str)) {
+    // Перезагрузка реплики уходит в очередь потока БД и встаёт после миграций и первой загрузки
+    dependsOn<DatabaseModule>();
+    dependsOn<LoggingModule>();
+    dependsOn<MetricsModule>();
+}
+
+ChangeFeed::~ChangeFeed() {
+    shutdown();
+}
+
+bool ChangeFeed::onInitialize() {
+    running_.store(true);
+    thread_ = std::thread(&ChangeFeed::run, this);
+    return true;
+}
+
+void ChangeFeed::onShutdown() {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        running_.store(false);
+    }
+    stop_cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+ChangeFeed::Stats ChangeFeed::getStats() const {
+    Stats stats;
+    stats.notifications = notifications_.load(std::memory_order_relaxed);
+    stats.events = events_.load(std::memory_order_relaxed);
+    stats.reconnects = reconnects_.load(std::memory_order_relaxed);
+    stats.connected = connected_.load(std::memory_order_relaxed);
+    stats.data_version = dataVersion();
+    return stats;
+}
+
+bool ChangeFeed::waitOrStop(std::chrono::milliseconds delay) {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    return !stop_cv_.wait_for(lock, delay, [this] { return !running_.load(); });
+}
+
+void ChangeFeed::applyHooks(const Change& change, const pqxx::row* row) {
+    for (const auto& hook : hooks_) {
+        try {
+            hook(change, row);
+        }
+        catch (const std::exception& e) {
+            Log::error("ChangeFeed: invalidation hook failed", { {"table", change.table}, {"op", change.op}, {"error", e.what()} });
+        }
+    }
+}
+
+void ChangeFeed::advanceVersion(uint64_t version) {
+    uint64_t current = data_version_.load(std::memory_order_relaxed);
+    while (version > current && !data_version_.compare_exchange_weak(current, version, std::memory_order_release)) {
+    }
+}
+
+void ChangeFeed::run() {
+    std::chrono::milliseconds backoff(1000);
+    bool first = true;
+    while (running_.load()) {
+        try {
+            if (!first) {
+                reconnects_.fetch_add(1, std::memory_order_relaxed);
+            }
+            listen();
+            backoff = std::chrono::milliseconds(1000);
+        }
+        catch (const std::exception& e) {
+            Log::warning("ChangeFeed: connection lost", { {"error", e.what()}, {"retry_ms", backoff.count()} });
+        }
+        connected_.store(false);
+        first = false;
+        if (!waitOrStop(backoff)) break;
+        backoff = std::min(backoff * 2, std::chrono::milliseconds(30000));
+    }
+}
+
+void ChangeFeed::listen() {
+    pqxx::connection conn(conn_str_);
+    std::vector<std::string> payloads;
+    Receiver receiver(conn, payloads);
+    connected_.store(true);
+
+    // Версия на момент подключения: изменения до неё узел либо уже видел, либо сбросит по resync
+    uint64_t version = 0;
+    try {
+        pqxx::nontransaction txn(conn);
+        auto result = txn.exec("SELECT CASE WHEN is_called THEN last_value ELSE 0 END FROM data_version_seq");
+        version = result[0][0].as<uint64_t>();
+    }
+    catch (const pqxx::undefined_table&) {
+        // Миграция 4 ещё не применена: версия появится с первым уведомлением
+    }
+    Log::info("ChangeFeed: listening", { {"channel", kChannel}, {"data_version", version} });
+
+    // Что менялось до LISTEN (или пока соединения не было), неизвестно. При первом подключении resync — это первая
+    // загрузка кэшей узла (DatabaseModule::setLoadEntitiesOnStart(false)): она начинается уже после LISTEN и ничего
+    // не пропускает. Клиентам resync нужен только после обрыва
+    Change resync;
+    resync.op = "resync";
+    resync.version = version;
+    applyHooks(resync, nullptr);
+    if (reconnects_.load(std::memory_order_relaxed) > 0 && listener_) listener_("resync", "{}");
+    advanceVersion(version);
+
+    while (running_.load()) {
+        // Секундный таймаут — чтобы заметить остановку
+        if (conn.await_notification(1, 0) == 0 || payloads.empty()) continue;
+        notifications_.fetch_add(payloads.size(), std::memory_order_relaxed);
+        std::vector<Change> changes = collapse(payloads);
+        payloads.clear();
+
+        for (auto& change : changes) {
+            const TableView* view = findTable(change.table);
+            if (!view) continue;
+            bj::object event;
+            event["table"] = change.table;
+            event["id"] = change.id;
+            std::optional<pqxx::row> row;
+            if (change.op != "delete") {
+                // Читается текущее состояние: строку могли удалить уже после уведомления
+                pqxx::nontransaction txn(conn);
+                auto result = txn.exec_params(view->select, change.id);
+                if (result.empty()) {
+                    change.op = "delete";
+                }
+                else {
+                    row = result[0];
+                    event["row"] = view->toJson(*row);
+                }
+            }
+            // Сначала кэши узла, потом клиенты: событие не должно опередить данные, которые отдаёт сервер
+            applyHooks(change, row ? &*row : nullptr);
+            advanceVersion(change.version);
+            event["op"] = change.op;
+            event["version"] = change.version;
+            events_.fetch_add(1, std::memory_order_relaxed);
+            if (listener_) listener_("change", bj::serialize(event));
+        }
+    }
+}
@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+
+#include <pqxx/pqxx>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/*
+# ChangeFeed
+    Слушает канал data_changes (LISTEN) на собственном соединении и в своём потоке: очередь запросов API
+    его не задерживает, и он её тоже. На уведомление читает изменённую строку и отдаёт слушателю готовое
+    событие "change" с JSON {"table","op","id","row"}; row — в том же виде, что в /api/all-data, у удалённых — нет.
+    Пачка уведомлений разбирается вместе, повторы одной строки схлопываются.
+    После обрыва соединения — переподключение с нарастающей паузой и событие "resync": изменения
+    за время обрыва потеряны, клиентам нужно перечитать данные целиком.
+
+    Тот же канал — шина согласованности между узлами: уведомления приходят всем процессам, подключённым
+    к базе, независимо от того, какой узел записал. Кэши узла подписываются через addInvalidationHook
+    и сбрасывают или патчат записи. dataVersion() — наибольшая версия данных, уже применённая хуками
+    (GET /api/version): по ней видно, догнал ли узел запись, сделанную через другой.
+*/
+class ChangeFeed : public BaseModule {
+public:
+    // event — имя события ("change", "resync"), data — JSON. Вызывается в потоке ChangeFeed
+    using Listener = std::function<void(std::string_view event, const std::string& data)>;
+
+    static constexpr const char* kChannel = "data_changes";
+
+    // Изменение строки. op: "insert", "update", "delete"; "resync" — LISTEN начал работать (при каждом
+    // подключении, включая первое), пропущенные изменения неизвестны, кэши нужно сбросить целиком (table пустая)
+    struct Change {
+        std::string table;
+        std::string op;
+        int id = 0;
+        uint64_t version = 0;
+    };
+
+    // row — текущее состояние строки (SELECT * по id), у удалённых и при resync — nullptr.
+    // Вызывается в потоке ChangeFeed до публикации события
+    using InvalidationHook = std::function<void(const Change& change, const pqxx::row* row)>;
+
+    struct Stats {
+        uint64_t notifications = 0;  // Получено уведомлений
+        uint64_t events = 0;         // Отдано событий после схлопывания
+        uint64_t reconnects = 0;
+        bool connected = false;
+        uint64_t data_version = 0;
+    };
+
+    explicit ChangeFeed(std::string conn_str);
+    ~ChangeFeed() override;
+
+    ChangeFeed(const ChangeFeed&) = delete;
+    ChangeFeed& operator=(const ChangeFeed&) = delete;
+
+    // Вызывать до initializeAll
+    void setListener(Listener listener) { listener_ = std::move(listener); }
+    void addInvalidationHook(InvalidationHook hook) { hooks_.push_back(std::move(hook)); }
+
+    uint64_t dataVersion() const { return data_version_.load(std::memory_order_acquire); }
+
+    Stats getStats() const;
+
+protected:
+    bool onInitialize() override;
+    void onShutdown() override;
+
+private:
+    void run();
+    void listen();  // Одно соединение: до обрыва или остановки
+    bool waitOrStop(std::chrono::milliseconds delay);  // false — пора остановиться
+    void applyHooks(const Change& change, const pqxx::row* row);
+    void advanceVersion(uint64_t version);
+
+    std::string conn_str_;
+    Listener listener_;
+    std::vector<InvalidationHook> hooks_;
+    std::thread thread_;
+    std::atomic<bool> running_{ false };
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+
+    std::atomic<uint64_t> notifications_{ 0 };
+    std::atomic<uint64_t> events_{ 0 };
+    std::atomic<uint64_t> reconnects_{ 0 };
+    std::atomic<bool> connected_{ false };
+    std::atomic<uint64_t> data_version_{ 0 };
+};
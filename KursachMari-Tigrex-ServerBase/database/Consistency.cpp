@@ -0,0 +1,48 @@
+﻿#include "Consistency.h"
+
+namespace {
+    constexpr const char* kCountDrifted = R"(
+        SELECT COUNT(*) AS checked,
+            COUNT(*) FILTER (WHERE c.total_budget IS DISTINCT FROM COALESCE(s.total, 0)
+                OR c.campaigns_count IS DISTINCT FROM COALESCE(s.cnt, 0)) AS drifted
+        FROM clients c
+        LEFT JOIN (SELECT client_id, SUM(budget) AS total, COUNT(*) AS cnt FROM campaigns GROUP BY client_id) s
+            ON s.client_id = c.id
+    )";
+
+    constexpr const char* kRepairCounters = R"(
+        UPDATE clients c SET
+            total_budget = COALESCE(s.total, 0),
+            campaigns_count = COALESCE(s.cnt, 0)
+        FROM clients cl
+        LEFT JOIN (SELECT client_id, SUM(budget) AS total, COUNT(*) AS cnt FROM campaigns GROUP BY client_id) s
+            ON s.client_id = cl.id
+        WHERE c.id = cl.id
+            AND (c.total_budget IS DISTINCT FROM COALESCE(s.total, 0)
+                OR c.campaigns_count IS DISTINCT FROM COALESCE(s.cnt, 0))
+        RETURNING c.id
+    )";
+}
+
+namespace Consistency {
+
+    Report checkClientCounters(pqxx::connection& conn) {
+        Report report;
+        int drifted = 0;
+        {
+            // Один оператор — один снимок: счётчики и агрегаты согласованы между собой
+            pqxx::nontransaction probe(conn);
+            auto row = probe.exec(kCountDrifted)[0];
+            report.checked = row[0].as<int>();
+            drifted = row[1].as<int>();
+        }
+        if (drifted == 0) return report;
+
+        pqxx::work txn(conn);
+        txn.exec("LOCK TABLE campaigns IN SHARE MODE");
+        report.repaired = static_cast<int>(txn.exec(kRepairCounters).size());
+        txn.commit();
+        return report;
+    }
+
+}
@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include <pqxx/pqxx>
+
+// Сверка денормализованных данных с источником. Триггеры держат их в актуальном состоянии;
+// проверка ловит расхождения после ручных правок в обход триггеров или отключённых триггеров
+namespace Consistency {
+
+    struct Report {
+        int checked = 0;   // Клиентов проверено
+        int repaired = 0;  // Клиентов с исправленными счётчиками
+    };
+
+    // clients.total_budget / campaigns_count против SUM/COUNT по campaigns. Поиск — одним чтением без блокировок;
+    // при расхождении пересчёт под SHARE-блокировкой campaigns, чтобы не затереть параллельные изменения
+    Report checkClientCounters(pqxx::connection& conn);
+
+}
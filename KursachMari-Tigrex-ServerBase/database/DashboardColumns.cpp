@@ -0,0 +1,231 @@
+﻿#include "DashboardColumns.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    template<class T, class V>
+    void put(std::vector<T>& column, uint32_t slot, bool is_new, V value) {
+        if (is_new) column.push_back(static_cast<T>(value));
+        else column[slot] = static_cast<T>(value);
+    }
+
+    // Строка moved_from переезжает в slot, последняя строка отбрасывается
+    template<class T>
+    void take(std::vector<T>& column, uint32_t slot, uint32_t moved_from) {
+        column[slot] = column[moved_from];
+        column.pop_back();
+    }
+
+    uint8_t code(DashboardColumns::ClientStatus status) { return static_cast<uint8_t>(status); }
+    uint8_t code(DashboardColumns::CampaignStatus status) { return static_cast<uint8_t>(status); }
+}
+
+DashboardColumns::Totals& DashboardColumns::Totals::operator+=(const Totals& other) {
+    active_clients += other.active_clients;
+    running_campaigns += other.running_campaigns;
+    running_budget_cents += other.running_budget_cents;
+    running_spent_cents += other.running_spent_cents;
+    completed_roi_cents += other.completed_roi_cents;
+    completed_roi_count += other.completed_roi_count;
+    workload_cents += other.workload_cents;
+    workload_count += other.workload_count;
+    return *this;
+}
+
+DashboardColumns::ClientStatus DashboardColumns::clientStatus(std::string_view status) {
+    if (status == "active") return ClientStatus::Active;
+    if (status == "prospect") return ClientStatus::Prospect;
+    if (status == "archived") return ClientStatus::Archived;
+    return ClientStatus::Other;
+}
+
+DashboardColumns::CampaignStatus DashboardColumns::campaignStatus(std::string_view status) {
+    if (status == "planning") return CampaignStatus::Planning;
+    if (status == "running") return CampaignStatus::Running;
+    if (status == "completed") return CampaignStatus::Completed;
+    if (status == "paused") return CampaignStatus::Paused;
+    return CampaignStatus::Other;
+}
+
+int64_t DashboardColumns::toCents(double value) {
+    return std::llround(value * 100.0);
+}
+
+void DashboardColumns::Blocks::touch(size_t row) {
+    dirty[row / kBlockRows] = 1;
+}
+
+void DashboardColumns::Blocks::resize(size_t rows) {
+    size_t count = (rows + kBlockRows - 1) / kBlockRows;
+    sums.resize(count);
+    dirty.resize(count, 1);
+}
+
+uint32_t DashboardColumns::Slots::acquire(int id, bool& is_new) {
+    auto [it, inserted] = index.try_emplace(id, static_cast<uint32_t>(ids.size()));
+    is_new = inserted;
+    if (inserted) ids.push_back(id);
+    return it->second;
+}
+
+bool DashboardColumns::Slots::release(int id, uint32_t& slot, uint32_t& moved_from) {
+    auto it = index.find(id);
+    if (it == index.end()) return false;
+    slot = it->second;
+    moved_from = static_cast<uint32_t>(ids.size() - 1);
+    index.erase(it);
+    if (slot != moved_from) {
+        ids[slot] = ids[moved_from];
+        index[ids[slot]] = slot;
+    }
+    ids.pop_back();
+    return true;
+}
+
+void DashboardColumns::upsert(const Entities::Client& client) {
+    bool is_new = false;
+    uint32_t slot = clients_.acquire(client.id, is_new);
+    put(client_status_, slot, is_new, code(clientStatus(client.status)));
+    client_blocks_.resize(client_status_.size());
+    client_blocks_.touch(slot);
+}
+
+void DashboardColumns::upsert(const Entities::Campaign& campaign) {
+    bool is_new = false;
+    uint32_t slot = campaigns_.acquire(campaign.id, is_new);
+    put(campaign_status_, slot, is_new, code(campaignStatus(campaign.status)));
+    put(budget_cents_, slot, is_new, toCents(campaign.budget));
+    put(spent_cents_, slot, is_new, toCents(campaign.spent));
+    put(roi_cents_, slot, is_new, campaign.roi ? toCents(*campaign.roi) : 0);
+    put(has_roi_, slot, is_new, campaign.roi.has_value());
+    campaign_blocks_.resize(campaign_status_.size());
+    campaign_blocks_.touch(slot);
+}
+
+void DashboardColumns::upsert(const Entities::TeamMember& member) {
+    bool is_new = false;
+    uint32_t slot = team_.acquire(member.id, is_new);
+    put(workload_cents_, slot, is_new, member.workload ? toCents(*member.workload) : 0);
+    put(has_workload_, slot, is_new, member.workload.has_value());
+    team_blocks_.resize(workload_cents_.size());
+    team_blocks_.touch(slot);
+}
+
+void DashboardColumns::eraseClient(int id) {
+    uint32_t slot = 0, moved_from = 0;
+    if (!clients_.release(id, slot, moved_from)) return;
+    take(client_status_, slot, moved_from);
+    client_blocks_.touch(moved_from);  // Последний блок стал короче
+    client_blocks_.resize(client_status_.size());
+    if (slot < client_status_.size()) client_blocks_.touch(slot);
+}
+
+void DashboardColumns::eraseCampaign(int id) {
+    uint32_t slot = 0, moved_from = 0;
+    if (!campaigns_.release(id, slot, moved_from)) return;
+    take(campaign_status_, slot, moved_from);
+    take(budget_cents_, slot, moved_from);
+    take(spent_cents_, slot, moved_from);
+    take(roi_cents_, slot, moved_from);
+    take(has_roi_, slot, moved_from);
+    campaign_blocks_.touch(moved_from);
+    campaign_blocks_.resize(campaign_status_.size());
+    if (slot < campaign_status_.size()) campaign_blocks_.touch(slot);
+}
+
+void DashboardColumns::eraseTeamMember(int id) {
+    uint32_t slot = 0, moved_from = 0;
+    if (!team_.release(id, slot, moved_from)) return;
+    take(workload_cents_, slot, moved_from);
+    take(has_workload_, slot, moved_from);
+    team_blocks_.touch(moved_from);
+    team_blocks_.resize(workload_cents_.size());
+    if (slot < workload_cents_.size()) team_blocks_.touch(slot);
+}
+
+// Ядра: без ветвлений и без обращений к членам класса внутри цикла — только локальные указатели и аккумуляторы,
+// чтобы компилятор не опасался алиасинга и векторизовал их
+
+DashboardColumns::Totals DashboardColumns::clientRows(size_t begin, size_t end) const {
+    const uint8_t* status = client_status_.data();
+    const uint8_t active = code(ClientStatus::Active);
+    int64_t count = 0;
+    for (size_t i = begin; i < end; ++i) count += status[i] == active;
+
+    Totals t;
+    t.active_clients = count;
+    return t;
+}
+
+DashboardColumns::Totals DashboardColumns::campaignRows(size_t begin, size_t end) const {
+    const uint8_t* status = campaign_status_.data();
+    const int64_t* budget = budget_cents_.data();
+    const int64_t* spent = spent_cents_.data();
+    const int32_t* roi = roi_cents_.data();
+    const uint8_t* has_roi = has_roi_.data();
+    const uint8_t running = code(CampaignStatus::Running);
+    const uint8_t completed = code(CampaignStatus::Completed);
+    int64_t running_count = 0, budget_sum = 0, spent_sum = 0, roi_sum = 0, roi_count = 0;
+    for (size_t i = begin; i < end; ++i) {
+        const int64_t running_mask = -static_cast<int64_t>(status[i] == running);
+        const int32_t roi_mask = -static_cast<int32_t>((status[i] == completed) & has_roi[i]);
+        running_count -= running_mask;
+        budget_sum += budget[i] & running_mask;
+        spent_sum += spent[i] & running_mask;
+        roi_sum += roi[i] & roi_mask;
+        roi_count -= roi_mask;
+    }
+
+    Totals t;
+    t.running_campaigns = running_count;
+    t.running_budget_cents = budget_sum;
+    t.running_spent_cents = spent_sum;
+    t.completed_roi_cents = roi_sum;
+    t.completed_roi_count = roi_count;
+    return t;
+}
+
+DashboardColumns::Totals DashboardColumns::teamRows(size_t begin, size_t end) const {
+    const int32_t* workload = workload_cents_.data();
+    const uint8_t* has_workload = has_workload_.data();
+    int64_t sum = 0, count = 0;
+    for (size_t i = begin; i < end; ++i) {
+        sum += workload[i];  // У NULL записан 0
+        count += has_workload[i];
+    }
+
+    Totals t;
+    t.workload_cents = sum;
+    t.workload_count = count;
+    return t;
+}
+
+template<class Kernel>
+void DashboardColumns::refresh(Blocks& blocks, size_t rows, Kernel kernel) const {
+    for (size_t b = 0; b < blocks.sums.size(); ++b) {
+        if (!blocks.dirty[b]) continue;
+        size_t begin = b * kBlockRows;
+        blocks.sums[b] = (this->*kernel)(begin, std::min(rows, begin + kBlockRows));
+        blocks.dirty[b] = 0;
+    }
+}
+
+DashboardColumns::Totals DashboardColumns::totals() const {
+    refresh(client_blocks_, client_status_.size(), &DashboardColumns::clientRows);
+    refresh(campaign_blocks_, campaign_status_.size(), &DashboardColumns::campaignRows);
+    refresh(team_blocks_, workload_cents_.size(), &DashboardColumns::teamRows);
+
+    Totals t;
+    for (const auto* blocks : { &client_blocks_, &campaign_blocks_, &team_blocks_ }) {
+        for (const auto& sum : blocks->sums) t += sum;
+    }
+    return t;
+}
+
+DashboardColumns::Totals DashboardColumns::scan() const {
+    Totals t = clientRows(0, client_status_.size());
+    t += campaignRows(0, campaign_status_.size());
+    t += teamRows(0, workload_cents_.size());
+    return t;
+}
@@ -0,0 +1,109 @@
+﻿#pragma once
+
+#include "Entities.h"
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+# DashboardColumns
+    Столбцы, из которых EntityStore считает дашборд /api/all-data: статус — байтовым enum, деньги и проценты —
+    целыми в сотых (NUMERIC(…,2) без потерь, суммы совпадают с SUM в PostgreSQL): budget и spent — int64,
+    roi (6,2) и workload (5,2) — int32. Каждый столбец — отдельный непрерывный массив (struct of arrays),
+    поэтому агрегат читает только нужные байты.
+    Ядра без ветвлений: условие превращается в маску 0/-1 и накладывается на значение, компилятор
+    векторизует цикл (SSE2 по умолчанию, AVX2 с пресетами -march=x86-64-v3/native).
+    Строки разбиты на блоки по kBlockRows; totals() хранит суммы блоков и пересчитывает только блоки,
+    изменённые с прошлого вызова. Полный проход по 1M кампаний упирается в память (~20 МБ), после точечной
+    записи пересчитывается один блок.
+    Удаление — перенос последней строки на место удалённой: порядок строк не важен, дыр нет.
+*/
+class DashboardColumns {
+public:
+    enum class ClientStatus : uint8_t { Other, Active, Prospect, Archived };
+    enum class CampaignStatus : uint8_t { Other, Planning, Running, Completed, Paused };
+
+    static ClientStatus clientStatus(std::string_view status);
+    static CampaignStatus campaignStatus(std::string_view status);
+    static int64_t toCents(double value);
+
+    // Суммы в сотых; средние считает вызывающий, как AVG в SQL
+    static constexpr size_t kBlockRows = 4096;
+
+    struct Totals {
+        int64_t active_clients = 0;
+        int64_t running_campaigns = 0;
+        int64_t running_budget_cents = 0;
+        int64_t running_spent_cents = 0;
+        int64_t completed_roi_cents = 0;  // Только завершённые кампании с roi IS NOT NULL
+        int64_t completed_roi_count = 0;
+        int64_t workload_cents = 0;       // Только workload IS NOT NULL
+        int64_t workload_count = 0;
+
+        Totals& operator+=(const Totals& other);
+    };
+
+    void upsert(const Entities::Client& client);
+    void upsert(const Entities::Campaign& campaign);
+    void upsert(const Entities::TeamMember& member);
+    void eraseClient(int id);
+    void eraseCampaign(int id);
+    void eraseTeamMember(int id);
+
+    // Обновляет кэш сумм блоков: параллельно с другим totals() и с изменениями не вызывать
+    // (EntityStore зовёт его только при сборке /api/all-data, под cache_mutex_)
+    Totals totals() const;
+    // Полный проход без кэша блоков — для сверки и бенчмарков
+    Totals scan() const;
+
+    size_t clients() const { return client_status_.size(); }
+    size_t campaigns() const { return campaign_status_.size(); }
+    size_t team() const { return workload_cents_.size(); }
+
+private:
+    // id -> номер строки в столбцах таблицы
+    struct Slots {
+        std::vector<int> ids;
+        std::unordered_map<int, uint32_t> index;
+
+        // Номер строки для id; is_new — строку нужно дописать в конец всех столбцов
+        uint32_t acquire(int id, bool& is_new);
+        // Освобождает строку: false — id не было. Иначе moved_from — строка, которую надо перенести в slot
+        bool release(int id, uint32_t& slot, uint32_t& moved_from);
+    };
+
+    // Суммы по блокам одной таблицы. dirty — блок изменился после последнего totals()
+    struct Blocks {
+        std::vector<Totals> sums;
+        std::vector<uint8_t> dirty;
+
+        void touch(size_t row);
+        void resize(size_t rows);
+    };
+
+    Totals clientRows(size_t begin, size_t end) const;
+    Totals campaignRows(size_t begin, size_t end) const;
+    Totals teamRows(size_t begin, size_t end) const;
+    template<class Kernel>
+    void refresh(Blocks& blocks, size_t rows, Kernel kernel) const;
+
+    Slots clients_;
+    std::vector<uint8_t> client_status_;
+
+    Slots campaigns_;
+    std::vector<uint8_t> campaign_status_;
+    std::vector<int64_t> budget_cents_;
+    std::vector<int64_t> spent_cents_;
+    std::vector<int32_t> roi_cents_;
+    std::vector<uint8_t> has_roi_;
+
+    Slots team_;
+    std::vector<int32_t> workload_cents_;
+    std::vector<uint8_t> has_workload_;
+
+    mutable Blocks client_blocks_;
+    mutable Blocks campaign_blocks_;
+    mutable Blocks team_blocks_;
+};
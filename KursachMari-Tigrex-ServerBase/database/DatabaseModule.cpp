@@ -1,10 +1,16 @@
 ﻿#include "DatabaseModule.h"
+#include "Migrations.h"
+#include "Consistency.h"
+#include "LoggingModule.h"
 
 DatabaseModule::DatabaseModule(boost::asio::io_context& ioc, const std::string& conn_str)
     : BaseModule("DatabaseModule", -1)
     , io_context_(ioc)
     , db_connection_string_(conn_str)
-{}
+{
+    dependsOn<LoggingModule>();
+    dependsOn<MetricsModule>();
+}
 
 DatabaseModule::~DatabaseModule() {
     shutdown();
@@ -17,21 +23,26 @@ bool DatabaseModule::onInitialize() {
 }
 
 void DatabaseModule::asyncInitializeDatabase() {
-    auto strand = boost::asio::make_strand(io_context_);
-
-    boost::asio::post(strand, [this]() {
+    // Инициализация идёт через тот же поток, что и запросы: они гарантированно встанут после неё
+    post([this]() {
         try {
             conn_ = std::make_unique<pqxx::connection>(db_connection_string_);
             if (!conn_->is_open()) {
                 throw std::runtime_error("Failed to open database connection");
             }
 
-            pqxx::work txn(*conn_);
-            txn.exec(init_schema_sql_);
-            txn.commit();
+            // Схема уже актуальна — один SELECT; DDL выполняется, только если появились новые миграции
+            auto migrations = Migrations::apply(*conn_);
 
             db_ready_.store(true);
-            std::cout << "[DatabaseModule] Database schema initialized successfully. Ready!\n";
+            std::cout << "[DatabaseModule] Database schema at version " << migrations.current_version
+                << " (" << migrations.applied << " migrations applied). Ready!\n";
+
+            if (load_entities_on_start_) loadEntities();
+
+            if (consistency_interval_.count() > 0) {
+                scheduleConsistencyCheck();
+            }
         }
         catch (const std::exception& e) {
             std::cerr << "[DatabaseModule] Database initialization error: " << e.what() << std::endl;
@@ -40,8 +51,54 @@ void DatabaseModule::asyncInitializeDatabase() {
         });
 }
 
+void DatabaseModule::loadEntities() {
+    if (!conn_) return;
+    try {
+        auto started = std::chrono::steady_clock::now();
+        entities_.load(*conn_);
+        auto stats = entities_.getStats();
+        Log::info("Entity store loaded", { {"clients", stats.clients}, {"campaigns", stats.campaigns},
+            {"tasks", stats.tasks}, {"team", stats.team},
+            {"ms", std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count()} });
+    }
+    catch (const std::exception& e) {
+        // Чтение продолжит ходить в БД до следующей удачной загрузки
+        Log::error("Entity store load failed", { {"error", e.what()} });
+    }
+}
+
+void DatabaseModule::reloadEntities() {
+    entities_.invalidate();
+    post([this]() { loadEntities(); });
+}
+
+void DatabaseModule::scheduleConsistencyCheck() {
+    consistency_timer_.expires_after(consistency_interval_);
+    consistency_timer_.async_wait([this](const boost::system::error_code& ec) {
+        if (ec || consistency_stopping_) return;
+        try {
+            auto report = Consistency::checkClientCounters(*conn_);
+            if (report.repaired > 0) {
+                counter_repairs_.fetch_add(report.repaired, std::memory_order_relaxed);
+                Log::warning("Client counters drifted and were recalculated",
+                    { {"clients", report.repaired}, {"checked", report.checked} });
+            }
+        }
+        catch (const std::exception& e) {
+            Log::warning("Client counters check failed", { {"error", e.what()} });
+        }
+        scheduleConsistencyCheck();
+        });
+}
+
 void DatabaseModule::onShutdown() {
     std::cout << "[DatabaseModule] Shutting down database module...\n";
+    // Ожидающий таймер — тоже работа пула: без отмены join ждал бы следующей сверки
+    boost::asio::post(db_executor_, [this]() {
+        consistency_stopping_ = true;
+        consistency_timer_.cancel();
+        });
+    db_executor_.join();  // Дожидаемся запросов, уже стоящих в очереди
     conn_.reset();
     db_ready_.store(false);
 }
\ No newline at end of file
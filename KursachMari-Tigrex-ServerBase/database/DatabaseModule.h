@@ -1,9 +1,14 @@
 ﻿#pragma once
 
 #include "BaseModule.h"
+#include "EntityStore.h"
+#include "MetricsModule.h"
+#include "TracingModule.h"
 #include <boost/asio.hpp>
 #include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <pqxx/pqxx>
+#include <chrono>
 #include <memory>
 #include <iostream>
 
@@ -16,106 +21,20 @@ private:
     std::unique_ptr<pqxx::connection> conn_;
     std::atomic<bool> db_ready_{ false };
 
-    const std::string init_schema_sql_ = R"(
-        -- Команда агентства
-        CREATE TABLE IF NOT EXISTS team (
-            id SERIAL PRIMARY KEY,
-            fullname TEXT NOT NULL,
-            role TEXT NOT NULL,                     -- Например: Аккаунт-менеджер, Креативный директор, Медиапланер
-            workload NUMERIC(5,2) DEFAULT 0,         -- Процент загрузки (0-100)
-            created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-            updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-        );
-
-        -- Рабочие часы / нагрузка (можно использовать для расчёта workload)
-        CREATE TABLE IF NOT EXISTS work_hours (
-            employee_id INTEGER PRIMARY KEY REFERENCES team(id) ON DELETE CASCADE,
-            regular_hours NUMERIC(8,2) DEFAULT 0,
-            overtime NUMERIC(8,2) DEFAULT 0,
-            undertime NUMERIC(8,2) DEFAULT 0,
-            updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-        );
-
-        -- Клиенты агентства
-        CREATE TABLE IF NOT EXISTS clients (
-            id SERIAL PRIMARY KEY,
-            name TEXT NOT NULL,
-            contact TEXT,
-            status TEXT NOT NULL CHECK (status IN ('active', 'prospect', 'archived')) DEFAULT 'prospect',
-            total_budget NUMERIC(15,2) DEFAULT 0,
-            campaigns_count INTEGER DEFAULT 0,
-            created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-            updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-        );
-
-        -- Рекламные кампании
-        CREATE TABLE IF NOT EXISTS campaigns (
-            id SERIAL PRIMARY KEY,
-            client_id INTEGER NOT NULL REFERENCES clients(id) ON DELETE CASCADE,
-            name TEXT NOT NULL,
-            status TEXT NOT NULL CHECK (status IN ('planning', 'running', 'completed', 'paused')) DEFAULT 'planning',
-            budget NUMERIC(15,2) NOT NULL DEFAULT 0,
-            spent NUMERIC(15,2) DEFAULT 0,
-            start_date DATE,
-            end_date DATE,
-            roi NUMERIC(6,2),                        -- ROI только для завершённых кампаний
-            created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-            updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
-        );
-
-        -- Задачи по кампаниям
-        CREATE TABLE IF NOT EXISTS tasks (
-            id SERIAL PRIMARY KEY,
-            campaign_id INTEGER NOT NULL REFERENCES campaigns(id) ON DELETE CASCADE,
-            assignee_id INTEGER REFERENCES team(id) ON DELETE SET NULL,
-            title TEXT NOT NULL,
-            description TEXT,
-            status TEXT NOT NULL CHECK (status IN ('todo', 'in_progress', 'done')) DEFAULT 'todo',
-            due_date DATE,
-            created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
-            updated_at TIMESTAMP DEFAULT TIMESTAMP
-        );
-
-        -- Автоматическое обновление updated_at для всех таблиц с этим полем
-        CREATE OR REPLACE FUNCTION update_updated_at_column()
-        RETURNS TRIGGER AS $$
-        BEGIN
-            NEW.updated_at = CURRENT_TIMESTAMP;
-            RETURN NEW;
-        END;
-        $$ LANGUAGE plpgsql;
-
-        -- Применяем триггер ко всем таблицам, где есть updated_at
-        DROP TRIGGER IF EXISTS trg_update_team ON team;
-        CREATE TRIGGER trg_update_team
-            BEFORE UPDATE ON team
-            FOR EACH ROW
-            EXECUTE FUNCTION update_updated_at_column();
-
-        DROP TRIGGER IF EXISTS trg_update_clients ON clients;
-        CREATE TRIGGER trg_update_clients
-            BEFORE UPDATE ON clients
-            FOR EACH ROW
-            EXECUTE FUNCTION update_updated_at_column();
-
-        DROP TRIGGER IF EXISTS trg_update_campaigns ON campaigns;
-        CREATE TRIGGER trg_update_campaigns
-            BEFORE UPDATE ON campaigns
-            FOR EACH ROW
-            EXECUTE FUNCTION update_updated_at_column();
-
-        DROP TRIGGER IF EXISTS trg_update_tasks ON tasks;
-        CREATE TRIGGER trg_update_tasks
-            BEFORE UPDATE ON tasks
-            FOR EACH ROW
-            EXECUTE FUNCTION update_updated_at_column();
-
-        DROP TRIGGER IF EXISTS trg_update_work_hours ON work_hours;
-        CREATE TRIGGER trg_update_work_hours
-            BEFORE UPDATE ON work_hours
-            FOR EACH ROW
-            EXECUTE FUNCTION update_updated_at_column();
-    )";
+    // Выделенный поток для работы с БД: pqxx::connection не потокобезопасен,
+    // поэтому все запросы сериализуются здесь, а I/O-потоки продолжают обслуживать сеть
+    boost::asio::thread_pool db_executor_{ 1 };
+
+    // Фоновая сверка счётчиков clients с campaigns. Таймер живёт на потоке БД: проверка не ждёт очереди I/O,
+    // а сам таймер разрушается раньше пула
+    boost::asio::steady_timer consistency_timer_{ db_executor_ };
+    std::chrono::seconds consistency_interval_{ 0 };
+    bool consistency_stopping_ = false;  // Только на потоке БД
+    std::atomic<uint64_t> counter_repairs_{ 0 };
+
+    // NEW: реплика таблиц в памяти — загружается после миграций, дальше её ведут ApiProcessor и ChangeFeed
+    EntityStore entities_;
+    bool load_entities_on_start_ = true;
 
 public:
     explicit DatabaseModule(
@@ -134,10 +53,41 @@ public:
 
     bool isDatabaseReady() const { return db_ready_.load(); }
 
+    // Период сверки денормализованных счётчиков клиентов, 0 — выключена. Вызывать до initializeAll
+    void setConsistencyCheckInterval(std::chrono::seconds interval) { consistency_interval_ = interval; }
+    // Клиентов, чьи счётчики сверка нашла расходящимися и пересчитала
+    uint64_t getCounterRepairs() const { return counter_repairs_.load(std::memory_order_relaxed); }
+
+    EntityStore& entities() { return entities_; }
+    // false — реплику после миграций не читать: первую загрузку запустит ChangeFeed через reloadEntities,
+    // уже после LISTEN, и изменения между загрузкой и подпиской не потеряются. Вызывать до initializeAll
+    void setLoadEntitiesOnStart(bool enabled) { load_entities_on_start_ = enabled; }
+    // Сбросить реплику и перечитать её из БД (в очереди потока БД). До окончания чтения данные идут из SQL
+    void reloadEntities();
+
+    // Поставить работу с соединением в очередь потока БД.
+    // В метрики уходят ожидание в очереди (db_wait) и время самой работы (db).
+    // Контекст трассировки вызывающего потока переезжает вместе с задачей
+    template<class Task>
+    void post(Task&& task) {
+        boost::asio::post(db_executor_,
+            [task = std::forward<Task>(task), queued = std::chrono::steady_clock::now(), trace = TracingModule::current()]() mutable {
+                auto dequeued = std::chrono::steady_clock::now();
+                MetricsModule::recordPhase(MetricsModule::Phase::DbWait, dequeued - queued);
+                TraceContextScope trace_scope(trace);
+                if (trace) TracingModule::recordSpan(trace, "db_wait", queued, dequeued);
+                ScopedPhaseTimer timer(MetricsModule::Phase::Db);
+                TraceSpan span("db");
+                task();
+            });
+    }
+
 protected:
     bool onInitialize() override;
     void onShutdown() override;
 
 private:
     void asyncInitializeDatabase();
+    void scheduleConsistencyCheck();  // На потоке БД
+    void loadEntities();  // На потоке БД
 };
\ No newline at end of file
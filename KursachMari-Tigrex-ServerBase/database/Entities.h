@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include <optional>
+#include <string>
+
+/*
+# Entities
+    Строки четырёх таблиц в разобранном виде — для EntityStore. Разбор шаблонный по типу строки,
+    как в ApiConverters (row["column"], is_null(), c_str(), as<T>()). NUMERIC хранится в double,
+    даты и метки времени — текстом PostgreSQL: в JSON они уходят как есть.
+*/
+
+namespace Entities {
+
+    struct Client {
+        int id = 0;
+        std::string name;
+        std::optional<std::string> contact;
+        std::string status;
+        double total_budget = 0;
+        int campaigns_count = 0;
+        std::string created_at;
+        std::string updated_at;
+    };
+
+    struct Campaign {
+        int id = 0;
+        int client_id = 0;
+        std::string name;
+        std::string status;
+        double budget = 0;
+        double spent = 0;
+        std::optional<std::string> start_date;
+        std::optional<std::string> end_date;
+        std::optional<double> roi;
+        std::string created_at;
+        std::string updated_at;
+    };
+
+    struct Task {
+        int id = 0;
+        int campaign_id = 0;
+        std::optional<int> assignee_id;
+        std::string title;
+        std::optional<std::string> description;
+        std::string status;
+        std::optional<std::string> due_date;
+        std::string created_at;
+        std::string updated_at;
+    };
+
+    struct TeamMember {
+        int id = 0;
+        std::string fullname;
+        std::string role;
+        std::optional<double> workload;  // NULL не входит в AVG(workload) дашборда
+        std::string created_at;
+        std::string updated_at;
+    };
+
+    namespace detail {
+        template<class Field>
+        std::string text(const Field& field) {
+            return field.is_null() ? std::string() : std::string(field.c_str());
+        }
+
+        template<class Field>
+        std::optional<std::string> optionalText(const Field& field) {
+            return field.is_null() ? std::nullopt : std::make_optional(std::string(field.c_str()));
+        }
+
+        template<class T, class Field>
+        std::optional<T> optionalValue(const Field& field) {
+            return field.is_null() ? std::nullopt : std::make_optional(field.template as<T>());
+        }
+    }
+
+    template<class Row>
+    Client clientFromRow(const Row& row) {
+        Client c;
+        c.id = row["id"].template as<int>();
+        c.name = row["name"].c_str();
+        c.contact = detail::optionalText(row["contact"]);
+        c.status = row["status"].c_str();
+        c.total_budget = detail::optionalValue<double>(row["total_budget"]).value_or(0.0);
+        c.campaigns_count = detail::optionalValue<int>(row["campaigns_count"]).value_or(0);
+        c.created_at = detail::text(row["created_at"]);
+        c.updated_at = detail::text(row["updated_at"]);
+        return c;
+    }
+
+    template<class Row>
+    Campaign campaignFromRow(const Row& row) {
+        Campaign c;
+        c.id = row["id"].template as<int>();
+        c.client_id = row["client_id"].template as<int>();
+        c.name = row["name"].c_str();
+        c.status = row["status"].c_str();
+        c.budget = row["budget"].template as<double>();
+        c.spent = detail::optionalValue<double>(row["spent"]).value_or(0.0);
+        c.start_date = detail::optionalText(row["start_date"]);
+        c.end_date = detail::optionalText(row["end_date"]);
+        c.roi = detail::optionalValue<double>(row["roi"]);
+        c.created_at = detail::text(row["created_at"]);
+        c.updated_at = detail::text(row["updated_at"]);
+        return c;
+    }
+
+    template<class Row>
+    Task taskFromRow(const Row& row) {
+        Task t;
+        t.id = row["id"].template as<int>();
+        t.campaign_id = row["campaign_id"].template as<int>();
+        t.assignee_id = detail::optionalValue<int>(row["assignee_id"]);
+        t.title = row["title"].c_str();
+        t.description = detail::optionalText(row["description"]);
+        t.status = row["status"].c_str();
+        t.due_date = detail::optionalText(row["due_date"]);
+        t.created_at = detail::text(row["created_at"]);
+        t.updated_at = detail::text(row["updated_at"]);
+        return t;
+    }
+
+    template<class Row>
+    TeamMember teamMemberFromRow(const Row& row) {
+        TeamMember m;
+        m.id = row["id"].template as<int>();
+        m.fullname = row["fullname"].c_str();
+        m.role = row["role"].c_str();
+        m.workload = detail::optionalValue<double>(row["workload"]);
+        m.created_at = detail::text(row["created_at"]);
+        m.updated_at = detail::text(row["updated_at"]);
+        return m;
+    }
+
+}
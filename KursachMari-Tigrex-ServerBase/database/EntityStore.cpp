@@ -0,0 +1,398 @@
+﻿#include "EntityStore.h"
+#include "ApiConverters.h"
+#include "JsonWriter.h"
+
+#include <cmath>
+
+namespace {
+    bj::object toJson(const Entities::Client& c) { return ApiConverters::clientToJson(c); }
+    bj::object toJson(const Entities::Campaign& c) { return ApiConverters::campaignToJson(c); }
+    bj::object toJson(const Entities::Task& t) { return ApiConverters::taskToJson(t); }
+    bj::object toJson(const Entities::TeamMember& m) { return ApiConverters::teamMemberToJson(m); }
+
+    // Все записи таблицы JSON-массивом, текстом — для /api/all-data
+    template<class Map>
+    void writeRecords(JsonWriter& out, const Map& records) {
+        out.raw('[');
+        bool first = true;
+        for (const auto& [id, record] : records) {
+            if (!first) out.raw(',');
+            first = false;
+            ApiConverters::writeJson(out, record);
+        }
+        out.raw(']');
+    }
+
+    // Записи из индекса внешнего ключа, по возрастанию id
+    template<class Map>
+    bj::array toJsonArray(const Map& records, const std::unordered_map<int, std::set<int>>& index, int key) {
+        bj::array arr;
+        auto ids = index.find(key);
+        if (ids == index.end()) return arr;
+        arr.reserve(ids->second.size());
+        for (int id : ids->second) {
+            auto it = records.find(id);
+            if (it != records.end()) arr.emplace_back(toJson(it->second));
+        }
+        return arr;
+    }
+
+    template<class Map>
+    std::optional<bj::object> findJson(const Map& records, int id) {
+        auto it = records.find(id);
+        if (it == records.end()) return std::nullopt;
+        return toJson(it->second);
+    }
+
+    void link(std::unordered_map<int, std::set<int>>& index, int key, int id) {
+        index[key].insert(id);
+    }
+
+    void unlink(std::unordered_map<int, std::set<int>>& index, int key, int id) {
+        auto it = index.find(key);
+        if (it == index.end()) return;
+        it->second.erase(id);
+        if (it->second.empty()) index.erase(it);
+    }
+
+    template<class Map>
+    void latestTimestamp(std::string& latest, const Map& records) {
+        for (const auto& [id, record] : records) {
+            // Текст TIMESTAMP из PostgreSQL ("YYYY-MM-DD HH:MM:SS[.ffffff]") сравнивается как строка
+            if (record.created_at > latest) latest = record.created_at;
+            if (record.updated_at > latest) latest = record.updated_at;
+        }
+    }
+}
+
+// ==================== Tables ====================
+
+void EntityStore::Tables::upsert(Entities::Client&& client) {
+    dashboard.upsert(client);
+    int id = client.id;
+    clients[id] = std::move(client);
+}
+
+void EntityStore::Tables::upsert(Entities::Campaign&& campaign) {
+    auto it = campaigns.find(campaign.id);
+    if (it != campaigns.end() && it->second.client_id != campaign.client_id) {
+        unlink(campaigns_by_client, it->second.client_id, campaign.id);
+    }
+    link(campaigns_by_client, campaign.client_id, campaign.id);
+    dashboard.upsert(campaign);
+    int id = campaign.id;
+    campaigns[id] = std::move(campaign);
+}
+
+void EntityStore::Tables::upsert(Entities::Task&& task) {
+    auto it = tasks.find(task.id);
+    if (it != tasks.end()) {
+        if (it->second.campaign_id != task.campaign_id) unlink(tasks_by_campaign, it->second.campaign_id, task.id);
+        if (it->second.assignee_id && it->second.assignee_id != task.assignee_id) {
+            unlink(tasks_by_assignee, *it->second.assignee_id, task.id);
+        }
+    }
+    link(tasks_by_campaign, task.campaign_id, task.id);
+    if (task.assignee_id) link(tasks_by_assignee, *task.assignee_id, task.id);
+    int id = task.id;
+    tasks[id] = std::move(task);
+}
+
+void EntityStore::Tables::upsert(Entities::TeamMember&& member) {
+    dashboard.upsert(member);
+    int id = member.id;
+    team[id] = std::move(member);
+}
+
+// Удаление повторяет ON DELETE схемы: в БД эти строки ушли той же транзакцией
+void EntityStore::Tables::eraseClient(int id) {
+    if (auto it = campaigns_by_client.find(id); it != campaigns_by_client.end()) {
+        std::set<int> owned = std::move(it->second);
+        campaigns_by_client.erase(it);
+        for (int campaign_id : owned) eraseCampaign(campaign_id);
+    }
+    dashboard.eraseClient(id);
+    clients.erase(id);
+}
+
+void EntityStore::Tables::eraseCampaign(int id) {
+    auto it = campaigns.find(id);
+    if (it == campaigns.end()) return;
+    unlink(campaigns_by_client, it->second.client_id, id);
+    dashboard.eraseCampaign(id);
+    campaigns.erase(it);
+    if (auto owned = tasks_by_campaign.find(id); owned != tasks_by_campaign.end()) {
+        std::set<int> ids = std::move(owned->second);
+        tasks_by_campaign.erase(owned);
+        for (int task_id : ids) eraseTask(task_id);
+    }
+}
+
+void EntityStore::Tables::eraseTask(int id) {
+    auto it = tasks.find(id);
+    if (it == tasks.end()) return;
+    unlink(tasks_by_campaign, it->second.campaign_id, id);
+    if (it->second.assignee_id) unlink(tasks_by_assignee, *it->second.assignee_id, id);
+    tasks.erase(it);
+}
+
+void EntityStore::Tables::eraseTeamMember(int id) {
+    if (auto it = tasks_by_assignee.find(id); it != tasks_by_assignee.end()) {
+        for (int task_id : it->second) {
+            if (auto task = tasks.find(task_id); task != tasks.end()) task->second.assignee_id.reset();
+        }
+        tasks_by_assignee.erase(it);
+    }
+    dashboard.eraseTeamMember(id);
+    team.erase(id);
+}
+
+bool EntityStore::Tables::accept(std::unordered_map<int, uint64_t>& versions, int id, uint64_t version) {
+    if (version == 0) return true;
+    uint64_t& applied = versions[id];
+    if (version <= applied) return false;
+    applied = version;
+    return true;
+}
+
+// ==================== EntityStore ====================
+
+void EntityStore::load(pqxx::connection& conn) {
+    {
+        std::unique_lock lock(mutex_);
+        loading_ = true;
+        replay_.clear();
+    }
+
+    Tables fresh;
+    try {
+        // Один снимок на все таблицы: кампании не ссылаются на клиентов, которых в снимке нет
+        pqxx::work txn(conn);
+        txn.exec("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ READ ONLY");
+        for (const auto& row : txn.exec("SELECT * FROM clients")) fresh.upsert(Entities::clientFromRow(row));
+        for (const auto& row : txn.exec("SELECT * FROM campaigns")) fresh.upsert(Entities::campaignFromRow(row));
+        for (const auto& row : txn.exec("SELECT * FROM tasks")) fresh.upsert(Entities::taskFromRow(row));
+        for (const auto& row : txn.exec("SELECT * FROM team")) fresh.upsert(Entities::teamMemberFromRow(row));
+        txn.commit();
+    }
+    catch (...) {
+        std::unique_lock lock(mutex_);
+        loading_ = false;
+        replay_.clear();
+        throw;
+    }
+
+    std::unique_lock lock(mutex_);
+    // Изменения, пришедшие во время чтения, могли не попасть в снимок — повторяем их поверх
+    for (const auto& change : replay_) change(fresh);
+    replay_.clear();
+    data_ = std::move(fresh);
+    loading_ = false;
+    loaded_ = true;
+    ++generation_;
+    ++loads_;
+}
+
+void EntityStore::invalidate() {
+    std::unique_lock lock(mutex_);
+    loaded_ = false;
+}
+
+bool EntityStore::isLoaded() const {
+    std::shared_lock lock(mutex_);
+    return loaded_;
+}
+
+void EntityStore::write(Change change) {
+    std::unique_lock lock(mutex_);
+    change(data_);
+    if (loading_) replay_.push_back(std::move(change));
+    ++generation_;
+}
+
+// FIXED: версия в каждом изменении — write-through после коммита больше не откатывает строку,
+// которую ChangeFeed уже обновил более новым уведомлением
+void EntityStore::upsert(Entities::Client client, uint64_t version) {
+    write([client = std::move(client), version](Tables& t) {
+        if (Tables::accept(t.client_versions, client.id, version)) t.upsert(Entities::Client(client));
+        });
+}
+
+void EntityStore::upsert(Entities::Campaign campaign, uint64_t version) {
+    write([campaign = std::move(campaign), version](Tables& t) {
+        if (Tables::accept(t.campaign_versions, campaign.id, version)) t.upsert(Entities::Campaign(campaign));
+        });
+}
+
+void EntityStore::upsert(Entities::Task task, uint64_t version) {
+    write([task = std::move(task), version](Tables& t) {
+        if (Tables::accept(t.task_versions, task.id, version)) t.upsert(Entities::Task(task));
+        });
+}
+
+void EntityStore::upsert(Entities::TeamMember member, uint64_t version) {
+    write([member = std::move(member), version](Tables& t) {
+        if (Tables::accept(t.team_versions, member.id, version)) t.upsert(Entities::TeamMember(member));
+        });
+}
+
+void EntityStore::eraseClient(int id, uint64_t version) {
+    write([id, version](Tables& t) { if (Tables::accept(t.client_versions, id, version)) t.eraseClient(id); });
+}
+
+void EntityStore::eraseCampaign(int id, uint64_t version) {
+    write([id, version](Tables& t) { if (Tables::accept(t.campaign_versions, id, version)) t.eraseCampaign(id); });
+}
+
+void EntityStore::eraseTask(int id, uint64_t version) {
+    write([id, version](Tables& t) { if (Tables::accept(t.task_versions, id, version)) t.eraseTask(id); });
+}
+
+void EntityStore::eraseTeamMember(int id, uint64_t version) {
+    write([id, version](Tables& t) { if (Tables::accept(t.team_versions, id, version)) t.eraseTeamMember(id); });
+}
+
+void EntityStore::apply(std::string_view table, int id, const pqxx::row* row, uint64_t version) {
+    if (table == "clients") {
+        if (row) upsert(Entities::clientFromRow(*row), version); else eraseClient(id, version);
+    }
+    else if (table == "campaigns") {
+        if (row) upsert(Entities::campaignFromRow(*row), version); else eraseCampaign(id, version);
+    }
+    else if (table == "tasks") {
+        if (row) upsert(Entities::taskFromRow(*row), version); else eraseTask(id, version);
+    }
+    else if (table == "team") {
+        if (row) upsert(Entities::teamMemberFromRow(*row), version); else eraseTeamMember(id, version);
+    }
+}
+
+std::shared_ptr<const std::string> EntityStore::allDataJson() const {
+    std::shared_lock lock(mutex_);
+    if (!loaded_) return nullptr;
+
+    // Один рендер на изменение: остальные читатели ждут его и получают тот же буфер
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    if (!all_data_cache_ || all_data_generation_ != generation_) {
+        all_data_cache_ = std::make_shared<const std::string>(renderAllData());
+        all_data_generation_ = generation_;
+        ++all_data_renders_;
+    }
+    return all_data_cache_;
+}
+
+std::shared_ptr<const std::string> EntityStore::cachedAllDataJson() const {
+    std::shared_lock lock(mutex_);
+    if (!loaded_) return nullptr;
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    return all_data_generation_ == generation_ ? all_data_cache_ : nullptr;
+}
+
+std::optional<bj::object> EntityStore::dashboardJson() const {
+    std::shared_lock lock(mutex_);
+    if (!loaded_) return std::nullopt;
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    return renderDashboard();
+}
+
+bj::object EntityStore::renderDashboard() const {
+    // Те же агрегаты, что SQL в ApiProcessor::handleGetAllData, по столбцам в сотых
+    const DashboardColumns::Totals totals = data_.dashboard.totals();
+    double avg_roi = totals.completed_roi_count
+        ? static_cast<double>(totals.completed_roi_cents) / totals.completed_roi_count / 100.0 : 0.0;
+    double team_workload = totals.workload_count
+        ? static_cast<double>(totals.workload_cents) / totals.workload_count / 100.0 : 0.0;
+
+    bj::object dashboard;
+    dashboard["activeClients"] = static_cast<int>(totals.active_clients);
+    dashboard["activeCampaigns"] = static_cast<int>(totals.running_campaigns);
+    dashboard["totalBudget"] = static_cast<double>(totals.running_budget_cents) / 100.0;
+    dashboard["totalSpent"] = static_cast<double>(totals.running_spent_cents) / 100.0;
+    dashboard["avgRoi"] = std::round(avg_roi * 100.0) / 100.0;
+    dashboard["teamWorkload"] = static_cast<int>(std::round(team_workload));
+    return dashboard;
+}
+
+std::string EntityStore::renderAllData() const {
+    std::string last_updated = "1970-01-01 00:00:00";
+    latestTimestamp(last_updated, data_.clients);
+    latestTimestamp(last_updated, data_.campaigns);
+    latestTimestamp(last_updated, data_.tasks);
+    latestTimestamp(last_updated, data_.team);
+
+    // Тот же JSON, что bj::serialize объекта {dashboard, clients, campaigns, tasks, team, lastUpdated}, но записи
+    // пишутся текстом без дерева bj::value. Буфер — по размеру прошлого рендера, до первого — по числу записей
+    std::string body;
+    std::size_t records = data_.clients.size() + data_.campaigns.size() + data_.tasks.size() + data_.team.size();
+    body.reserve(all_data_size_hint_ ? all_data_size_hint_ + all_data_size_hint_ / 16 : 256 + records * 192);
+    JsonWriter out(body);
+    out.raw("{\"dashboard\":");
+    out.raw(bj::serialize(renderDashboard()));
+    out.raw(",\"clients\":");
+    writeRecords(out, data_.clients);
+    out.raw(",\"campaigns\":");
+    writeRecords(out, data_.campaigns);
+    out.raw(",\"tasks\":");
+    writeRecords(out, data_.tasks);
+    out.raw(",\"team\":");
+    writeRecords(out, data_.team);
+    out.raw(",\"lastUpdated\":");
+    out.string(last_updated);
+    out.raw('}');
+    all_data_size_hint_ = body.size();
+    return body;
+}
+
+std::optional<bj::object> EntityStore::client(int id) const {
+    std::shared_lock lock(mutex_);
+    return findJson(data_.clients, id);
+}
+
+std::optional<bj::object> EntityStore::campaign(int id) const {
+    std::shared_lock lock(mutex_);
+    return findJson(data_.campaigns, id);
+}
+
+std::optional<bj::object> EntityStore::task(int id) const {
+    std::shared_lock lock(mutex_);
+    return findJson(data_.tasks, id);
+}
+
+std::optional<bj::object> EntityStore::teamMember(int id) const {
+    std::shared_lock lock(mutex_);
+    return findJson(data_.team, id);
+}
+
+std::optional<bj::array> EntityStore::campaignsOfClient(int client_id) const {
+    std::shared_lock lock(mutex_);
+    if (!data_.clients.count(client_id)) return std::nullopt;
+    return toJsonArray(data_.campaigns, data_.campaigns_by_client, client_id);
+}
+
+std::optional<bj::array> EntityStore::tasksOfCampaign(int campaign_id) const {
+    std::shared_lock lock(mutex_);
+    if (!data_.campaigns.count(campaign_id)) return std::nullopt;
+    return toJsonArray(data_.tasks, data_.tasks_by_campaign, campaign_id);
+}
+
+std::optional<bj::array> EntityStore::tasksOfAssignee(int member_id) const {
+    std::shared_lock lock(mutex_);
+    if (!data_.team.count(member_id)) return std::nullopt;
+    return toJsonArray(data_.tasks, data_.tasks_by_assignee, member_id);
+}
+
+EntityStore::Stats EntityStore::getStats() const {
+    Stats stats;
+    {
+        std::shared_lock lock(mutex_);
+        stats.loaded = loaded_;
+        stats.clients = data_.clients.size();
+        stats.campaigns = data_.campaigns.size();
+        stats.tasks = data_.tasks.size();
+        stats.team = data_.team.size();
+        stats.loads = loads_;
+    }
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    stats.all_data_renders = all_data_renders_;
+    return stats;
+}
@@ -0,0 +1,144 @@
+﻿#pragma once
+
+#include "DashboardColumns.h"
+#include "Entities.h"
+
+#include <boost/json.hpp>
+#include <pqxx/pqxx>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace bj = boost::json;
+
+/*
+# EntityStore
+    Реплика clients, campaigns, tasks и team в памяти процесса. Источник истины — БД:
+    - load() читает все четыре таблицы одним снимком (REPEATABLE READ) — при старте и после resync ChangeFeed;
+    - ApiProcessor после коммита кладёт сюда строки из RETURNING * (write-through), поэтому узел сразу
+      видит собственные записи;
+    - записи других узлов приходят через ChangeFeed (apply).
+    Write-through (поток БД) и apply (поток ChangeFeed) не упорядочены между собой, поэтому каждое изменение
+    несёт версию из data_version_seq. Изменение строки с версией не новее уже применённой отбрасывается;
+    версии удалённых строк остаются, чтобы запоздавший upsert их не воскресил. Версия 0 — без проверки.
+    Индексы: по id (std::map — порядок как у ORDER BY id) и по внешним ключам client_id, campaign_id,
+    assignee_id. Удаление повторяет ON DELETE схемы: клиент -> кампании -> задачи, сотрудник -> assignee NULL.
+
+    Чтение — с любого потока под shared-блокировкой, без обращения к БД. Готовый JSON /api/all-data
+    кэшируется до следующего изменения. Цифры дашборда считаются по столбцам DashboardColumns.
+*/
+class EntityStore {
+public:
+    struct Stats {
+        bool loaded = false;
+        size_t clients = 0;
+        size_t campaigns = 0;
+        size_t tasks = 0;
+        size_t team = 0;
+        uint64_t loads = 0;
+        uint64_t all_data_renders = 0;
+    };
+
+    // Поток БД. Исключения pqxx пробрасываются, прежние данные остаются
+    void load(pqxx::connection& conn);
+    // Данные перестают считаться актуальными: чтение уходит в БД до следующей load()
+    void invalidate();
+    bool isLoaded() const;
+
+    // version — номер из data_version_seq, выданный записи (см. описание класса)
+    void upsert(Entities::Client client, uint64_t version);
+    void upsert(Entities::Campaign campaign, uint64_t version);
+    void upsert(Entities::Task task, uint64_t version);
+    void upsert(Entities::TeamMember member, uint64_t version);
+
+    void eraseClient(int id, uint64_t version);
+    void eraseCampaign(int id, uint64_t version);
+    void eraseTask(int id, uint64_t version);
+    void eraseTeamMember(int id, uint64_t version);
+
+    // Изменение из ChangeFeed: row — текущее состояние строки, nullptr — строка удалена
+    void apply(std::string_view table, int id, const pqxx::row* row, uint64_t version);
+
+    // nullptr — данные не загружены. Тело ответа /api/all-data, общее для всех читателей до изменения.
+    // Устаревшее тело перерисовывается здесь же — O(строк), поэтому вызывать с потока БД
+    std::shared_ptr<const std::string> allDataJson() const;
+    // То же без рендера, для I/O-потока: nullptr ещё и когда тело устарело после изменения
+    std::shared_ptr<const std::string> cachedAllDataJson() const;
+    // nullopt — данные не загружены. Объект "dashboard" из /api/all-data
+    std::optional<bj::object> dashboardJson() const;
+
+    std::optional<bj::object> client(int id) const;
+    std::optional<bj::object> campaign(int id) const;
+    std::optional<bj::object> task(int id) const;
+    std::optional<bj::object> teamMember(int id) const;
+
+    // nullopt — родительской записи нет
+    std::optional<bj::array> campaignsOfClient(int client_id) const;
+    std::optional<bj::array> tasksOfCampaign(int campaign_id) const;
+    std::optional<bj::array> tasksOfAssignee(int member_id) const;
+
+    Stats getStats() const;
+
+private:
+    struct Tables {
+        std::map<int, Entities::Client> clients;
+        std::map<int, Entities::Campaign> campaigns;
+        std::map<int, Entities::Task> tasks;
+        std::map<int, Entities::TeamMember> team;
+
+        std::unordered_map<int, std::set<int>> campaigns_by_client;
+        std::unordered_map<int, std::set<int>> tasks_by_campaign;
+        std::unordered_map<int, std::set<int>> tasks_by_assignee;
+
+        DashboardColumns dashboard;  // Столбцы для агрегатов дашборда, ведутся вместе с записями
+
+        // id -> версия последнего принятого изменения, включая удаления. Снимок load() начинается с пустых
+        std::unordered_map<int, uint64_t> client_versions;
+        std::unordered_map<int, uint64_t> campaign_versions;
+        std::unordered_map<int, uint64_t> task_versions;
+        std::unordered_map<int, uint64_t> team_versions;
+
+        // true — изменение новее применённого (и версия запомнена), false — его нужно отбросить
+        static bool accept(std::unordered_map<int, uint64_t>& versions, int id, uint64_t version);
+
+        void upsert(Entities::Client&& client);
+        void upsert(Entities::Campaign&& campaign);
+        void upsert(Entities::Task&& task);
+        void upsert(Entities::TeamMember&& member);
+        void eraseClient(int id);
+        void eraseCampaign(int id);
+        void eraseTask(int id);
+        void eraseTeamMember(int id);
+    };
+
+    using Change = std::function<void(Tables&)>;
+
+    // Под unique-блокировкой; во время load() изменение ещё и запоминается, чтобы повторить его на новом снимке
+    void write(Change change);
+    std::string renderAllData() const;  // Под shared-блокировкой и cache_mutex_
+    bj::object renderDashboard() const;  // То же: DashboardColumns::totals() не вызывается параллельно
+
+    mutable std::shared_mutex mutex_;
+    Tables data_;
+    bool loaded_ = false;
+    bool loading_ = false;
+    std::vector<Change> replay_;
+    uint64_t generation_ = 0;  // Растёт с каждым изменением
+    uint64_t loads_ = 0;
+
+    mutable std::mutex cache_mutex_;
+    mutable std::shared_ptr<const std::string> all_data_cache_;
+    mutable uint64_t all_data_generation_ = 0;
+    mutable uint64_t all_data_renders_ = 0;
+    mutable std::size_t all_data_size_hint_ = 0;  // Размер прошлого рендера — под ним же cache_mutex_
+};
@@ -0,0 +1,315 @@
+﻿#include "Migrations.h"
+
+#include <iostream>
+#include <map>
+#include <stdexcept>
+
+namespace {
+    // Ключ pg_advisory_xact_lock: любое постоянное число, общее для всех процессов сервера
+    constexpr long long kMigrationLockKey = 0x4D6F6453727631;  // "ModSrv1"
+
+    // 1 — схема, которую сервер раньше прогонял целиком на каждом старте. Идемпотентна, поэтому на базе,
+    // созданной старым скриптом, просто регистрируется. tasks.updated_at: DEFAULT CURRENT_TIMESTAMP
+    // (в старом скрипте было DEFAULT TIMESTAMP)
+    constexpr std::string_view kInitialSchema = R"(
+        -- Команда агентства
+        CREATE TABLE IF NOT EXISTS team (
+            id SERIAL PRIMARY KEY,
+            fullname TEXT NOT NULL,
+            role TEXT NOT NULL,                     -- Например: Аккаунт-менеджер, Креативный директор, Медиапланер
+            workload NUMERIC(5,2) DEFAULT 0,         -- Процент загрузки (0-100)
+            created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+            updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+        );
+
+        -- Рабочие часы / нагрузка (можно использовать для расчёта workload)
+        CREATE TABLE IF NOT EXISTS work_hours (
+            employee_id INTEGER PRIMARY KEY REFERENCES team(id) ON DELETE CASCADE,
+            regular_hours NUMERIC(8,2) DEFAULT 0,
+            overtime NUMERIC(8,2) DEFAULT 0,
+            undertime NUMERIC(8,2) DEFAULT 0,
+            updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+        );
+
+        -- Клиенты агентства
+        CREATE TABLE IF NOT EXISTS clients (
+            id SERIAL PRIMARY KEY,
+            name TEXT NOT NULL,
+            contact TEXT,
+            status TEXT NOT NULL CHECK (status IN ('active', 'prospect', 'archived')) DEFAULT 'prospect',
+            total_budget NUMERIC(15,2) DEFAULT 0,
+            campaigns_count INTEGER DEFAULT 0,
+            created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+            updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+        );
+
+        -- Рекламные кампании
+        CREATE TABLE IF NOT EXISTS campaigns (
+            id SERIAL PRIMARY KEY,
+            client_id INTEGER NOT NULL REFERENCES clients(id) ON DELETE CASCADE,
+            name TEXT NOT NULL,
+            status TEXT NOT NULL CHECK (status IN ('planning', 'running', 'completed', 'paused')) DEFAULT 'planning',
+            budget NUMERIC(15,2) NOT NULL DEFAULT 0,
+            spent NUMERIC(15,2) DEFAULT 0,
+            start_date DATE,
+            end_date DATE,
+            roi NUMERIC(6,2),                        -- ROI только для завершённых кампаний
+            created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+            updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+        );
+
+        -- Задачи по кампаниям
+        CREATE TABLE IF NOT EXISTS tasks (
+            id SERIAL PRIMARY KEY,
+            campaign_id INTEGER NOT NULL REFERENCES campaigns(id) ON DELETE CASCADE,
+            assignee_id INTEGER REFERENCES team(id) ON DELETE SET NULL,
+            title TEXT NOT NULL,
+            description TEXT,
+            status TEXT NOT NULL CHECK (status IN ('todo', 'in_progress', 'done')) DEFAULT 'todo',
+            due_date DATE,
+            created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
+            updated_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
+        );
+
+        -- Автоматическое обновление updated_at для всех таблиц с этим полем
+        CREATE OR REPLACE FUNCTION update_updated_at_column()
+        RETURNS TRIGGER AS $$
+        BEGIN
+            NEW.updated_at = CURRENT_TIMESTAMP;
+            RETURN NEW;
+        END;
+        $$ LANGUAGE plpgsql;
+
+        -- Применяем триггер ко всем таблицам, где есть updated_at
+        DROP TRIGGER IF EXISTS trg_update_team ON team;
+        CREATE TRIGGER trg_update_team
+            BEFORE UPDATE ON team
+            FOR EACH ROW
+            EXECUTE FUNCTION update_updated_at_column();
+
+        DROP TRIGGER IF EXISTS trg_update_clients ON clients;
+        CREATE TRIGGER trg_update_clients
+            BEFORE UPDATE ON clients
+            FOR EACH ROW
+            EXECUTE FUNCTION update_updated_at_column();
+
+        DROP TRIGGER IF EXISTS trg_update_campaigns ON campaigns;
+        CREATE TRIGGER trg_update_campaigns
+            BEFORE UPDATE ON campaigns
+            FOR EACH ROW
+            EXECUTE FUNCTION update_updated_at_column();
+
+        DROP TRIGGER IF EXISTS trg_update_tasks ON tasks;
+        CREATE TRIGGER trg_update_tasks
+            BEFORE UPDATE ON tasks
+            FOR EACH ROW
+            EXECUTE FUNCTION update_updated_at_column();
+
+        DROP TRIGGER IF EXISTS trg_update_work_hours ON work_hours;
+        CREATE TRIGGER trg_update_work_hours
+            BEFORE UPDATE ON work_hours
+            FOR EACH ROW
+            EXECUTE FUNCTION update_updated_at_column();
+)";
+
+    // 2 — clients.total_budget и campaigns_count ведутся триггерами на campaigns: чтение клиента — O(1) без GROUP BY.
+    // UPDATE срабатывает только при смене бюджета или клиента; перенос кампании — минус у старого, плюс у нового
+    constexpr std::string_view kClientCampaignCounters = R"(
+        -- Старый процесс при горячем перезапуске ещё пишет: до коммита кампании не меняются, пересчёт точен
+        LOCK TABLE campaigns IN SHARE MODE;
+
+        UPDATE clients c SET
+            total_budget = COALESCE(s.total, 0),
+            campaigns_count = COALESCE(s.cnt, 0)
+        FROM clients cl
+        LEFT JOIN (SELECT client_id, SUM(budget) AS total, COUNT(*) AS cnt FROM campaigns GROUP BY client_id) s
+            ON s.client_id = cl.id
+        WHERE c.id = cl.id;
+
+        ALTER TABLE clients
+            ALTER COLUMN total_budget SET NOT NULL,
+            ALTER COLUMN campaigns_count SET NOT NULL;
+
+        CREATE OR REPLACE FUNCTION update_client_campaign_counters()
+        RETURNS TRIGGER AS $$
+        BEGIN
+            IF TG_OP IN ('UPDATE', 'DELETE') THEN
+                UPDATE clients
+                SET total_budget = total_budget - OLD.budget, campaigns_count = campaigns_count - 1
+                WHERE id = OLD.client_id;
+            END IF;
+            IF TG_OP IN ('INSERT', 'UPDATE') THEN
+                UPDATE clients
+                SET total_budget = total_budget + NEW.budget, campaigns_count = campaigns_count + 1
+                WHERE id = NEW.client_id;
+            END IF;
+            RETURN NULL;
+        END;
+        $$ LANGUAGE plpgsql;
+
+        CREATE TRIGGER trg_campaigns_client_counters
+            AFTER INSERT OR DELETE ON campaigns
+            FOR EACH ROW
+            EXECUTE FUNCTION update_client_campaign_counters();
+
+        CREATE TRIGGER trg_campaigns_client_counters_update
+            AFTER UPDATE OF budget, client_id ON campaigns
+            FOR EACH ROW
+            WHEN (OLD.budget IS DISTINCT FROM NEW.budget OR OLD.client_id IS DISTINCT FROM NEW.client_id)
+            EXECUTE FUNCTION update_client_campaign_counters();
+    )";
+
+    // 3 — уведомления об изменениях для ChangeFeed: канал data_changes, полезная нагрузка {"table","op","id"}.
+    // NOTIFY доставляется при коммите; одинаковые уведомления одной транзакции PostgreSQL схлопывает
+    constexpr std::string_view kChangeNotifications = R"(
+        CREATE OR REPLACE FUNCTION notify_data_change()
+        RETURNS TRIGGER AS $$
+        DECLARE
+            row_id INTEGER;
+        BEGIN
+            IF TG_OP = 'DELETE' THEN
+                row_id := OLD.id;
+            ELSE
+                row_id := NEW.id;
+            END IF;
+            PERFORM pg_notify('data_changes',
+                json_build_object('table', TG_TABLE_NAME, 'op', lower(TG_OP), 'id', row_id)::text);
+            RETURN NULL;
+        END;
+        $$ LANGUAGE plpgsql;
+
+        CREATE TRIGGER trg_notify_clients
+            AFTER INSERT OR UPDATE OR DELETE ON clients
+            FOR EACH ROW
+            EXECUTE FUNCTION notify_data_change();
+
+        CREATE TRIGGER trg_notify_campaigns
+            AFTER INSERT OR UPDATE OR DELETE ON campaigns
+            FOR EACH ROW
+            EXECUTE FUNCTION notify_data_change();
+
+        CREATE TRIGGER trg_notify_tasks
+            AFTER INSERT OR UPDATE OR DELETE ON tasks
+            FOR EACH ROW
+            EXECUTE FUNCTION notify_data_change();
+
+        CREATE TRIGGER trg_notify_team
+            AFTER INSERT OR UPDATE OR DELETE ON team
+            FOR EACH ROW
+            EXECUTE FUNCTION notify_data_change();
+    )";
+
+    // 4 — версия данных для согласованности кэшей между узлами: каждое изменение строки получает номер
+    // из общей последовательности, уведомление его несёт. Узел, применивший уведомление, знает, что его кэши
+    // не старее этой версии. Номера монотонны по выдаче, а не по коммиту — узлы реагируют на каждое уведомление
+    constexpr std::string_view kDataVersion = R"(
+        CREATE SEQUENCE IF NOT EXISTS data_version_seq;
+
+        CREATE OR REPLACE FUNCTION notify_data_change()
+        RETURNS TRIGGER AS $$
+        DECLARE
+            row_id INTEGER;
+        BEGIN
+            IF TG_OP = 'DELETE' THEN
+                row_id := OLD.id;
+            ELSE
+                row_id := NEW.id;
+            END IF;
+            PERFORM pg_notify('data_changes',
+                json_build_object('table', TG_TABLE_NAME, 'op', lower(TG_OP), 'id', row_id,
+                    'version', nextval('data_version_seq'))::text);
+            RETURN NULL;
+        END;
+        $$ LANGUAGE plpgsql;
+    )";
+
+    const char* kCreateMigrationsTable = R"(
+        CREATE TABLE IF NOT EXISTS schema_migrations (
+            version INTEGER PRIMARY KEY,
+            name TEXT NOT NULL,
+            checksum TEXT NOT NULL,
+            applied_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP
+        )
+    )";
+
+    // Применённые версии -> контрольная сумма
+    std::map<int, std::string> readApplied(pqxx::transaction_base& txn) {
+        std::map<int, std::string> applied;
+        for (const auto& row : txn.exec("SELECT version, checksum FROM schema_migrations")) {
+            applied.emplace(row[0].as<int>(), row[1].as<std::string>());
+        }
+        return applied;
+    }
+
+    // Сверка с кодом. Возвращает true, если применены все миграции
+    bool verify(const std::map<int, std::string>& applied) {
+        for (const auto& migration : Migrations::all()) {
+            auto it = applied.find(migration.version);
+            if (it == applied.end()) return false;
+            if (it->second != Migrations::checksum(migration.sql)) {
+                throw std::runtime_error("Migration " + std::to_string(migration.version) + " '" + std::string(migration.name)
+                    + "' was changed after it had been applied; add a new migration instead");
+            }
+        }
+        return true;
+    }
+}
+
+namespace Migrations {
+
+    const std::vector<Migration>& all() {
+        static const std::vector<Migration> migrations = {
+            { 1, "initial_schema", kInitialSchema },
+            { 2, "client_campaign_counters", kClientCampaignCounters },
+            { 3, "change_notifications", kChangeNotifications },
+            { 4, "data_version", kDataVersion },
+        };
+        return migrations;
+    }
+
+    std::string checksum(std::string_view sql) {
+        uint64_t hash = 14695981039346656037ull;
+        for (unsigned char c : sql) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        static const char digits[] = "0123456789abcdef";
+        std::string out(16, '0');
+        for (int i = 15; i >= 0; --i, hash >>= 4) {
+            out[i] = digits[hash & 0xF];
+        }
+        return out;
+    }
+
+    Result apply(pqxx::connection& conn) {
+        Result result;
+        result.current_version = all().empty() ? 0 : all().back().version;
+
+        // Быстрый путь: один SELECT без блокировок и DDL
+        try {
+            pqxx::nontransaction probe(conn);
+            if (verify(readApplied(probe))) return result;
+        }
+        catch (const pqxx::undefined_table&) {
+            // Первый запуск на этой базе: таблицы учёта ещё нет
+        }
+
+        // Медленный путь: всё в одной транзакции, под блокировкой — параллельный процесс подождёт и увидит готовую схему
+        pqxx::work txn(conn);
+        txn.exec("SELECT pg_advisory_xact_lock(" + std::to_string(kMigrationLockKey) + ")");
+        txn.exec(kCreateMigrationsTable);
+        auto applied = readApplied(txn);
+        verify(applied);
+        for (const auto& migration : all()) {
+            if (applied.count(migration.version)) continue;
+            std::cout << "[Migrations] Applying " << migration.version << " " << migration.name << std::endl;
+            txn.exec(std::string(migration.sql));
+            txn.exec_params("INSERT INTO schema_migrations (version, name, checksum) VALUES ($1, $2, $3)",
+                migration.version, std::string(migration.name), checksum(migration.sql));
+            ++result.applied;
+        }
+        txn.commit();
+        return result;
+    }
+
+}
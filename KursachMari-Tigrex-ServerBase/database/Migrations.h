@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <pqxx/pqxx>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Версионированные миграции схемы. Применённые записываются в schema_migrations вместе с контрольной суммой SQL.
+// Запуск с актуальной схемой стоит одного SELECT; DDL и блокировки — только когда есть новые шаги.
+// Применённую миграцию не редактируют: изменение схемы — это новый шаг в конце списка
+namespace Migrations {
+
+    struct Migration {
+        int version;
+        std::string_view name;
+        std::string_view sql;
+    };
+
+    struct Result {
+        int current_version = 0;  // Последняя применённая версия
+        int applied = 0;          // Применено за этот запуск
+    };
+
+    // Все миграции по возрастанию версий
+    const std::vector<Migration>& all();
+
+    // FNV-1a 64 бита в hex: стабильна между сборками и платформами
+    std::string checksum(std::string_view sql);
+
+    // Привести схему к последней версии. Несколько процессов (горячий перезапуск) сериализуются
+    // advisory-блокировкой. Бросает, если SQL применённой миграции изменился
+    Result apply(pqxx::connection& conn);
+
+}
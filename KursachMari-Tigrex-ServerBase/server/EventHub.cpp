@@ -0,0 +1,200 @@
+﻿#include "EventHub.h"
+#include "LoggingModule.h"
+#include "MetricsModule.h"
+
+#include <boost/asio/post.hpp>
+#include <boost/asio/write.hpp>
+
+#include <array>
+#include <deque>
+#include <vector>
+
+namespace {
+    EventHub::Frame makeHeaders(unsigned version) {
+        std::string headers = version == 10 ? "HTTP/1.0 200 OK\r\n" : "HTTP/1.1 200 OK\r\n";
+        headers +=
+            "Server: ModularServer\r\n"
+            "Content-Type: text/event-stream\r\n"
+            "Cache-Control: no-cache\r\n"
+            "X-Accel-Buffering: no\r\n"
+            "\r\n"
+            "retry: 3000\n\n";
+        return std::make_shared<const std::string>(std::move(headers));
+    }
+
+    const EventHub::Frame& heartbeatFrame() {
+        static const EventHub::Frame frame = std::make_shared<const std::string>(":\n\n");
+        return frame;
+    }
+}
+
+class EventHub::Subscriber : public std::enable_shared_from_this<Subscriber> {
+public:
+    Subscriber(EventHub& hub, net::ip::tcp::socket socket, DoSProtectionModule::ConnectionGuard connection)
+        : hub_(hub), stream_(std::move(socket)), connection_(std::move(connection)) {
+    }
+
+    void start(Frame headers) {
+        stream_.expires_never();
+        watch();
+        send(std::move(headers));
+    }
+
+    void send(Frame frame) {
+        if (closed_) return;
+        if (queue_.size() >= hub_.settings_.max_queue) {
+            hub_.dropped_slow_.fetch_add(1, std::memory_order_relaxed);
+            close();
+            return;
+        }
+        queue_.push_back(std::move(frame));
+        if (!writing_) writeNext();
+    }
+
+    void close() {
+        if (closed_) return;
+        closed_ = true;
+        auto self = shared_from_this();  // remove() отпускает ссылку хаба
+        beast::error_code ec;
+        stream_.socket().shutdown(net::socket_base::shutdown_both, ec);
+        stream_.close();
+        hub_.remove(this);
+    }
+
+private:
+    // Клиент SSE ничего не отправляет: чтение нужно, чтобы заметить закрытие соединения
+    void watch() {
+        stream_.async_read_some(net::buffer(sink_), [self = shared_from_this()](beast::error_code ec, std::size_t) {
+            if (ec) {
+                self->close();
+                return;
+            }
+            self->watch();
+            });
+    }
+
+    void writeNext() {
+        writing_ = true;
+        stream_.expires_after(hub_.settings_.write_timeout);
+        net::async_write(stream_, net::buffer(*queue_.front()), [self = shared_from_this()](beast::error_code ec, std::size_t) {
+            self->writing_ = false;
+            if (ec) {
+                self->close();
+                return;
+            }
+            self->queue_.pop_front();
+            if (!self->queue_.empty()) {
+                self->writeNext();
+            }
+            else {
+                self->stream_.expires_never();  // Таймаут только на запись, ожидание событий не ограничено
+            }
+            });
+    }
+
+    EventHub& hub_;
+    beast::tcp_stream stream_;
+    DoSProtectionModule::ConnectionGuard connection_;
+    std::deque<Frame> queue_;
+    std::array<char, 64> sink_{};
+    bool writing_ = false;
+    bool closed_ = false;
+};
+
+EventHub::EventHub(net::io_context& ioc)
+    : EventHub(ioc, Settings{}) {
+}
+
+EventHub::EventHub(net::io_context& ioc, const Settings& settings)
+    : BaseModule("EventHub"), ioc_(ioc), settings_(settings) {
+    dependsOn<LoggingModule>();
+    dependsOn<MetricsModule>();
+}
+
+EventHub::~EventHub() {
+    shutdown();
+}
+
+bool EventHub::onInitialize() {
+    closing_ = false;
+    heartbeat_timer_ = std::make_unique<net::steady_timer>(ioc_);
+    scheduleHeartbeat();
+    return true;
+}
+
+void EventHub::onShutdown() {
+    closeAll();
+    heartbeat_timer_.reset();
+}
+
+void EventHub::publish(std::string_view event, std::string_view data) {
+    std::string text = "id: " + std::to_string(next_event_id_.fetch_add(1, std::memory_order_relaxed)) + "\n";
+    text += "event: ";
+    text.append(event.data(), event.size());
+    text += "\ndata: ";
+    text.append(data.data(), data.size());
+    text += "\n\n";
+    Frame frame = std::make_shared<const std::string>(std::move(text));
+    net::post(ioc_, [this, frame = std::move(frame)]() { broadcast(frame); });
+}
+
+void EventHub::subscribe(net::ip::tcp::socket socket, DoSProtectionModule::ConnectionGuard connection, unsigned version) {
+    static const int events_metrics_id = MetricsModule::registerRoute(kPath);
+    if (closing_ || subscribers_.size() >= settings_.max_subscribers) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        static const std::string unavailable =
+            "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 5\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        beast::error_code ec;
+        net::write(socket, net::buffer(unavailable), ec);
+        socket.shutdown(net::socket_base::shutdown_both, ec);
+        MetricsModule::recordRequest(events_metrics_id, 503, std::chrono::nanoseconds(0));
+        return;
+    }
+    auto subscriber = std::make_shared<Subscriber>(*this, std::move(socket), std::move(connection));
+    subscribers_.emplace(subscriber.get(), subscriber);
+    subscriber_count_.store(subscribers_.size(), std::memory_order_relaxed);
+    MetricsModule::recordRequest(events_metrics_id, 200, std::chrono::nanoseconds(0));
+    subscriber->start(makeHeaders(version));
+}
+
+void EventHub::closeAll() {
+    closing_ = true;
+    if (subscribers_.empty()) return;
+    Log::info("EventHub: closing event streams", { {"subscribers", subscribers_.size()} });
+    std::vector<std::shared_ptr<Subscriber>> all;
+    all.reserve(subscribers_.size());
+    for (auto& [ptr, subscriber] : subscribers_) all.push_back(subscriber);
+    for (auto& subscriber : all) subscriber->close();
+}
+
+EventHub::Stats EventHub::getStats() const {
+    Stats stats;
+    stats.subscribers = subscriber_count_.load(std::memory_order_relaxed);
+    stats.events = next_event_id_.load(std::memory_order_relaxed) - 1;
+    stats.dropped_slow = dropped_slow_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void EventHub::broadcast(const Frame& frame) {
+    if (subscribers_.empty()) return;
+    // Копия: send может отключить медленного подписчика и изменить карту
+    std::vector<std::shared_ptr<Subscriber>> all;
+    all.reserve(subscribers_.size());
+    for (auto& [ptr, subscriber] : subscribers_) all.push_back(subscriber);
+    for (auto& subscriber : all) subscriber->send(frame);
+}
+
+void EventHub::scheduleHeartbeat() {
+    heartbeat_timer_->expires_after(settings_.heartbeat);
+    heartbeat_timer_->async_wait([this](const beast::error_code& ec) {
+        if (ec || !heartbeat_timer_) return;
+        broadcast(heartbeatFrame());
+        scheduleHeartbeat();
+        });
+}
+
+void EventHub::remove(Subscriber* subscriber) {
+    subscribers_.erase(subscriber);
+    subscriber_count_.store(subscribers_.size(), std::memory_order_relaxed);
+}
@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+#include "DoSProtectionModule.h"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+
+/*
+# EventHub
+    Server-Sent Events на GET /api/events. Сессия, получив такой запрос, передаёт соединение сюда
+    (вместе с местом в лимитах соединений) и завершается. Событие сериализуется в кадр SSE один раз,
+    подписчики держат в очереди общий shared_ptr на него. Подписчик, у которого очередь переполнилась
+    (не читает), отключается: EventSource переподключится и перечитает данные.
+    Подписчики живут на I/O-потоке; publish можно вызывать с любого потока.
+*/
+class EventHub : public BaseModule {
+public:
+    struct Settings {
+        size_t max_subscribers = 10000;
+        size_t max_queue = 64;                       // Кадров в очереди подписчика
+        std::chrono::seconds heartbeat{ 15 };        // Комментарий-пинг: держит прокси и выявляет мёртвые соединения
+        std::chrono::seconds write_timeout{ 30 };
+    };
+
+    struct Stats {
+        size_t subscribers = 0;
+        uint64_t events = 0;
+        uint64_t dropped_slow = 0;
+        uint64_t rejected = 0;
+    };
+
+    using Frame = std::shared_ptr<const std::string>;
+
+    static constexpr std::string_view kPath = "/api/events";
+
+    explicit EventHub(net::io_context& ioc);
+    EventHub(net::io_context& ioc, const Settings& settings);
+    ~EventHub() override;
+
+    // Любой поток. data — одна строка (JSON без переводов строк)
+    void publish(std::string_view event, std::string_view data);
+
+    // I/O-поток: ответ 200 text/event-stream, дальше соединение принадлежит EventHub
+    void subscribe(net::ip::tcp::socket socket, DoSProtectionModule::ConnectionGuard connection, unsigned version);
+
+    // I/O-поток: закрыть все потоки событий (остановка сервера); новые подписки отклоняются
+    void closeAll();
+
+    Stats getStats() const;
+
+protected:
+    bool onInitialize() override;
+    void onShutdown() override;
+
+private:
+    class Subscriber;
+
+    void broadcast(const Frame& frame);
+    void scheduleHeartbeat();
+    void remove(Subscriber* subscriber);
+
+    net::io_context& ioc_;
+    Settings settings_;
+    std::unique_ptr<net::steady_timer> heartbeat_timer_;  // Сбрасывается в onShutdown, пока жив io_context
+    std::unordered_map<Subscriber*, std::shared_ptr<Subscriber>> subscribers_;  // Только I/O-поток
+    bool closing_ = false;
+
+    std::atomic<uint64_t> next_event_id_{ 1 };
+    std::atomic<size_t> subscriber_count_{ 0 };
+    std::atomic<uint64_t> dropped_slow_{ 0 };
+    std::atomic<uint64_t> rejected_{ 0 };
+};
@@ -1,4 +1,6 @@
 ﻿#include "FileCache.h"
+#include "LoggingModule.h"
+#include "MetricsModule.h"
 #include <iostream>
 #include <fstream>
 #include <algorithm>  // Для std::transform
@@ -41,7 +43,7 @@ namespace {
             }
         }
         catch (const std::exception& e) {
-            std::cerr << "Error reading file " << file_path << ": " << e.what() << std::endl;
+            Log::error("Error reading file", { {"path", file_path.string()}, {"error", e.what()} });
         }
         return std::nullopt;
     }
@@ -59,15 +61,30 @@ FileCache::FileCache(const std::string& base_dir, bool enable_cache, size_t max_
 }
 
 // onInitialize (модульный: лог + проверка)
+// NEW: прогрев — файлы читаются в кэш до первого запроса, параллельно с инициализацией других модулей
 bool FileCache::onInitialize() {
     if (route_to_path_.empty()) {
+        // Сервер может работать только с API: пустая папка static — не ошибка запуска
         std::cerr << "Warning: No routes mapped in FileCache for " << base_directory_ << std::endl;
-        return false;
+        return true;
     }
-    std::cout << "FileCache onInitialize: " << route_to_path_.size() << " routes ready." << std::endl;
+    size_t warmed = warm_up();
+    std::cout << "FileCache onInitialize: " << route_to_path_.size() << " routes ready, " << warmed << " files preloaded." << std::endl;
     return true;
 }
 
+size_t FileCache::warm_up() {
+    if (!cache_enabled_) return 0;
+    std::vector<std::string> routes = get_all_routes();
+    std::sort(routes.begin(), routes.end());  // Детерминированный набор, если файлов больше, чем мест в кэше
+    size_t warmed = 0;
+    for (const auto& route : routes) {
+        if (warmed >= max_cache_size_) break;  // Дальше preload_file начал бы вытеснять только что прочитанное
+        if (preload_file(route)) ++warmed;
+    }
+    return warmed;
+}
+
 // onShutdown (модульный: clear + лог)
 void FileCache::onShutdown() {
     clear_cache();
@@ -200,7 +217,7 @@ void FileCache::scan_directory(const fs::path& directory) {
         }
     }
     catch (const std::exception& e) {
-        std::cerr << "Error scanning directory " << directory << ": " << e.what() << std::endl;
+        Log::error("Error scanning directory", { {"path", directory.string()}, {"error", e.what()} });
     }
 }
 
@@ -223,7 +240,7 @@ std::optional<FileCache::CachedFile> FileCache::load_file_from_disk(const fs::pa
         return cached_file;
     }
     catch (const std::exception& e) {
-        std::cerr << "Error creating cached file for " << file_path << ": " << e.what() << std::endl;
+        Log::error("Error creating cached file", { {"path", file_path.string()}, {"error", e.what()} });
         return std::nullopt;
     }
 }
@@ -262,20 +279,27 @@ std::optional<FileCache::CachedFile> FileCache::get_file(const std::string& rout
     // Проверяем, существует ли такой маршрут
     auto path_it = route_to_path_.find(route);
     if (path_it == route_to_path_.end()) {
+        MetricsModule::increment(MetricsModule::Counter::FileCacheMisses);
         return std::nullopt;
     }
     fs::path file_path = path_it->second;
     // Если кэш отключен, загружаем файл с диска каждый раз
     if (!cache_enabled_) {
-        return load_file_from_disk(file_path);
+        MetricsModule::increment(MetricsModule::Counter::FileCacheMisses);
+        auto loaded = load_file_from_disk(file_path);
+        if (loaded) MetricsModule::increment(MetricsModule::Counter::FileCacheBytes, loaded->size);
+        return loaded;
     }
     // Проверяем, есть ли файл в кэше
     auto cache_it = file_cache_.find(route);
     if (cache_it != file_cache_.end()) {
         // Обновляем время доступа
         cache_it->second.last_accessed = std::chrono::system_clock::now();
+        MetricsModule::increment(MetricsModule::Counter::FileCacheHits);
+        MetricsModule::increment(MetricsModule::Counter::FileCacheBytes, cache_it->second.size);
         return cache_it->second;
     }
+    MetricsModule::increment(MetricsModule::Counter::FileCacheMisses);
     // Загружаем файл с диска
     auto cached_file = load_file_from_disk(file_path);
     if (!cached_file) {
@@ -286,6 +310,7 @@ std::optional<FileCache::CachedFile> FileCache::get_file(const std::string& rout
     // Добавляем в кэш
     file_cache_[route] = *cached_file;
     total_cache_size_ += cached_file->size;
+    MetricsModule::increment(MetricsModule::Counter::FileCacheBytes, cached_file->size);
     return cached_file;
 }
 
@@ -464,7 +489,7 @@ bool FileCache::refresh_file(const std::string& route) {
         return true;
     }
     catch (const std::exception& e) {
-        std::cerr << "Error refreshing file " << route << ": " << e.what() << std::endl;
+        Log::error("Error refreshing file", { {"route", route}, {"error", e.what()} });
         return false;
     }
 }
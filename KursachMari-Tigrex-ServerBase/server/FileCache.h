@@ -34,7 +34,6 @@ private:
 
     // Вспомогательные методы (без изменений)
     std::string get_mime_type(const std::string& extension) const;
-    std::string normalize_route(const fs::path& file_path) const;
     std::optional<CachedFile> load_file_from_disk(const fs::path& file_path) const;
     void evict_if_needed();
     void scan_directory(const fs::path& directory);
@@ -59,6 +58,8 @@ public:
     std::optional<CachedFile> get_file(const std::string& route);
     std::optional<CachedFile> get_file_by_path(const std::string& file_path);
     bool preload_file(const std::string& route);
+    // Загрузить в кэш файлы по маршрутам (не больше max_cache_size_), вернуть число загруженных
+    size_t warm_up();
     bool evict_from_cache(const std::string& route);
     void clear_cache();
 
@@ -67,6 +68,8 @@ public:
     std::vector<std::string> find_routes(const std::string& pattern) const;
     bool route_exists(const std::string& route) const;
     std::optional<std::string> get_mime_type_for_route(const std::string& route) const;
+    // Маршрут для файла внутри base_directory_ ("/dir/name" без расширения, index -> "/dir/")
+    std::string normalize_route(const fs::path& file_path) const;
     bool refresh_file(const std::string& route);
 
     // Структуры для статистики (без изменений)
@@ -0,0 +1,251 @@
+﻿#include "HotRestart.h"
+#include "LoggingModule.h"
+
+#include <boost/asio/read_until.hpp>
+
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+namespace {
+    // Протокол control-сокета: строки "TAKEOVER\n" и "READY\n" от нового процесса,
+    // в ответ на TAKEOVER — один байт 'L' с дескриптором слушающего сокета в SCM_RIGHTS
+    constexpr char kTakeover[] = "TAKEOVER";
+    constexpr char kReady[] = "READY";
+    constexpr char kListenerTag = 'L';
+    constexpr int kTakeoverTimeoutSeconds = 5;
+
+#ifdef MSG_NOSIGNAL
+    constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+    constexpr int kSendFlags = 0;
+#endif
+
+    std::runtime_error systemError(const std::string& what) {
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    bool writeLine(int fd, const char* line) {
+        std::string data = std::string(line) + '\n';
+        const char* pos = data.data();
+        size_t left = data.size();
+        while (left > 0) {
+            ssize_t n = ::send(fd, pos, left, kSendFlags);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            pos += n;
+            left -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool sendDescriptor(int socket_fd, int fd) {
+        char tag = kListenerTag;
+        iovec iov{ &tag, 1 };
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+        ssize_t n;
+        do {
+            n = ::sendmsg(socket_fd, &msg, kSendFlags);
+        } while (n < 0 && errno == EINTR);
+        return n == 1;
+    }
+
+    int receiveDescriptor(int socket_fd) {
+        char tag = 0;
+        iovec iov{ &tag, 1 };
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr msg{};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t n;
+        do {
+            n = ::recvmsg(socket_fd, &msg, 0);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) throw systemError("hot restart: no answer from the running process");
+        if (n != 1 || tag != kListenerTag) throw std::runtime_error("hot restart: unexpected answer from the running process");
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+            cmsg->cmsg_len != CMSG_LEN(sizeof(int))) {
+            throw std::runtime_error("hot restart: listening socket was not passed");
+        }
+        int fd = -1;
+        std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        return fd;
+    }
+}
+
+HotRestart::HotRestart(net::io_context& ioc, std::string path)
+    : ioc_(ioc), acceptor_(ioc), path_(std::move(path)) {
+}
+
+HotRestart::~HotRestart() {
+    stop();
+    if (takeover_fd_ >= 0) ::close(takeover_fd_);
+}
+
+bool HotRestart::supported() {
+    return true;
+}
+
+int HotRestart::takeListener() {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path_.empty() || path_.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("hot restart: invalid control socket path '" + path_ + "'");
+    }
+    std::memcpy(addr.sun_path, path_.c_str(), path_.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) throw systemError("hot restart: socket");
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        auto error = systemError("hot restart: cannot connect to " + path_);
+        ::close(fd);
+        throw error;
+    }
+    // Старый процесс отвечает из своего цикла событий; завис — не ждём вечно
+    timeval timeout{ kTakeoverTimeoutSeconds, 0 };
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    try {
+        if (!writeLine(fd, kTakeover)) throw systemError("hot restart: send");
+        int listener = receiveDescriptor(fd);
+        takeover_fd_ = fd;
+        return listener;
+    }
+    catch (...) {
+        ::close(fd);
+        throw;
+    }
+}
+
+void HotRestart::confirmTakeover() {
+    if (takeover_fd_ < 0) return;
+    if (!writeLine(takeover_fd_, kReady)) {
+        Log::warning("Hot restart: READY not delivered", { {"error", std::strerror(errno)} });
+    }
+    ::close(takeover_fd_);
+    takeover_fd_ = -1;
+}
+
+void HotRestart::listen(int listener_fd, std::function<void()> on_handoff) {
+    listener_fd_ = listener_fd;
+    on_handoff_ = std::move(on_handoff);
+
+    // Файл остаётся от упавшего процесса или от предыдущего поколения, передавшего нам сокет
+    ::unlink(path_.c_str());
+    local::endpoint endpoint(path_);
+    acceptor_.open(endpoint.protocol());
+    acceptor_.bind(endpoint);
+    ::chmod(path_.c_str(), S_IRUSR | S_IWUSR);  // Забрать сокет может только владелец процесса
+    acceptor_.listen(1);
+    doAccept();
+}
+
+void HotRestart::stop() {
+    if (!acceptor_.is_open()) return;
+    boost::system::error_code ec;
+    acceptor_.close(ec);
+    if (!handed_off_) ::unlink(path_.c_str());
+}
+
+void HotRestart::doAccept() {
+    auto peer = std::make_shared<local::socket>(ioc_);
+    acceptor_.async_accept(*peer, [this, peer](boost::system::error_code ec) {
+        if (ec == net::error::operation_aborted) return;
+        if (!ec && !handed_off_) {
+            auto buffer = std::make_shared<net::streambuf>(64);
+            net::async_read_until(*peer, *buffer, '\n',
+                [this, peer, buffer](boost::system::error_code read_ec, std::size_t) {
+                    if (!read_ec) onCommand(peer, buffer);
+                });
+        }
+        else if (ec) {
+            Log::warning("Hot restart: accept error", { {"error", ec.message()} });
+        }
+        if (acceptor_.is_open()) doAccept();
+        });
+}
+
+void HotRestart::onCommand(std::shared_ptr<local::socket> peer, std::shared_ptr<net::streambuf> buffer) {
+    std::istream input(buffer.get());
+    std::string line;
+    std::getline(input, line);
+    if (line != kTakeover || handed_off_) {
+        Log::warning("Hot restart: unexpected command", { {"command", line} });
+        return;
+    }
+    if (!sendDescriptor(peer->native_handle(), listener_fd_)) {
+        Log::warning("Hot restart: listening socket not sent", { {"error", std::strerror(errno)} });
+        return;
+    }
+    Log::info("Hot restart: listening socket sent, waiting for the new process");
+
+    // Пока новый процесс не подтвердил, что принимает соединения, продолжаем работать как обычно
+    net::async_read_until(*peer, *buffer, '\n',
+        [this, peer, buffer](boost::system::error_code ec, std::size_t) {
+            std::istream ready_input(buffer.get());
+            std::string ready;
+            if (!ec) std::getline(ready_input, ready);
+            if (ready != kReady) {
+                Log::warning("Hot restart: new process did not confirm, keep serving",
+                    { {"error", ec ? ec.message() : ready} });
+                return;
+            }
+            handed_off_ = true;
+            Log::info("Hot restart: handed off to the new process");
+            if (on_handoff_) on_handoff_();
+        });
+}
+
+#else
+
+HotRestart::HotRestart(net::io_context&, std::string path)
+    : path_(std::move(path)) {
+}
+
+HotRestart::~HotRestart() = default;
+
+bool HotRestart::supported() {
+    return false;
+}
+
+int HotRestart::takeListener() {
+    throw std::runtime_error("hot restart is not supported on this platform");
+}
+
+void HotRestart::confirmTakeover() {
+}
+
+void HotRestart::listen(int, std::function<void()>) {
+    throw std::runtime_error("hot restart is not supported on this platform");
+}
+
+void HotRestart::stop() {
+}
+
+#endif
@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/streambuf.hpp>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace net = boost::asio;
+
+/*
+# HotRestart
+    Перезапуск без простоя: слушающий сокет передаётся новому процессу через Unix-сокет (SCM_RIGHTS).
+    Работающий процесс слушает control-сокет. Новый (запущенный с --takeover) подключается, получает
+    дескриптор, начинает принимать соединения и отвечает READY — только после этого старый закрывает свой
+    acceptor и сливает сессии. Очередь accept ядра живёт всё это время, поэтому соединения не теряются,
+    а если новый процесс упал до READY, старый продолжает работать.
+    Только POSIX: на Windows supported() == false, и перезапуск делается обычной остановкой.
+*/
+class HotRestart {
+public:
+    HotRestart(net::io_context& ioc, std::string path);
+    ~HotRestart();
+
+    HotRestart(const HotRestart&) = delete;
+    HotRestart& operator=(const HotRestart&) = delete;
+
+    static bool supported();
+
+    // Новый процесс: забрать слушающий сокет у старого. Бросает std::runtime_error, если старого процесса нет
+    int takeListener();
+    // Новый процесс, когда accept уже запущен: старый может закрывать свой acceptor
+    void confirmTakeover();
+
+    // Работающий процесс: обслуживать control-сокет. on_handoff вызывается на ioc после READY нового процесса
+    void listen(int listener_fd, std::function<void()> on_handoff);
+    // Закрыть control-сокет. Путь удаляется, только если его не занял новый процесс
+    void stop();
+
+private:
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    using local = net::local::stream_protocol;
+
+    void doAccept();
+    void onCommand(std::shared_ptr<local::socket> peer, std::shared_ptr<net::streambuf> buffer);
+
+    net::io_context& ioc_;
+    local::acceptor acceptor_;
+#endif
+    std::string path_;
+    int listener_fd_ = -1;
+    int takeover_fd_ = -1;     // Соединение нового процесса со старым до confirmTakeover
+    bool handed_off_ = false;  // Сокет передан: путь control-сокета теперь принадлежит новому процессу
+    std::function<void()> on_handoff_;
+};
@@ -15,6 +15,14 @@ using tcp = boost::asio::ip::tcp;
 
 class LambdaSenders {
 public:
+    // Half-close после последнего ответа: у tcp_stream сокет внутри, у голого сокета — он сам
+    static void shutdownSend(tcp::socket& socket, beast::error_code& ec) {
+        socket.shutdown(net::socket_base::shutdown_send, ec);
+    }
+    static void shutdownSend(beast::tcp_stream& stream, beast::error_code& ec) {
+        stream.socket().shutdown(net::socket_base::shutdown_send, ec);
+    }
+
     // Sync версия (остаётся для legacy)
     template<class Stream>
     struct send_lambda {
@@ -44,20 +52,23 @@ public:
         }
 
         template<bool isRequest, class Body, class Fields>
-        void operator()(http::message<isRequest, Body, Fields>&& msg) const {
+        void operator()(http::message<isRequest, Body, Fields>&& msg) {
             close_ = msg.need_eof();  // true если explicit close
             auto sp = std::make_shared<http::message<isRequest, Body, Fields>>(std::move(msg));
             http::async_write(
                 stream_,
                 *sp,
                 [this, sp, close_ptr = &close_](beast::error_code ec, std::size_t bytes) {  // NEW: Log bytes
-                    if (after_write_cb_) {
-                        after_write_cb_(ec);
+                    // FIXED: колбек одноразовый — он держит sender, и без move сессия никогда не освобождалась.
+                    // Локальная копия держит sender живым до конца обработчика
+                    auto after_write = std::move(after_write_cb_);
+                    if (after_write) {
+                        after_write(ec);
                     }
                     if (!ec && *close_ptr) {
                         // FIXED: Half-close (shutdown_send) — client reads response, но no more writes
                         beast::error_code sec;
-                        beast::get_lowest_layer(stream_).shutdown(net::socket_base::shutdown_send, sec);
+                        shutdownSend(beast::get_lowest_layer(stream_), sec);
                     }
                     //std::cout << "Wrote " << bytes << " bytes, close=" << *close_ptr << std::endl;  // Debug log
                 });
@@ -0,0 +1,60 @@
+﻿#include "RequestCoalescer.h"
+
+namespace {
+    // Копия ответа ведущего запроса. Server и Connection у каждого ответа свои (keep-alive зависит от запроса)
+    void copyResponse(const RequestHandler::Response& from, RequestHandler::Response& to) {
+        to.result(from.result());
+        for (const auto& field : from) {
+            if (field.name() == http::field::server || field.name() == http::field::connection) continue;
+            to.set(field.name_string(), field.value());
+        }
+        to.body() = from.body();
+    }
+}
+
+RequestHandler::AsyncRouteHandler RequestCoalescer::wrap(RequestHandler::AsyncRouteHandler handler) {
+    routes_.push_back(std::make_unique<Flights>());
+    Flights* flights = routes_.back().get();
+
+    return [this, flights, handler = std::move(handler)](const RequestHandler::Request& req, RequestHandler::Response& res,
+        RequestHandler::ResponseCompletion done) {
+        if (req.method() != http::verb::get) {
+            return handler(req, res, std::move(done));
+        }
+
+        std::string key(req.target());
+        {
+            std::lock_guard<std::mutex> lock(flights->mutex);
+            auto [it, leader] = flights->in_flight.try_emplace(key);
+            if (!leader) {
+                it->second.push_back({ &res, std::move(done) });
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        executed_.fetch_add(1, std::memory_order_relaxed);
+        handler(req, res, [flights, key = std::move(key), &res, done = std::move(done)]() mutable {
+            std::vector<Waiter> waiters;
+            {
+                // Запись снимается до ответа: запрос, пришедший после, увидит свежие данные, а не этот ответ
+                std::lock_guard<std::mutex> lock(flights->mutex);
+                auto it = flights->in_flight.find(key);
+                waiters = std::move(it->second);
+                flights->in_flight.erase(it);
+            }
+            for (auto& waiter : waiters) {
+                copyResponse(res, *waiter.res);
+                waiter.done();
+            }
+            done();
+            });
+        };
+}
+
+RequestCoalescer::Stats RequestCoalescer::getStats() const {
+    Stats stats;
+    stats.executed = executed_.load(std::memory_order_relaxed);
+    stats.coalesced = coalesced_.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include "RequestHandler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+# RequestCoalescer
+    Single-flight для дорогих GET: пока запрос с тем же target выполняется, одинаковые запросы не запускают
+    обработчик заново, а ждут его ответа и получают копию (статус, заголовки, тело). Нагрузка на БД при
+    наплыве одинаковых запросов остаётся как от одного. Ответ не кэшируется: запрос, пришедший после
+    завершения, запускает обработчик снова. Другие методы проходят мимо.
+*/
+class RequestCoalescer {
+public:
+    struct Stats {
+        uint64_t executed = 0;   // Запусков обработчика
+        uint64_t coalesced = 0;  // Запросов, получивших чужой ответ
+    };
+
+    // Обёртка асинхронного маршрута. Вызывать до старта сервера; RequestCoalescer должен пережить маршруты
+    RequestHandler::AsyncRouteHandler wrap(RequestHandler::AsyncRouteHandler handler);
+
+    Stats getStats() const;
+
+private:
+    struct Waiter {
+        RequestHandler::Response* res;
+        RequestHandler::ResponseCompletion done;
+    };
+
+    // Запросы одного маршрута, ждущие выполняющийся обработчик; ключ — target
+    struct Flights {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::vector<Waiter>> in_flight;
+    };
+
+    std::vector<std::unique_ptr<Flights>> routes_;
+    std::atomic<uint64_t> executed_{ 0 };
+    std::atomic<uint64_t> coalesced_{ 0 };
+};
@@ -1,18 +1,29 @@
 ﻿#include "RequestHandler.h"
+#include "LoggingModule.h"
 #include <iostream>
 
 RequestHandler::RequestHandler()
-    : BaseModule("HTTP Request Handler") {
+    : BaseModule("HTTP Request Handler")
+    , static_metrics_id_(MetricsModule::registerRoute("static"))
+    , not_found_metrics_id_(MetricsModule::registerRoute("not_found")) {
+    dependsOn(file_cache_);  // Реестр поднимет и прогреет кэш раньше и передаст его сюда
 }
 
-void RequestHandler::addDynamicRouteHandler(const std::string& regexPattern,
-    std::function<void(const http::request<http::string_body>&, http::response<http::string_body>&)> handler) {
+void RequestHandler::addDynamicRouteHandler(const std::string& regexPattern, RouteHandler handler) {
+    addDynamicRoute(regexPattern, RouteEntry{ std::move(handler), {}, MetricsModule::registerRoute(regexPattern) });
+}
+
+void RequestHandler::addAsyncDynamicRouteHandler(const std::string& regexPattern, AsyncRouteHandler handler) {
+    addDynamicRoute(regexPattern, RouteEntry{ {}, std::move(handler), MetricsModule::registerRoute(regexPattern) });
+}
+
+void RequestHandler::addDynamicRoute(const std::string& regexPattern, RouteEntry route) {
     try {
         std::regex re(regexPattern);  // Компилируем regex заранее для эффективности
-        dynamicRouteHandlers_.emplace_back(re, handler);
+        dynamicRouteHandlers_.emplace_back(std::move(re), std::move(route));
     }
     catch (const std::regex_error& e) {
-        std::cerr << "Invalid regex pattern: " << regexPattern << " - " << e.what() << std::endl;
+        Log::error("Invalid regex pattern", { {"pattern", regexPattern}, {"error", e.what()} });
         // Для MVP: не добавляем, но не крашим
     }
 }
@@ -31,9 +42,12 @@ void RequestHandler::onShutdown() {
     std::cout << "RequestHandler shutdown" << std::endl;
 }
 
-void RequestHandler::addRouteHandler(const std::string& path,
-    std::function<void(const http::request<http::string_body>&, http::response<http::string_body>&)> handler) {
-    routeHandlers_[path] = handler;
+void RequestHandler::addRouteHandler(const std::string& path, RouteHandler handler) {
+    routeHandlers_[path] = RouteEntry{ std::move(handler), {}, MetricsModule::registerRoute(path) };
+}
+
+void RequestHandler::addAsyncRouteHandler(const std::string& path, AsyncRouteHandler handler) {
+    routeHandlers_[path] = RouteEntry{ {}, std::move(handler), MetricsModule::registerRoute(path) };
 }
 
 void RequestHandler::setupDefaultRoutes() { //Придумать какую-нибудь штуку для замены стандартного обработчика
@@ -1,8 +1,14 @@
 ﻿#pragma once
 #include "BaseModule.h"
 #include "FileCache.h"
+#include "MetricsModule.h"
+#include "TracingModule.h"
 
 #include <boost/beast/http.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <sstream>
 #include <fstream>
 #include <regex>
@@ -13,7 +19,39 @@ namespace beast = boost::beast;
 namespace http = beast::http;
 
 class RequestHandler : public BaseModule {
-    FileCache* file_cache_ = nullptr;  // Указатель на кэш (инжектируется в main)
+public:
+    using Request = http::request<http::string_body>;
+    using Response = http::response<http::string_body>;
+
+    // Синхронный обработчик: ответ заполнен к моменту возврата
+    using RouteHandler = std::function<void(const Request&, Response&)>;
+
+    // Сигнал асинхронного обработчика "ответ готов". Вызывается ровно один раз, с любого потока
+    using ResponseCompletion = std::function<void()>;
+
+    // Асинхронный обработчик: req и res живут до вызова done(), ответ уходит клиенту после него.
+    // Позволяет вынести медленную работу (БД) с I/O-потока
+    using AsyncRouteHandler = std::function<void(const Request&, Response&, ResponseCompletion)>;
+
+private:
+    FileCache* file_cache_ = nullptr;  // Указатель на кэш (внедряет ModuleRegistry как зависимость)
+
+    // Маршрут хранит ровно один из двух видов обработчика
+    struct RouteEntry {
+        RouteHandler handler;
+        AsyncRouteHandler async_handler;
+        int metrics_id = -1;  // Метка маршрута в /metrics
+    };
+
+    // Запрос и ответ асинхронного маршрута: держатся completion'ом, пока обработчик не закончит
+    struct AsyncExchange {
+        AsyncExchange(Request&& request, Response&& response)
+            : req(std::move(request)), res(std::move(response)) {
+        }
+        Request req;
+        Response res;
+        std::atomic<bool> completed{ false };
+    };
 
 
     // Парсинг target на path и query (простой split по ?)
@@ -27,7 +65,7 @@ class RequestHandler : public BaseModule {
 
 public:
     RequestHandler();
-    // Метод для инжекции кэша (только из main)
+    // Инжекция кэша вручную — для обработчика вне ModuleRegistry (бенчмарки)
     void setFileCache(FileCache* cache) {
         file_cache_ = cache;
         std::string base_dir = file_cache_->get_base_directory();
@@ -35,14 +73,18 @@ public:
     }
 
     // Новый метод для динамических роутов (regex-паттерн)
-    void addDynamicRouteHandler(const std::string& regexPattern,
-        std::function<void(const http::request<http::string_body>&, http::response<http::string_body>&)> handler);
+    void addDynamicRouteHandler(const std::string& regexPattern, RouteHandler handler);
 
     // Методы для регистрации обработчиков конкретных путей
-    void addRouteHandler(const std::string& path, std::function<void(const http::request<http::string_body>&, http::response<http::string_body>&)> handler);
+    void addRouteHandler(const std::string& path, RouteHandler handler);
+
+    // Асинхронные варианты: ответ отправляется, когда обработчик вызовет done()
+    void addAsyncRouteHandler(const std::string& path, AsyncRouteHandler handler);
+    void addAsyncDynamicRouteHandler(const std::string& regexPattern, AsyncRouteHandler handler);
 
     template<class Body, class Allocator, class Send>
     void handleRequest(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
+        auto started = std::chrono::steady_clock::now();
         http::response<http::string_body> res{ http::status::not_found, req.version() };
         res.set(http::field::server, "ModularServer");
         res.keep_alive(req.keep_alive());
@@ -57,15 +99,16 @@ public:
         // Проверяем wildcard /* для динамического поиска в кэше (только по path!)
         auto wildcard_it = routeHandlers_.find("/*"); //FIXME: Повышает время отклика
         if (wildcard_it != routeHandlers_.end() && file_cache_) {
-            file_cache_->refresh_file(path);
-            auto cached_file = file_cache_->get_file(path);  // Ищем по чистому path
+            auto cached_file = traced("file_cache", [&] {
+                file_cache_->refresh_file(path);
+                return file_cache_->get_file(path);  // Ищем по чистому path
+                });
             if (cached_file) {
                 res.set(http::field::content_type, cached_file->mime_type.c_str());
                 res.set(http::field::cache_control, "public, max-age=300");
                 res.body() = std::move(cached_file->content);
                 res.result(http::status::ok);
-                res.prepare_payload();
-                send(std::move(res));
+                finishResponse(static_metrics_id_, started, std::move(res), send);
                 return;
             }
         }
@@ -75,9 +118,7 @@ public:
         if (it != routeHandlers_.end()) {
             // Передаём query в handler (если lambda ожидает — расширь signature)
             // Для MVP: если handler статический, игнорируем query
-            it->second(req, res); 
-            res.prepare_payload();
-            send(std::move(res));
+            invokeRoute(it->second, started, std::move(req), std::move(res), std::forward<Send>(send));
             return;
         }
         else if (target.find("../") != std::string::npos) {
@@ -86,32 +127,24 @@ public:
             const auto& cached = file_cache_->get_file("/attention");
             res.set(http::field::cache_control, "public, max-age=300");
             res.body() = cached.value().content;
-            res.prepare_payload();
-            send(std::move(res));
+            finishResponse(not_found_metrics_id_, started, std::move(res), send);
             return;
 
         }
         if (it == routeHandlers_.end() && !dynamicRouteHandlers_.empty()) { //FIXME: Съедает 404 страничку (Уже нет, но переработать стоит). Сделать нормальную валидацию
-            bool handled = false;
-            for (const auto& [re, handler] : dynamicRouteHandlers_) {
+            for (const auto& [re, route] : dynamicRouteHandlers_) {
                 if (std::regex_match(path, re)) {  // Матчим весь path с regex
-                    handler(req, res);
-                    handled = true;
-                    break;  // Первый матч — обрабатываем (порядок в векторе важен: более конкретные выше)
+                    // Первый матч — обрабатываем (порядок в векторе важен: более конкретные выше)
+                    invokeRoute(route, started, std::move(req), std::move(res), std::forward<Send>(send));
+                    return;
                 }
             }
-            if (handled) {
-                res.prepare_payload();
-                send(std::move(res));
-                return;
-            }
-            else if (target.find("api/") != std::string::npos) {
+            if (target.find("api/") != std::string::npos) {
                 res.set(http::field::content_type, "application/json");
                 res.result(http::status::not_found);
                 res.set(http::field::cache_control, "no-cache, must-revalidate");
                 res.body() = R"({"status": "not_found"})";
-                res.prepare_payload();
-                send(std::move(res));
+                finishResponse(not_found_metrics_id_, started, std::move(res), send);
                 return;
             }
             else {
@@ -120,8 +153,7 @@ public:
                 const auto& cached = file_cache_->get_file("/errorNotFound");
                 res.set(http::field::cache_control, "public, max-age=300");
                 res.body() = cached.value().content;
-                res.prepare_payload();
-                send(std::move(res));
+                finishResponse(not_found_metrics_id_, started, std::move(res), send);
             }
         }
     }
@@ -131,14 +163,63 @@ protected:
     void onShutdown() override;
 
 private:
-    std::vector<std::pair<std::regex,
-        std::function
-        <void(const http::request<http::string_body>&, http::response<http::string_body>&)>
-    >> dynamicRouteHandlers_;
-
-    std::unordered_map<
-        std::string,
-        std::function<void(const http::request<http::string_body>&, http::response<http::string_body>&)>
-    > routeHandlers_;
+    // Вызов найденного маршрута. Синхронный отвечает сразу, асинхронный — когда вызовет done().
+    // Send копируется в completion, поэтому обязан сам держать сессию живой
+    template<class Send>
+    void invokeRoute(const RouteEntry& route, std::chrono::steady_clock::time_point started,
+        Request&& req, Response&& res, Send&& send) {
+        if (route.handler) {
+            {
+                ScopedPhaseTimer timer(MetricsModule::Phase::Handler);
+                TraceSpan span("handler");
+                route.handler(req, res);
+            }
+            finishResponse(route.metrics_id, started, std::move(res), send);
+            return;
+        }
+
+        // Для асинхронного маршрута фаза handler длится до done(), включая ожидание БД
+        auto exchange = std::make_shared<AsyncExchange>(std::move(req), std::move(res));
+        ResponseCompletion done = [exchange, started, metrics_id = route.metrics_id, trace = TracingModule::current(),
+            send = std::forward<Send>(send)]() mutable {
+            if (exchange->completed.exchange(true)) {
+                return;  // Повторный done() — ответ уже отправлен
+            }
+            auto finished = std::chrono::steady_clock::now();
+            MetricsModule::recordPhase(MetricsModule::Phase::Handler, finished - started);
+            if (trace) TracingModule::recordSpan(trace, "handler", started, finished);
+            finishResponse(metrics_id, started, std::move(exchange->res), send);
+            };
+        // FIXED: исключение до done() подвешивало сессию до read-timeout или уходило в ioc.run().
+        // Копия done остаётся здесь, чтобы ответить 500; повторный вызов отсекает completed
+        try {
+            route.async_handler(exchange->req, exchange->res, done);
+        }
+        catch (const std::exception& e) {
+            if (!exchange->completed.load()) {
+                exchange->res.result(http::status::internal_server_error);
+                exchange->res.set(http::field::content_type, "text/plain");
+                exchange->res.body() = e.what();
+            }
+            done();
+        }
+    }
+
+    // Общий хвост всех ответов: Content-Length, учёт в метриках, отправка
+    template<class Send>
+    static void finishResponse(int metrics_id, std::chrono::steady_clock::time_point started, Response&& res, Send& send) {
+        res.prepare_payload();
+        MetricsModule::recordRequest(metrics_id, res.result_int(), std::chrono::steady_clock::now() - started);
+        send(std::move(res));
+    }
+
+    void addDynamicRoute(const std::string& regexPattern, RouteEntry route);
+
+    int static_metrics_id_ = -1;
+    int not_found_metrics_id_ = -1;
+
+    std::vector<std::pair<std::regex, RouteEntry>> dynamicRouteHandlers_;
+
+    std::unordered_map<std::string, RouteEntry> routeHandlers_;
     void setupDefaultRoutes();
 };
\ No newline at end of file
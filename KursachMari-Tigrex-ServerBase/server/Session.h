@@ -2,9 +2,21 @@
 
 #include "RequestHandler.h"
 #include "LambdaSenders.h"
+#include "DoSProtectionModule.h"
+#include "EventHub.h"
+#include "LoggingModule.h"
+#include "MetricsModule.h"
+#include "TracingModule.h"
 
 #include <boost/beast/core.hpp>
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
 namespace net = boost::asio;
 using tcp = boost::asio::ip::tcp;
@@ -12,55 +24,193 @@ namespace fs = std::filesystem;
 namespace beast = boost::beast;
 namespace http = beast::http;
 
+// Таймауты и лимиты сессии. Один экземпляр на сервер (в main), сессии держат на него ссылку
+struct SessionLimits {
+    std::chrono::seconds idle_timeout{ 60 };    // Простой keep-alive между запросами
+    std::chrono::seconds read_timeout{ 15 };    // От первого байта до конца запроса (заголовки + тело): slow-loris
+    std::chrono::seconds write_timeout{ 30 };   // Запись ответа медленному читателю
+    uint32_t header_limit = 8 * 1024;           // Байт на строку запроса и заголовки -> 431
+    uint64_t body_limit = 1024 * 1024;          // Байт тела -> 413
+
+    static const SessionLimits& defaults() {
+        static const SessionLimits instance;
+        return instance;
+    }
+};
+
+class session;
+
+// Живые сессии сервера — для плавной остановки: main просит их завершиться и ждёт, пока счётчик не обнулится.
+// Сессия регистрируется в run() и снимается в деструкторе; методы безопасны с любого потока
+class SessionTracker {
+public:
+    void add(const std::shared_ptr<session>& s);
+    void remove(session* s);
+    size_t active() const;
+
+    // Простаивающие закрываются сразу, занятые — после текущего ответа (Connection: close).
+    // Сессии, принятые после вызова, завершаются так же
+    void drainAll();
+    // Принудительно: по истечении срока слива
+    void closeAll();
+
+private:
+    template <typename F>
+    void forEach(F f);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<session*, std::weak_ptr<session>> sessions_;
+    bool draining_ = false;
+};
+
 // UPDATED: Session с shared_ptr для sender lifetime
+// Между запросами сессия не держит буферов: ждёт готовности сокета, а flat_buffer отдаёт память.
+// Соединение освобождает место в лимитах DoSProtectionModule вместе с сессией (ConnectionGuard)
 class session : public std::enable_shared_from_this<session> {
 public:
-    session(tcp::socket socket, RequestHandler* module)
-        : socket_(std::move(socket)), module_(module), close_(false) {
+    session(tcp::socket socket, RequestHandler* module, DoSProtectionModule* dos_protection = nullptr,
+        const SessionLimits& limits = SessionLimits::defaults(), DoSProtectionModule::ConnectionGuard connection = {},
+        SessionTracker* tracker = nullptr, EventHub* events = nullptr)
+        : stream_(std::move(socket)), idle_timer_(stream_.get_executor()), module_(module), dos_protection_(dos_protection),
+        limits_(limits), connection_(std::move(connection)), tracker_(tracker), events_(events), close_(false) {
+        beast::error_code ec;
+        client_address_ = stream_.socket().remote_endpoint(ec).address();
+        MetricsModule::increment(MetricsModule::Counter::SessionsOpened);
+    }
+
+    ~session() {
+        if (tracker_) tracker_->remove(this);
+        MetricsModule::increment(MetricsModule::Counter::SessionsClosed);
     }
 
     void run() {
+        if (tracker_) tracker_->add(shared_from_this());
         try {
             do_read();
         }
         catch (const std::exception& e) {
-            std::cerr << "Session run error: " << e.what() << std::endl;
+            Log::error("Session run error", { {"error", e.what()} });
             beast::error_code ec;
-            beast::get_lowest_layer(socket_).shutdown(net::socket_base::shutdown_both, ec);
+            stream_.socket().shutdown(net::socket_base::shutdown_both, ec);
         }
     }
 
+    // NEW: плавная остановка. Вызывается с любого потока, выполняется на executor сокета
+    void drain() {
+        net::dispatch(stream_.get_executor(), [self = shared_from_this()]() {
+            self->draining_ = true;
+            // Между запросами ответа никто не ждёт. Только что принятое соединение получает один ответ:
+            // клиент уже отправил (или отправляет) запрос в очередь accept, и обрыв он увидел бы как ошибку
+            if (self->waiting_idle_ && self->served_) self->close_now();
+            });
+    }
+
+    void force_close() {
+        net::dispatch(stream_.get_executor(), [self = shared_from_this()]() {
+            self->draining_ = true;
+            self->close_now();
+            });
+    }
+
 private:
+    void close_now() {
+        waiting_idle_ = false;
+        idle_timer_.cancel();
+        beast::error_code ec;
+        stream_.socket().shutdown(net::socket_base::shutdown_both, ec);
+        stream_.close();
+    }
+
     void do_read() {
         req_ = {};
-        buffer_.consume(buffer_.size());
-        http::async_read(socket_, buffer_, req_,
+        if (draining_ && served_) {  // Ответ ушёл с Connection: close, новых запросов не ждём
+            close_now();
+            return;
+        }
+        // FIXED: хвост буфера — это следующий конвейерный (pipelined) запрос, его не выбрасываем
+        // и не ждём новых байт: они уже прочитаны
+        if (buffer_.size() > 0) {
+            read_started_ = std::chrono::steady_clock::now();
+            start_read();
+            return;
+        }
+        // Простой keep-alive: буфер пуст, память возвращаем — тысячи idle-соединений не держат по буферу.
+        // Ждём первые байты без чтения: фаза parse считается от их прихода, а не включает простой.
+        // Простой ограничен idle_timeout: сторож закрывает сокет, ожидание завершится ошибкой
+        buffer_.shrink_to_fit();
+        waiting_idle_ = true;
+        idle_timer_.expires_after(limits_.idle_timeout);
+        idle_timer_.async_wait([self = shared_from_this()](beast::error_code ec) {
+            if (ec || !self->waiting_idle_) return;  // Отменён: запрос пришёл раньше
+            MetricsModule::increment(MetricsModule::Counter::SessionsIdleClosed);
+            beast::error_code sec;
+            self->stream_.socket().shutdown(net::socket_base::shutdown_both, sec);
+            self->stream_.close();
+            });
+        stream_.socket().async_wait(tcp::socket::wait_read, [self = shared_from_this()](beast::error_code ec) {
+            self->waiting_idle_ = false;
+            self->idle_timer_.cancel();
+            if (ec) return;  // Закрыт по простою или оборван; EOF приходит как готовность и разбирается в async_read
+            self->read_started_ = std::chrono::steady_clock::now();
+            self->start_read();
+            });
+    }
+
+    void start_read() {
+        // Свежий парсер на каждый запрос: лимиты заголовков и тела действуют на каждый запрос keep-alive
+        parser_.emplace();
+        parser_->header_limit(limits_.header_limit);
+        parser_->body_limit(limits_.body_limit);
+        // Весь запрос, от первого байта до конца тела, должен прийти за read_timeout
+        stream_.expires_after(limits_.read_timeout);
+        http::async_read(stream_, buffer_, *parser_,
             [self = shared_from_this()](beast::error_code ec, std::size_t bytes) {  // NEW: дебаг байты
                 if (!ec) {
+                    MetricsModule::recordPhase(MetricsModule::Phase::Parse, std::chrono::steady_clock::now() - self->read_started_);
                     //std::cout << "Read " << bytes << " bytes for next request" << std::endl;  // Debug: keep-alive reads
+                    self->req_ = self->parser_->release();
+                    self->parser_.reset();
                     self->on_read();
                 }
                 else if (ec == http::error::end_of_stream) {
                     //std::cout << "End of stream — closing session" << std::endl;
                     // Graceful close
                     beast::error_code sec;
-                    self->socket_.shutdown(net::socket_base::shutdown_both, sec);
+                    self->stream_.socket().shutdown(net::socket_base::shutdown_both, sec);
+                }
+                else if (ec == http::error::header_limit) {
+                    self->reject_oversized(http::status::request_header_fields_too_large);
+                }
+                else if (ec == http::error::body_limit) {
+                    self->reject_oversized(http::status::payload_too_large);
+                }
+                else if (ec == beast::error::timeout) {
+                    // Медленный клиент: только счётчик, без строки в лог на каждое соединение
+                    MetricsModule::increment(MetricsModule::Counter::SessionTimeouts);
+                    self->stream_.close();
                 }
                 else {
-                    std::cerr << "Read error (" << bytes << " bytes): " << ec.message() << std::endl;
+                    Log::warning("Read error", { {"bytes", bytes}, {"error", ec.message()} });
                     beast::error_code sec;
-                    beast::get_lowest_layer(self->socket_).shutdown(net::socket_base::shutdown_both, sec);
+                    self->stream_.socket().shutdown(net::socket_base::shutdown_both, sec);
                 }
             });
     }
 
-    void on_read() {
+    // Отправитель ответа. Асинхронные маршруты завершаются на чужом потоке (например, потоке БД),
+    // поэтому запись всегда выполняется на executor сокета, а self держит сессию до ответа
+    auto make_sender() {
         // FIXED: make_shared без {} — используем default cb в ctor
-        auto sp_sender = std::make_shared<LambdaSenders::async_send_lambda<tcp::socket>>(socket_, close_);
-        auto sender_ref = std::ref(*sp_sender);  // Ref to deref sp_sender (valid)
+        auto sp_sender = std::make_shared<LambdaSenders::async_send_lambda<beast::tcp_stream>>(stream_, close_);
 
         // Лямбда для after_write — захват sp_sender (copy shared) + self (no dangling)
         auto after_write = [self = shared_from_this(), sp_sender](beast::error_code ec) {
+            auto written = std::chrono::steady_clock::now();
+            MetricsModule::recordPhase(MetricsModule::Phase::Write, written - self->write_started_);
+            if (self->trace_) {
+                TracingModule::recordSpan(self->trace_, "write", self->write_started_, written);
+                TracingModule::recordSpan(self->trace_, "request", self->read_started_, written, self->trace_detail_);
+            }
             if (ec == http::error::end_of_stream) {  // NEW: Client closed — normal, no re-read
                 //std::cout << "Client closed connection gracefully" << std::endl;
                 return;
@@ -68,21 +218,157 @@ private:
             if (!ec && !sp_sender->close_) {
                 self->do_read();  // Keep-alive
             }
+            else if (ec == beast::error::timeout) {
+                MetricsModule::increment(MetricsModule::Counter::SessionTimeouts);
+                self->stream_.close();
+            }
             else if (ec) {
-                std::cerr << "Post-write error: " << ec.message() << std::endl;
+                Log::warning("Post-write error", { {"error", ec.message()} });
             }
             };
 
         // FIXED: Set cb ПОСЛЕ создания sp_sender, но ДО handleRequest
         sp_sender->after_write_cb_ = after_write;
 
-        // Теперь handleRequest: sender живёт via sp, ref ok
-        module_->handleRequest(std::move(req_), sender_ref);
+        return [self = shared_from_this(), sp_sender](auto&& msg) {
+            net::dispatch(self->stream_.get_executor(),
+                [self, sp_sender, msg = std::move(msg)]() mutable {
+                    if (self->draining_) msg.keep_alive(false);  // Клиент уйдёт на новый процесс, а не будет ждать RST
+                    self->write_started_ = std::chrono::steady_clock::now();
+                    self->stream_.expires_after(self->limits_.write_timeout);
+                    (*sp_sender)(std::move(msg));
+                });
+            };
+    }
+
+    // Запрос больше лимита: короткий ответ и закрытие, остаток запроса не дочитывается
+    void reject_oversized(http::status status) {
+        unsigned version = parser_ && parser_->is_header_done() ? parser_->get().version() : 11;
+        parser_.reset();
+        buffer_.clear();
+        http::response<http::string_body> res{ status, version };
+        res.set(http::field::server, "ModularServer");
+        res.set(http::field::content_type, "text/plain");
+        res.keep_alive(false);
+        auto reason = http::obsolete_reason(status);
+        res.body().assign(reason.data(), reason.size());
+        res.prepare_payload();
+        static const int too_large_metrics_id = MetricsModule::registerRoute("too_large");
+        MetricsModule::recordRequest(too_large_metrics_id, res.result_int(), std::chrono::nanoseconds(0));
+        make_sender()(std::move(res));
+    }
+
+    void on_read() {
+        served_ = true;
+        // Решение о трассировке — одно на запрос; дальше контекст идёт через thread_local и post в БД
+        trace_ = TracingModule::startTrace();
+        if (trace_) {
+            TracingModule::recordSpan(trace_, "parse", read_started_, std::chrono::steady_clock::now());
+            trace_detail_.assign(http::to_string(req_.method()).data(), http::to_string(req_.method()).size());
+            trace_detail_ += ' ';
+            trace_detail_.append(req_.target().data(), req_.target().size());
+        }
+        TraceContextScope trace_scope(trace_);
+
+        auto send = make_sender();
+
+        // Лимит проверяется на каждый запрос, иначе keep-alive клиент обходит его одним соединением
+        if (dos_protection_) {
+            std::string_view target(req_.target().data(), req_.target().size());
+            std::string_view path = target.substr(0, target.find('?'));
+            auto decision = dos_protection_->check(client_address_, dos_protection_->routeCost(path));
+            if (!decision.allowed) {
+                // Дешёвый отказ: без логирования и без обращения к обработчикам, соединение закрывается
+                http::response<http::string_body> res{ http::status::too_many_requests, req_.version() };
+                res.set(http::field::server, "ModularServer");
+                res.set(http::field::content_type, "text/plain");
+                res.set(http::field::retry_after, std::to_string(decision.retry_after.count()));
+                res.keep_alive(false);
+                res.body() = "Too Many Requests";
+                res.prepare_payload();
+                static const int rejected_metrics_id = MetricsModule::registerRoute("rejected");
+                MetricsModule::recordRequest(rejected_metrics_id, res.result_int(), std::chrono::nanoseconds(0));
+                send(std::move(res));
+                return;
+            }
+        }
+
+        // NEW: поток событий. Соединение (и место в лимитах) уходит в EventHub, сессия завершается
+        if (events_ && req_.method() == http::verb::get && !draining_ &&
+            std::string_view(req_.target().data(), req_.target().size()).substr(0, req_.target().find('?')) == EventHub::kPath) {
+            stream_.expires_never();
+            // release_socket, а не move потока: drain() с другого потока может ещё обратиться к stream_
+            events_->subscribe(stream_.release_socket(), std::move(connection_), req_.version());
+            return;
+        }
+
+        module_->handleRequest(std::move(req_), std::move(send));
     }
 
-    tcp::socket socket_;
+    beast::tcp_stream stream_;
+    net::steady_timer idle_timer_;
     beast::flat_buffer buffer_;
+    std::optional<http::request_parser<http::string_body>> parser_;
     http::request<http::string_body> req_;
     RequestHandler* module_;
+    DoSProtectionModule* dos_protection_;
+    const SessionLimits& limits_;
+    DoSProtectionModule::ConnectionGuard connection_;  // Место в лимитах соединений, освобождается с сессией
+    SessionTracker* tracker_;
+    EventHub* events_;
+    bool waiting_idle_ = false;
+    bool draining_ = false;
+    bool served_ = false;  // Был хотя бы один запрос
+    net::ip::address client_address_;
+    std::chrono::steady_clock::time_point read_started_;
+    std::chrono::steady_clock::time_point write_started_;
+    TraceContext trace_;
+    std::string trace_detail_;  // "GET /api/all-data" для корневого спана, только у сэмплированных
     bool close_;  // Member ok
-};
\ No newline at end of file
+};
+
+inline void SessionTracker::add(const std::shared_ptr<session>& s) {
+    bool drain;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessions_.emplace(s.get(), s);
+        drain = draining_;
+    }
+    if (drain) s->drain();
+}
+
+inline void SessionTracker::remove(session* s) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_.erase(s);
+}
+
+inline size_t SessionTracker::active() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sessions_.size();
+}
+
+template <typename F>
+void SessionTracker::forEach(F f) {
+    // Вызовы — вне мьютекса: сессия может завершиться и снять себя с учёта прямо внутри
+    std::vector<std::shared_ptr<session>> alive;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        alive.reserve(sessions_.size());
+        for (auto& [ptr, weak] : sessions_) {
+            if (auto s = weak.lock()) alive.push_back(std::move(s));
+        }
+    }
+    for (auto& s : alive) f(*s);
+}
+
+inline void SessionTracker::drainAll() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        draining_ = true;
+    }
+    forEach([](session& s) { s.drain(); });
+}
+
+inline void SessionTracker::closeAll() {
+    forEach([](session& s) { s.force_close(); });
+}
@@ -1,60 +1,250 @@
 ﻿#pragma once
 
 #include "BaseModule.h"
-#include <boost/asio.hpp>
-#include <unordered_map>
+#include "LoggingModule.h"
+#include <boost/asio/ip/address.hpp>
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <atomic>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-// Простой модуль для защиты от DoS-атак на основе rate limiting по IP.
+// Модуль защиты от DoS-атак: token bucket на каждый IP.
 // Алгоритм:
-// 1. Отслеживаем количество запросов от каждого IP в скользящем окне времени (например, 1 минута).
-// 2. Если количество запросов превышает порог (threshold), IP блокируется на заданное время (ban_duration).
-// 3. Периодическая очистка старых записей для экономии памяти.
-// 4. Интеграция: модуль может быть вызван в обработчике входящих соединений (например, в accept handler Boost Asio).
-//    Перед обработкой запроса проверяем isAllowed(ip), если нет - закрываем соединение.
-// Масштабируемость: в будущем можно добавить Redis для распределенного хранения, или более сложные алгоритмы (token bucket).
+// 1. У каждого клиента есть "ведро" на capacity токенов, которое пополняется со скоростью refill_per_second.
+// 2. Каждый HTTP-запрос (а не только accept) списывает из ведра стоимость маршрута (по умолчанию 1 токен).
+//    Тяжёлые эндпоинты стоят дороже — см. setRouteCost.
+// 3. Если токенов не хватает — запрос отклоняется. После ban_after_rejections отказов подряд IP банится на ban_duration.
+// 4. Клиенты хранятся по бинарному адресу (IPv4 как IPv4-mapped IPv6) в шардированной таблице:
+//    у каждого шарда свой мьютекс на своей кэш-линии, поэтому потоки почти не конкурируют, а строки не аллоцируются.
+// 5. Фоновый поток периодически удаляет давно неактивных клиентов.
+// 6. Отказы не пишутся в консоль по одному: они копятся в атомарных счётчиках, а фоновый поток
+//    раз в report_interval выводит одну сводку. На I/O-потоке отказ стоит пару атомарных инкрементов.
+// 7. Опционально забаненные адреса выгружаются в nftables set (Settings::nft_table), и ядро
+//    отбрасывает их пакеты ещё до async_accept. Набор правил — tools/nftables/modular_server.nft.
+// 8. Число одновременных соединений ограничено глобально и на IP (acquireConnection).
+//    Место занимает ConnectionGuard, который живёт в session: закрылась сессия — место освободилось.
 
 class DoSProtectionModule : public BaseModule {
-private:
+public:
     using Clock = std::chrono::steady_clock;
     using TimePoint = Clock::time_point;
     using Duration = Clock::duration;
 
-    struct ClientInfo {
-        int request_count = 0;
-        TimePoint last_request;
+    struct Settings {
+        double capacity = 200.0;                                 // Размер всплеска
+        double refill_per_second = 50.0;                         // Устойчивая скорость, запросов/сек
+        int ban_after_rejections = 100;                          // Отказов подряд до бана
+        Duration ban_duration = std::chrono::minutes(5);
+        Duration idle_expiry = std::chrono::minutes(10);         // Через сколько забывать неактивного клиента
+        Duration cleanup_interval = std::chrono::minutes(1);
+        Duration report_interval = std::chrono::seconds(10);     // Период сводки по отказам
+        std::string nft_table;                                   // "inet modular_server"; пусто — без выгрузки в ядро
+        size_t max_connections = 10000;                          // Одновременных соединений всего; 0 — без лимита
+        size_t max_connections_per_ip = 256;                     // Одновременных соединений с одного IP; 0 — без лимита
+    };
+
+    // Результат проверки: при отказе — через сколько стоит повторить (для Retry-After)
+    struct Decision {
+        bool allowed = true;
+        std::chrono::seconds retry_after{ 0 };
+    };
+
+    struct Stats {
+        uint64_t rejected_connections = 0;
+        uint64_t rejected_requests = 0;
+        uint64_t bans = 0;
+        uint64_t limited_connections = 0;  // Отказано по лимиту соединений (входят и в rejected_connections)
+        uint64_t active_connections = 0;
+    };
+
+    // Бинарный ключ клиента: 16 байт IPv6 (IPv4 — в виде ::ffff:a.b.c.d)
+    struct ClientKey {
+        std::array<unsigned char, 16> bytes{};
+
+        static ClientKey from(const boost::asio::ip::address& address) {
+            ClientKey key;
+            if (address.is_v4()) {
+                auto v4 = address.to_v4().to_bytes();
+                key.bytes[10] = 0xff;
+                key.bytes[11] = 0xff;
+                std::copy(v4.begin(), v4.end(), key.bytes.begin() + 12);
+            }
+            else {
+                key.bytes = address.to_v6().to_bytes();
+            }
+            return key;
+        }
+
+        boost::asio::ip::address toAddress() const {
+            boost::asio::ip::address_v6 v6(bytes);
+            if (v6.is_v4_mapped()) {
+                return boost::asio::ip::make_address_v4(boost::asio::ip::v4_mapped, v6);
+            }
+            return v6;
+        }
+
+        bool operator==(const ClientKey& other) const { return bytes == other.bytes; }
+    };
+
+    struct ClientKeyHash {
+        size_t operator()(const ClientKey& key) const noexcept {
+            uint64_t hi, lo;
+            std::memcpy(&hi, key.bytes.data(), sizeof(hi));
+            std::memcpy(&lo, key.bytes.data() + 8, sizeof(lo));
+            // splitmix-подобное перемешивание: младшие биты адреса должны попадать в разные шарды
+            uint64_t h = hi * 0x9E3779B97F4A7C15ULL ^ lo;
+            h ^= h >> 31;
+            h *= 0xBF58476D1CE4E5B9ULL;
+            h ^= h >> 29;
+            return static_cast<size_t>(h);
+        }
+    };
+
+private:
+    struct Bucket {
+        double tokens = 0.0;
+        TimePoint last_refill;
         TimePoint ban_until;
+        int rejections = 0;
+        uint32_t connections = 0;  // Открытые сессии с этого IP
     };
 
-    std::unordered_map<std::string, ClientInfo> clients_; // IP -> info
-    std::mutex mutex_; // Для thread-safety
-    std::thread cleanup_thread_; // Для периодической очистки
+    static constexpr size_t kShardCount = 64;
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_map<ClientKey, Bucket, ClientKeyHash> clients;
+    };
+
+    Settings settings_;
+    std::array<Shard, kShardCount> shards_;
+
+    // Стоимость по префиксу пути; заполняется до старта сервера, дальше только читается
+    std::vector<std::pair<std::string, double>> route_costs_;
+
+    std::thread cleanup_thread_; // Для периодической очистки, сводок и выгрузки банов
     std::atomic<bool> running_; // Флаг для остановки cleanup
+    std::mutex cleanup_mutex_;
+    std::condition_variable cleanup_cv_;
 
-    // Настройки (можно вынести в конфиг в будущем)
-    const int max_requests_per_minute_ = 100; // Порог запросов в минуту
-    const Duration window_duration_ = std::chrono::minutes(1);
-    const Duration ban_duration_ = std::chrono::minutes(5);
-    const Duration cleanup_interval_ = std::chrono::minutes(10);
+    // Счётчики отказов: пишутся с I/O-потоков, читаются фоновым потоком
+    std::atomic<uint64_t> rejected_connections_{ 0 };
+    std::atomic<uint64_t> rejected_requests_{ 0 };
+    std::atomic<uint64_t> bans_{ 0 };
+    std::atomic<uint64_t> limited_connections_{ 0 };
+    std::atomic<uint64_t> active_connections_{ 0 };
+
+    // Новые баны для выгрузки в nftables (редкое событие, обычный мьютекс)
+    std::mutex pending_bans_mutex_;
+    std::vector<ClientKey> pending_bans_;
+
+    Shard& shardFor(size_t hash) {
+        return shards_[(hash >> 8) % kShardCount];
+    }
+
+    void cleanupClients() {
+        auto now = Clock::now();
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto it = shard.clients.begin(); it != shard.clients.end(); ) {
+                // Клиент с открытыми соединениями не удаляется, иначе потеряется его счётчик соединений
+                if (now - it->second.last_refill > settings_.idle_expiry && now >= it->second.ban_until
+                    && it->second.connections == 0) {
+                    it = shard.clients.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    // Одна строка на интервал вместо строки на каждый отказ
+    void reportRejections(Stats& last) {
+        Stats current = getStats();
+        Stats delta;
+        delta.rejected_connections = current.rejected_connections - last.rejected_connections;
+        delta.rejected_requests = current.rejected_requests - last.rejected_requests;
+        delta.bans = current.bans - last.bans;
+        delta.limited_connections = current.limited_connections - last.limited_connections;
+        last = current;
+        if (delta.rejected_connections == 0 && delta.rejected_requests == 0 && delta.bans == 0) {
+            return;
+        }
+        Log::warning("DoS protection rejections", {
+            {"connections", delta.rejected_connections},
+            {"connection_limit", delta.limited_connections},
+            {"requests", delta.rejected_requests},
+            {"new_bans", delta.bans},
+            {"active_connections", current.active_connections} });
+    }
+
+    // Пакетная выгрузка банов одним вызовом nft на набор адресов каждого семейства
+    void exportBans() {
+        std::vector<ClientKey> bans;
+        {
+            std::lock_guard<std::mutex> lock(pending_bans_mutex_);
+            bans.swap(pending_bans_);
+        }
+        if (bans.empty() || settings_.nft_table.empty()) {
+            return;
+        }
+#ifndef _WIN32
+        const auto timeout = std::chrono::duration_cast<std::chrono::seconds>(settings_.ban_duration).count();
+        std::ostringstream v4, v6;
+        for (const auto& key : bans) {
+            auto address = key.toAddress();
+            auto& out = address.is_v4() ? v4 : v6;
+            if (out.tellp() > 0) out << ", ";
+            out << address.to_string() << " timeout " << timeout << "s";
+        }
+        auto run = [this](const char* set, const std::string& elements) {
+            if (elements.empty()) return;
+            std::string command = "nft add element " + settings_.nft_table + " " + set + " '{ " + elements + " }'";
+            if (std::system(command.c_str()) != 0) {
+                Log::error("nft export failed", { {"command", command} });
+            }
+            };
+        run("banned_v4", v4.str());
+        run("banned_v6", v6.str());
+#endif
+    }
 
     void cleanupLoop() {
+        auto next_cleanup = Clock::now() + settings_.cleanup_interval;
+        Stats last{};
         while (running_) {
-            {
-                std::lock_guard<std::mutex> lock(mutex_);
-                auto now = Clock::now();
-                for (auto it = clients_.begin(); it != clients_.end(); ) {
-                    if (now - it->second.last_request > cleanup_interval_) {
-                        it = clients_.erase(it);
-                    }
-                    else {
-                        ++it;
-                    }
-                }
+            reportRejections(last);
+            exportBans();
+            if (Clock::now() >= next_cleanup) {
+                cleanupClients();
+                next_cleanup = Clock::now() + settings_.cleanup_interval;
             }
-            std::this_thread::sleep_for(cleanup_interval_);
+            std::unique_lock<std::mutex> lock(cleanup_mutex_);
+            cleanup_cv_.wait_for(lock, settings_.report_interval, [this] { return !running_; });
+        }
+    }
+
+    void stopCleanup() {
+        {
+            std::lock_guard<std::mutex> lock(cleanup_mutex_);
+            running_ = false;
+        }
+        cleanup_cv_.notify_all();
+        if (cleanup_thread_.joinable()) {
+            cleanup_thread_.join();
         }
     }
 
@@ -63,13 +253,12 @@ public:
         : BaseModule(name, id), running_(false) {
     }
 
+    DoSProtectionModule(const Settings& settings, const std::string& name = "DoSProtection", const int& id = -1)
+        : BaseModule(name, id), settings_(settings), running_(false) {
+    }
+
     ~DoSProtectionModule() {
-        if (running_) {
-            running_ = false;
-            if (cleanup_thread_.joinable()) {
-                cleanup_thread_.join();
-            }
-        }
+        stopCleanup();
     }
 
 protected:
@@ -82,44 +271,202 @@ protected:
 
     void onShutdown() override {
         // Остановка cleanup потока
-        running_ = false;
-        if (cleanup_thread_.joinable()) {
-            cleanup_thread_.join();
+        stopCleanup();
+        for (auto& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.clients.clear();
         }
-        clients_.clear();
     }
 
 public:
-    // Основной метод: проверить, разрешен ли запрос от этого IP
-    // Вызывать в обработчике соединений, перед обработкой запроса.
-    // Возвращает true, если разрешено; false, если заблокировано.
-    bool isAllowed(const std::string& ip) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        auto now = Clock::now();
+    // Задать стоимость запросов, путь которых начинается с prefix. Побеждает самый длинный префикс.
+    // Вызывать до запуска сервера.
+    void setRouteCost(const std::string& prefix, double cost) {
+        auto it = std::find_if(route_costs_.begin(), route_costs_.end(),
+            [&prefix](const auto& entry) { return entry.first == prefix; });
+        if (it != route_costs_.end()) {
+            it->second = cost;
+        }
+        else {
+            route_costs_.emplace_back(prefix, cost);
+        }
+    }
+
+    double routeCost(std::string_view path) const {
+        double cost = 1.0;
+        size_t best = 0;
+        for (const auto& [prefix, prefix_cost] : route_costs_) {
+            if (prefix.size() > best && path.substr(0, prefix.size()) == prefix) {
+                best = prefix.size();
+                cost = prefix_cost;
+            }
+        }
+        return cost;
+    }
+
+    // Основной метод: списать cost токенов у клиента.
+    // Вызывать на каждый запрос. При отказе (лимит исчерпан или IP забанен) сообщает, когда повторить.
+    Decision check(const boost::asio::ip::address& address, double cost = 1.0) {
+        const ClientKey key = ClientKey::from(address);
+        Shard& shard = shardFor(ClientKeyHash{}(key));
+        const auto now = Clock::now();
 
-        auto& info = clients_[ip];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto [it, inserted] = shard.clients.try_emplace(key);
+        Bucket& bucket = it->second;
+        if (inserted) {
+            bucket.tokens = settings_.capacity;
+            bucket.last_refill = now;
+        }
 
         // Если забанен
-        if (now < info.ban_until) {
-            return false;
+        if (now < bucket.ban_until) {
+            rejected_requests_.fetch_add(1, std::memory_order_relaxed);
+            return { false, secondsUntil(bucket.ban_until - now) };
         }
 
-        // Обновляем счетчик
-        if (now - info.last_request > window_duration_) {
-            // Окно истекло, сброс
-            info.request_count = 1;
+        // Пополняем ведро за прошедшее время
+        const double elapsed = std::chrono::duration<double>(now - bucket.last_refill).count();
+        bucket.tokens = std::min(settings_.capacity, bucket.tokens + elapsed * settings_.refill_per_second);
+        bucket.last_refill = now;
+
+        if (bucket.tokens >= cost) {
+            bucket.tokens -= cost;
+            bucket.rejections = 0;
+            return {};
         }
-        else {
-            ++info.request_count;
+
+        rejected_requests_.fetch_add(1, std::memory_order_relaxed);
+        if (++bucket.rejections >= settings_.ban_after_rejections) {
+            bucket.ban_until = now + settings_.ban_duration;
+            bucket.rejections = 0;
+            bans_.fetch_add(1, std::memory_order_relaxed);
+            if (!settings_.nft_table.empty()) {
+                std::lock_guard<std::mutex> bans_lock(pending_bans_mutex_);
+                pending_bans_.push_back(key);
+            }
+            return { false, secondsUntil(settings_.ban_duration) };
+        }
+
+        const double deficit = cost - bucket.tokens;
+        return { false, secondsUntil(std::chrono::duration_cast<Duration>(
+            std::chrono::duration<double>(deficit / settings_.refill_per_second))) };
+    }
+
+    bool isAllowed(const boost::asio::ip::address& address, double cost = 1.0) {
+        return check(address, cost).allowed;
+    }
+
+    // Проверка бана без списания токенов — для accept, до создания сессии
+    bool isBanned(const boost::asio::ip::address& address) {
+        const ClientKey key = ClientKey::from(address);
+        Shard& shard = shardFor(ClientKeyHash{}(key));
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.clients.find(key);
+        return it != shard.clients.end() && Clock::now() < it->second.ban_until;
+    }
+
+    // Место под соединение: пока guard жив, соединение учитывается в лимитах.
+    // Пустой guard (operator bool == false) — лимит исчерпан или модуль не задан
+    class ConnectionGuard {
+    public:
+        ConnectionGuard() = default;
+        ConnectionGuard(DoSProtectionModule* owner, const ClientKey& key) : owner_(owner), key_(key) {}
+        ~ConnectionGuard() { release(); }
+
+        ConnectionGuard(ConnectionGuard&& other) noexcept : owner_(std::exchange(other.owner_, nullptr)), key_(other.key_) {}
+        ConnectionGuard& operator=(ConnectionGuard&& other) noexcept {
+            if (this != &other) {
+                release();
+                owner_ = std::exchange(other.owner_, nullptr);
+                key_ = other.key_;
+            }
+            return *this;
         }
-        info.last_request = now;
+        ConnectionGuard(const ConnectionGuard&) = delete;
+        ConnectionGuard& operator=(const ConnectionGuard&) = delete;
 
-        // Проверяем порог
-        if (info.request_count > max_requests_per_minute_) {
-            info.ban_until = now + ban_duration_;
-            return false;
+        explicit operator bool() const { return owner_ != nullptr; }
+
+    private:
+        void release() {
+            if (owner_) {
+                owner_->releaseConnection(key_);
+                owner_ = nullptr;
+            }
         }
 
-        return true;
+        DoSProtectionModule* owner_ = nullptr;
+        ClientKey key_;
+    };
+
+    // Занять место под соединение на accept. При отказе считает его в rejected_connections
+    ConnectionGuard acquireConnection(const boost::asio::ip::address& address) {
+        const uint64_t active = active_connections_.fetch_add(1, std::memory_order_relaxed);
+        if (settings_.max_connections > 0 && active >= settings_.max_connections) {
+            active_connections_.fetch_sub(1, std::memory_order_relaxed);
+            rejectLimitedConnection();
+            return {};
+        }
+
+        const ClientKey key = ClientKey::from(address);
+        Shard& shard = shardFor(ClientKeyHash{}(key));
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto [it, inserted] = shard.clients.try_emplace(key);
+            Bucket& bucket = it->second;
+            if (inserted) {
+                bucket.tokens = settings_.capacity;
+                bucket.last_refill = Clock::now();
+            }
+            if (settings_.max_connections_per_ip == 0 || bucket.connections < settings_.max_connections_per_ip) {
+                ++bucket.connections;
+                return ConnectionGuard(this, key);
+            }
+        }
+        active_connections_.fetch_sub(1, std::memory_order_relaxed);
+        rejectLimitedConnection();
+        return {};
+    }
+
+    // Соединение забаненного клиента закрыто на accept
+    void recordRejectedConnection() {
+        rejected_connections_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Stats getStats() const {
+        Stats stats;
+        stats.rejected_connections = rejected_connections_.load(std::memory_order_relaxed);
+        stats.rejected_requests = rejected_requests_.load(std::memory_order_relaxed);
+        stats.bans = bans_.load(std::memory_order_relaxed);
+        stats.limited_connections = limited_connections_.load(std::memory_order_relaxed);
+        stats.active_connections = active_connections_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    const Settings& getSettings() const { return settings_; }
+
+private:
+    void rejectLimitedConnection() {
+        limited_connections_.fetch_add(1, std::memory_order_relaxed);
+        rejected_connections_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void releaseConnection(const ClientKey& key) {
+        Shard& shard = shardFor(ClientKeyHash{}(key));
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.clients.find(key);
+            if (it != shard.clients.end() && it->second.connections > 0) {
+                --it->second.connections;
+            }
+        }
+        active_connections_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    static std::chrono::seconds secondsUntil(Duration duration) {
+        auto seconds = std::chrono::ceil<std::chrono::seconds>(duration);
+        return std::max(seconds, std::chrono::seconds(1));
     }
-};
\ No newline at end of file
+};
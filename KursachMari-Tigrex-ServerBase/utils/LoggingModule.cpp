@@ -0,0 +1,250 @@
+﻿#include "LoggingModule.h"
+
+#include <charconv>
+#include <cstring>
+#include <ctime>
+
+std::atomic<LoggingModule*> LoggingModule::instance_{ nullptr };
+
+namespace {
+    // Запись в фиксированный буфер с обрезкой по границе
+    struct BoundedWriter {
+        char* pos;
+        char* end;
+        bool truncated = false;
+
+        void put(char c) {
+            if (pos < end) *pos++ = c;
+            else truncated = true;
+        }
+
+        void append(std::string_view text) {
+            size_t n = std::min(text.size(), static_cast<size_t>(end - pos));
+            std::memcpy(pos, text.data(), n);
+            pos += n;
+            if (n < text.size()) truncated = true;
+        }
+
+        template<class T>
+        void appendNumber(T value) {
+            auto [ptr, ec] = std::to_chars(pos, end, value);
+            if (ec == std::errc()) pos = ptr;
+            else truncated = true;
+        }
+
+        void appendQuoted(std::string_view text) {
+            put('"');
+            for (char c : text) {
+                switch (c) {
+                case '"': append("\\\""); break;
+                case '\\': append("\\\\"); break;
+                case '\n': append("\\n"); break;
+                case '\r': append("\\r"); break;
+                case '\t': append("\\t"); break;
+                default: put(c); break;
+                }
+            }
+            put('"');
+        }
+
+        // logfmt: кавычки нужны только если значение пустое или содержит разделители
+        void appendValue(std::string_view text) {
+            bool needs_quotes = text.empty();
+            for (char c : text) {
+                if (c == ' ' || c == '=' || c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20) {
+                    needs_quotes = true;
+                    break;
+                }
+            }
+            if (needs_quotes) appendQuoted(text);
+            else append(text);
+        }
+    };
+
+    const char* levelName(LogLevel level) {
+        switch (level) {
+        case LogLevel::Debug: return "debug";
+        case LogLevel::Info: return "info";
+        case LogLevel::Warning: return "warning";
+        case LogLevel::Error: return "error";
+        }
+        return "info";
+    }
+
+    int64_t nowMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+LoggingModule::LoggingModule(LogLevel min_level, FILE* sink)
+    : BaseModule("Logging Module")
+    , slots_(std::make_unique<Slot[]>(kCapacity))
+    , min_level_(min_level)
+    , sink_(sink) {
+    for (size_t i = 0; i < kCapacity; ++i) {
+        slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+LoggingModule::~LoggingModule() {
+    stopFlusher();
+}
+
+bool LoggingModule::onInitialize() {
+    running_.store(true);
+    flusher_ = std::thread(&LoggingModule::flusherLoop, this);
+    instance_.store(this, std::memory_order_release);
+    return true;
+}
+
+void LoggingModule::onShutdown() {
+    stopFlusher();
+}
+
+void LoggingModule::stopFlusher() {
+    LoggingModule* self = this;
+    instance_.compare_exchange_strong(self, nullptr);
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        running_.store(false);
+    }
+    wake_cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+}
+
+void LoggingModule::log(LogLevel level, std::string_view message, std::initializer_list<LogField> fields) {
+    LoggingModule* logger = instance_.load(std::memory_order_acquire);
+    if (!logger) {
+        writeFallback(level, message, fields);
+        return;
+    }
+    if (level < logger->min_level_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (!logger->tryPush(level, message, fields)) {
+        logger->dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool LoggingModule::tryPush(LogLevel level, std::string_view message, std::initializer_list<LogField> fields) {
+    uint64_t pos = head_.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (;;) {
+        slot = &slots_[pos & (kCapacity - 1)];
+        uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return false;  // Кольцо заполнено — сбросчик не успевает
+        }
+        else {
+            pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->timestamp_us = nowMicros();
+    slot->level = level;
+    slot->length = static_cast<uint16_t>(formatRecord(slot->text, kSlotTextSize, message, fields));
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+size_t LoggingModule::formatRecord(char* out, size_t capacity, std::string_view message, std::initializer_list<LogField> fields) {
+    BoundedWriter w{ out, out + capacity };
+    w.append("msg=");
+    w.appendQuoted(message);
+    for (const auto& field : fields) {
+        w.put(' ');
+        w.append(field.key);
+        w.put('=');
+        switch (field.kind) {
+        case LogField::Kind::String: w.appendValue(field.str); break;
+        case LogField::Kind::Int: w.appendNumber(field.i); break;
+        case LogField::Kind::Uint: w.appendNumber(field.u); break;
+        case LogField::Kind::Double: w.appendNumber(field.d); break;
+        case LogField::Kind::Bool: w.append(field.i ? "true" : "false"); break;
+        }
+    }
+    if (w.truncated && capacity >= 3) {
+        std::memcpy(out + capacity - 3, "...", 3);
+        return capacity;
+    }
+    return static_cast<size_t>(w.pos - out);
+}
+
+void LoggingModule::appendPrefix(std::string& batch, int64_t timestamp_us, LogLevel level) {
+    std::time_t seconds = static_cast<std::time_t>(timestamp_us / 1000000);
+    std::tm tm{};
+#ifdef _WIN32
+    gmtime_s(&tm, &seconds);
+#else
+    gmtime_r(&seconds, &tm);
+#endif
+    char prefix[64];
+    int n = std::snprintf(prefix, sizeof(prefix), "ts=%04d-%02d-%02dT%02d:%02d:%02d.%06dZ level=%s ",
+        tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+        static_cast<int>(timestamp_us % 1000000), levelName(level));
+    if (n > 0) batch.append(prefix, static_cast<size_t>(std::min<int>(n, sizeof(prefix) - 1)));
+}
+
+size_t LoggingModule::drain(std::string& batch) {
+    size_t count = 0;
+    for (;;) {
+        Slot& slot = slots_[tail_ & (kCapacity - 1)];
+        uint64_t seq = slot.sequence.load(std::memory_order_acquire);
+        if (seq != tail_ + 1) {
+            break;  // Слот ещё не дописан (или пуст)
+        }
+        appendPrefix(batch, slot.timestamp_us, slot.level);
+        batch.append(slot.text, slot.length);
+        batch.push_back('\n');
+        slot.sequence.store(tail_ + kCapacity, std::memory_order_release);
+        ++tail_;
+        ++count;
+    }
+    return count;
+}
+
+void LoggingModule::flusherLoop() {
+    std::string batch;
+    batch.reserve(64 * 1024);
+    uint64_t reported_dropped = 0;
+
+    auto flush = [this, &batch, &reported_dropped]() {
+        drain(batch);
+        uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reported_dropped) {
+            appendPrefix(batch, nowMicros(), LogLevel::Warning);
+            batch += "msg=\"Log records dropped\" count=" + std::to_string(dropped - reported_dropped) + "\n";
+            reported_dropped = dropped;
+        }
+        if (!batch.empty()) {
+            std::fwrite(batch.data(), 1, batch.size(), sink_);  // Один системный вызов на пачку
+            std::fflush(sink_);
+            batch.clear();
+        }
+        };
+
+    while (running_.load()) {
+        flush();
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cv_.wait_for(lock, flush_interval_, [this] { return !running_.load(); });
+    }
+    flush();  // Дописываем хвост при остановке
+}
+
+void LoggingModule::writeFallback(LogLevel level, std::string_view message, std::initializer_list<LogField> fields) {
+    std::string line;
+    appendPrefix(line, nowMicros(), level);
+    char text[kSlotTextSize];
+    line.append(text, formatRecord(text, sizeof(text), message, fields));
+    line.push_back('\n');
+    std::fwrite(line.data(), 1, line.size(), stderr);
+}
@@ -0,0 +1,134 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+/*
+# LoggingModule
+    Асинхронный структурированный лог.
+    Горячий путь (session, accept, FileCache) только форматирует строку в слот кольцевого буфера
+    (lock-free MPSC по схеме Вьюкова) — без мьютексов и системных вызовов.
+    Фоновый поток раз в flush_interval собирает накопившиеся записи в один буфер и пишет его
+    одним fwrite. При переполнении кольца запись отбрасывается и учитывается в dropped.
+
+    Формат — logfmt: ts=... level=info msg="Client connected" ip=127.0.0.1 port=50412
+    Пока модуль не инициализирован, записи пишутся синхронно в stderr.
+*/
+
+enum class LogLevel : uint8_t { Debug, Info, Warning, Error };
+
+// Структурированное поле: ключ + значение одного из простых типов. Данные не копируются —
+// поле живёт только на время вызова Log::*
+struct LogField {
+    enum class Kind : uint8_t { String, Int, Uint, Double, Bool };
+
+    std::string_view key;
+    Kind kind;
+    std::string_view str;
+    int64_t i = 0;
+    uint64_t u = 0;
+    double d = 0.0;
+
+    LogField(std::string_view k, std::string_view v) : key(k), kind(Kind::String), str(v) {}
+    LogField(std::string_view k, const char* v) : key(k), kind(Kind::String), str(v ? v : "") {}
+    LogField(std::string_view k, const std::string& v) : key(k), kind(Kind::String), str(v) {}
+    LogField(std::string_view k, bool v) : key(k), kind(Kind::Bool), i(v ? 1 : 0) {}
+    LogField(std::string_view k, double v) : key(k), kind(Kind::Double), d(v) {}
+
+    template<class T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    LogField(std::string_view k, T v) : key(k) {
+        if constexpr (std::is_signed_v<T>) {
+            kind = Kind::Int;
+            i = static_cast<int64_t>(v);
+        }
+        else {
+            kind = Kind::Uint;
+            u = static_cast<uint64_t>(v);
+        }
+    }
+};
+
+class LoggingModule : public BaseModule {
+public:
+    static constexpr size_t kSlotTextSize = 496;
+    static constexpr size_t kCapacity = 4096;  // Степень двойки
+
+    explicit LoggingModule(LogLevel min_level = LogLevel::Info, FILE* sink = stdout);
+    ~LoggingModule() override;
+
+    LoggingModule(const LoggingModule&) = delete;
+    LoggingModule& operator=(const LoggingModule&) = delete;
+
+    // Точка входа для Log::*. Потокобезопасна, не блокируется
+    static void log(LogLevel level, std::string_view message, std::initializer_list<LogField> fields);
+
+    void setMinLevel(LogLevel level) { min_level_.store(level, std::memory_order_relaxed); }
+    LogLevel getMinLevel() const { return min_level_.load(std::memory_order_relaxed); }
+
+    uint64_t getDroppedCount() const { return dropped_.load(std::memory_order_relaxed); }
+
+protected:
+    bool onInitialize() override;
+    void onShutdown() override;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence{ 0 };
+        int64_t timestamp_us = 0;
+        LogLevel level = LogLevel::Info;
+        uint16_t length = 0;
+        char text[kSlotTextSize];
+    };
+
+    bool tryPush(LogLevel level, std::string_view message, std::initializer_list<LogField> fields);
+    void flusherLoop();
+    size_t drain(std::string& batch);
+    void stopFlusher();
+
+    static size_t formatRecord(char* out, size_t capacity, std::string_view message, std::initializer_list<LogField> fields);
+    static void appendPrefix(std::string& batch, int64_t timestamp_us, LogLevel level);
+    static void writeFallback(LogLevel level, std::string_view message, std::initializer_list<LogField> fields);
+
+    static std::atomic<LoggingModule*> instance_;
+
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<uint64_t> head_{ 0 };   // Производители
+    alignas(64) uint64_t tail_ = 0;                 // Только поток-сбросчик
+    alignas(64) std::atomic<uint64_t> dropped_{ 0 };
+
+    std::atomic<LogLevel> min_level_;
+    FILE* sink_;
+    std::chrono::milliseconds flush_interval_{ 20 };
+
+    std::thread flusher_;
+    std::atomic<bool> running_{ false };
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+};
+
+namespace Log {
+    inline void debug(std::string_view message, std::initializer_list<LogField> fields = {}) {
+        LoggingModule::log(LogLevel::Debug, message, fields);
+    }
+    inline void info(std::string_view message, std::initializer_list<LogField> fields = {}) {
+        LoggingModule::log(LogLevel::Info, message, fields);
+    }
+    inline void warning(std::string_view message, std::initializer_list<LogField> fields = {}) {
+        LoggingModule::log(LogLevel::Warning, message, fields);
+    }
+    inline void error(std::string_view message, std::initializer_list<LogField> fields = {}) {
+        LoggingModule::log(LogLevel::Error, message, fields);
+    }
+}
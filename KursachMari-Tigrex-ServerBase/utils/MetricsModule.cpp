@@ -0,0 +1,268 @@
+﻿#include "MetricsModule.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <memory>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Счётчик с единственным писателем: без lock-префикса, экспорт читает relaxed
+    using Cell = std::atomic<uint64_t>;
+
+    inline void bump(Cell& cell, uint64_t value) {
+        cell.store(cell.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    struct Histogram {
+        std::array<Cell, MetricsModule::kHistogramBuckets> buckets{};
+        Cell sum_ns{ 0 };
+    };
+
+    // Всё, что пишет один поток. Кэш-линии шардов не пересекаются
+    struct alignas(64) Shard {
+        std::array<std::array<Cell, MetricsModule::kStatusClasses>, MetricsModule::kMaxRoutes> route_status{};
+        std::array<Cell, MetricsModule::kMaxRoutes> route_latency_ns{};
+        std::array<Histogram, MetricsModule::kPhaseCount> phases{};
+        std::array<Cell, MetricsModule::kCounterCount> counters{};
+    };
+
+    // Шарды не удаляются при завершении потока: его счётчики остаются в сумме
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Shard>> shards;
+        std::vector<std::string> routes;
+    };
+
+    Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    Shard& localShard() {
+        thread_local Shard* shard = nullptr;
+        if (!shard) {
+            auto& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            reg.shards.push_back(std::make_unique<Shard>());
+            shard = reg.shards.back().get();
+        }
+        return *shard;
+    }
+
+    uint64_t toNanos(std::chrono::nanoseconds duration) {
+        return duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0;
+    }
+
+    const char* phaseName(size_t phase) {
+        static constexpr const char* names[MetricsModule::kPhaseCount] = { "parse", "handler", "db", "db_wait", "write" };
+        return names[phase];
+    }
+
+    void appendEscaped(std::string& out, std::string_view value) {
+        for (char c : value) {
+            switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"': out += "\\\""; break;
+            case '\n': out += "\\n"; break;
+            default: out += c; break;
+            }
+        }
+    }
+
+    void appendSeconds(std::string& out, uint64_t nanos) {
+        char buf[32];
+        int n = std::snprintf(buf, sizeof(buf), "%.9f", static_cast<double>(nanos) / 1e9);
+        out.append(buf, static_cast<size_t>(n));
+    }
+
+    void appendHeader(std::string& out, const char* name, const char* type, const char* help) {
+        out += "# HELP "; out += name; out += ' '; out += help; out += '\n';
+        out += "# TYPE "; out += name; out += ' '; out += type; out += '\n';
+    }
+}
+
+MetricsModule::MetricsModule() : BaseModule("Metrics Module") {
+}
+
+bool MetricsModule::onInitialize() {
+    return true;
+}
+
+void MetricsModule::prepareThread() {
+    localShard();
+}
+
+void MetricsModule::onShutdown() {
+    std::lock_guard<std::mutex> lock(collectors_mutex_);
+    collectors_.clear();
+}
+
+int MetricsModule::registerRoute(std::string_view label) {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (size_t i = 0; i < reg.routes.size(); ++i) {
+        if (reg.routes[i] == label) return static_cast<int>(i);
+    }
+    if (reg.routes.size() + 1 >= kMaxRoutes) {
+        // Последний слот общий для всего, что не поместилось
+        if (reg.routes.size() < kMaxRoutes) reg.routes.emplace_back("other");
+        return static_cast<int>(kMaxRoutes - 1);
+    }
+    reg.routes.emplace_back(label);
+    return static_cast<int>(reg.routes.size() - 1);
+}
+
+void MetricsModule::recordRequest(int route_id, unsigned status, std::chrono::nanoseconds latency) {
+    if (route_id < 0 || static_cast<size_t>(route_id) >= kMaxRoutes) return;
+    size_t status_class = status >= 100 && status < 600 ? status / 100 - 1 : kStatusClasses - 1;
+    Shard& shard = localShard();
+    bump(shard.route_status[route_id][status_class], 1);
+    bump(shard.route_latency_ns[route_id], toNanos(latency));
+}
+
+void MetricsModule::recordPhase(Phase phase, std::chrono::nanoseconds duration) {
+    uint64_t nanos = toNanos(duration);
+    Histogram& histogram = localShard().phases[static_cast<size_t>(phase)];
+    bump(histogram.buckets[bucketIndex(nanos / 1000)], 1);
+    bump(histogram.sum_ns, nanos);
+}
+
+void MetricsModule::increment(Counter counter, uint64_t value) {
+    bump(localShard().counters[static_cast<size_t>(counter)], value);
+}
+
+// Лог-линейные корзины: [0,4) мкс — по одной на микросекунду,
+// дальше каждая октава [2^k, 2^(k+1)) делится на kSubBuckets равных частей
+size_t MetricsModule::bucketIndex(uint64_t micros) {
+    if (micros < kSubBuckets) return static_cast<size_t>(micros);
+    unsigned msb = 63u - static_cast<unsigned>(std::countl_zero(micros));
+    size_t sub = static_cast<size_t>((micros >> (msb - 2)) & (kSubBuckets - 1));
+    size_t index = (msb - 1) * kSubBuckets + sub;
+    return index < kHistogramBuckets ? index : kHistogramBuckets - 1;
+}
+
+uint64_t MetricsModule::bucketUpperBoundMicros(size_t index) {
+    if (index < kSubBuckets) return index + 1;
+    size_t msb = index / kSubBuckets + 1;
+    size_t sub = index % kSubBuckets;
+    return static_cast<uint64_t>(kSubBuckets + sub + 1) << (msb - 2);
+}
+
+void MetricsModule::addCollector(Collector collector) {
+    std::lock_guard<std::mutex> lock(collectors_mutex_);
+    collectors_.push_back(std::move(collector));
+}
+
+std::string MetricsModule::renderPrometheus() const {
+    // Снимок: суммируем шарды под мьютексом реестра (запись его не берёт)
+    std::vector<std::string> routes;
+    std::vector<std::array<uint64_t, kStatusClasses>> route_status(kMaxRoutes);
+    std::vector<uint64_t> route_latency(kMaxRoutes, 0);
+    std::array<std::array<uint64_t, kHistogramBuckets>, kPhaseCount> buckets{};
+    std::array<uint64_t, kPhaseCount> phase_sum{};
+    std::array<uint64_t, kCounterCount> counters{};
+    {
+        auto& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        routes = reg.routes;
+        for (const auto& shard : reg.shards) {
+            for (size_t r = 0; r < routes.size(); ++r) {
+                for (size_t s = 0; s < kStatusClasses; ++s) {
+                    route_status[r][s] += shard->route_status[r][s].load(std::memory_order_relaxed);
+                }
+                route_latency[r] += shard->route_latency_ns[r].load(std::memory_order_relaxed);
+            }
+            for (size_t p = 0; p < kPhaseCount; ++p) {
+                for (size_t b = 0; b < kHistogramBuckets; ++b) {
+                    buckets[p][b] += shard->phases[p].buckets[b].load(std::memory_order_relaxed);
+                }
+                phase_sum[p] += shard->phases[p].sum_ns.load(std::memory_order_relaxed);
+            }
+            for (size_t c = 0; c < kCounterCount; ++c) {
+                counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::string out;
+    out.reserve(64 * 1024);
+
+    appendHeader(out, "http_requests_total", "counter", "Requests by route and status class");
+    for (size_t r = 0; r < routes.size(); ++r) {
+        for (size_t s = 0; s < kStatusClasses; ++s) {
+            if (route_status[r][s] == 0) continue;
+            out += "http_requests_total{route=\"";
+            appendEscaped(out, routes[r]);
+            out += "\",code=\"";
+            out += static_cast<char>('1' + s);
+            out += "xx\"} ";
+            out += std::to_string(route_status[r][s]);
+            out += '\n';
+        }
+    }
+
+    appendHeader(out, "http_request_duration_seconds_total", "counter", "Total time spent serving requests by route");
+    for (size_t r = 0; r < routes.size(); ++r) {
+        out += "http_request_duration_seconds_total{route=\"";
+        appendEscaped(out, routes[r]);
+        out += "\"} ";
+        appendSeconds(out, route_latency[r]);
+        out += '\n';
+    }
+
+    appendHeader(out, "http_phase_duration_seconds", "histogram", "Request latency split into parse, handler, db, db_wait and write phases");
+    for (size_t p = 0; p < kPhaseCount; ++p) {
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < kHistogramBuckets; ++b) {
+            cumulative += buckets[p][b];
+            out += "http_phase_duration_seconds_bucket{phase=\"";
+            out += phaseName(p);
+            out += "\",le=\"";
+            appendSeconds(out, bucketUpperBoundMicros(b) * 1000);
+            out += "\"} ";
+            out += std::to_string(cumulative);
+            out += '\n';
+        }
+        std::string labels = std::string("{phase=\"") + phaseName(p) + "\"";
+        out += "http_phase_duration_seconds_bucket" + labels + ",le=\"+Inf\"} " + std::to_string(cumulative) + '\n';
+        out += "http_phase_duration_seconds_sum" + labels + "} ";
+        appendSeconds(out, phase_sum[p]);
+        out += '\n';
+        out += "http_phase_duration_seconds_count" + labels + "} " + std::to_string(cumulative) + '\n';
+    }
+
+    uint64_t opened = counters[static_cast<size_t>(Counter::SessionsOpened)];
+    uint64_t closed = counters[static_cast<size_t>(Counter::SessionsClosed)];
+    appendHeader(out, "sessions_active", "gauge", "Open HTTP sessions");
+    out += "sessions_active " + std::to_string(opened >= closed ? opened - closed : 0) + '\n';
+    appendHeader(out, "sessions_total", "counter", "Sessions accepted since start");
+    out += "sessions_total " + std::to_string(opened) + '\n';
+    appendHeader(out, "sessions_idle_closed_total", "counter", "Keep-alive sessions closed after the idle timeout");
+    out += "sessions_idle_closed_total " + std::to_string(counters[static_cast<size_t>(Counter::SessionsIdleClosed)]) + '\n';
+    appendHeader(out, "sessions_timed_out_total", "counter", "Sessions closed because a request was not read or a response not written in time");
+    out += "sessions_timed_out_total " + std::to_string(counters[static_cast<size_t>(Counter::SessionTimeouts)]) + '\n';
+
+    uint64_t hits = counters[static_cast<size_t>(Counter::FileCacheHits)];
+    uint64_t misses = counters[static_cast<size_t>(Counter::FileCacheMisses)];
+    appendHeader(out, "filecache_hits_total", "counter", "FileCache lookups served from memory");
+    out += "filecache_hits_total " + std::to_string(hits) + '\n';
+    appendHeader(out, "filecache_misses_total", "counter", "FileCache lookups that went to disk or found nothing");
+    out += "filecache_misses_total " + std::to_string(misses) + '\n';
+    appendHeader(out, "filecache_hit_ratio", "gauge", "Share of FileCache lookups served from memory");
+    char ratio[32];
+    std::snprintf(ratio, sizeof(ratio), "%.6f", hits + misses ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0);
+    out += "filecache_hit_ratio " + std::string(ratio) + '\n';
+    appendHeader(out, "filecache_bytes_served_total", "counter", "Bytes returned by FileCache");
+    out += "filecache_bytes_served_total " + std::to_string(counters[static_cast<size_t>(Counter::FileCacheBytes)]) + '\n';
+
+    {
+        std::lock_guard<std::mutex> lock(collectors_mutex_);
+        for (const auto& collector : collectors_) {
+            collector(out);
+        }
+    }
+    return out;
+}
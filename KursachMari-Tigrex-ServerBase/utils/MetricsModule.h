@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+# MetricsModule
+    Метрики для capacity planning, экспорт в формате Prometheus (GET /metrics).
+    Запись идёт в счётчики текущего потока: у каждого потока свой шард, писатель у шарда один,
+    поэтому инкремент — это relaxed load + store без lock-префикса и без общих кэш-линий.
+    Экспорт суммирует все шарды.
+
+    Что собирается:
+    - запросы по маршрутам и классам статусов (2xx, 4xx, ...), суммарное время на маршрут;
+    - лог-линейные гистограммы задержек по фазам: parse, handler, db, db_wait (ожидание потока БД), write;
+    - открытые/закрытые сессии (активные = разница), закрытые по простою и по таймауту чтения/записи;
+    - попадания/промахи FileCache и отданные байты;
+    - произвольные значения от модулей через addCollector (DoS-отказы, размер кэша и т.д.).
+*/
+
+class MetricsModule : public BaseModule {
+public:
+    enum class Phase : uint8_t { Parse, Handler, Db, DbWait, Write };
+    static constexpr size_t kPhaseCount = 5;
+
+    enum class Counter : uint8_t {
+        SessionsOpened, SessionsClosed, SessionsIdleClosed, SessionTimeouts,
+        FileCacheHits, FileCacheMisses, FileCacheBytes
+    };
+    static constexpr size_t kCounterCount = 7;
+
+    static constexpr size_t kMaxRoutes = 64;
+    static constexpr size_t kStatusClasses = 5;  // 1xx..5xx
+
+    // Гистограмма: 4 поддиапазона на октаву, от 1 мкс до ~268 с
+    static constexpr size_t kSubBuckets = 4;
+    static constexpr size_t kHistogramBuckets = kSubBuckets * 27;
+
+    // Дописывает в out строки в формате Prometheus
+    using Collector = std::function<void(std::string& out)>;
+
+    MetricsModule();
+
+    // Идентификатор маршрута для recordRequest. Вызывать при регистрации маршрутов (берёт мьютекс).
+    // Повторная регистрация той же метки возвращает тот же id; сверх kMaxRoutes — общий "other"
+    static int registerRoute(std::string_view label);
+
+    static void recordRequest(int route_id, unsigned status, std::chrono::nanoseconds latency);
+    static void recordPhase(Phase phase, std::chrono::nanoseconds duration);
+    static void increment(Counter counter, uint64_t value = 1);
+    // Завести шард вызывающего потока заранее, а не на первом запросе. Вызывать с I/O-потока:
+    // onInitialize теперь выполняется в потоке ModuleRegistry
+    static void prepareThread();
+
+    void addCollector(Collector collector);
+    std::string renderPrometheus() const;
+
+    static size_t bucketIndex(uint64_t micros);
+    static uint64_t bucketUpperBoundMicros(size_t index);
+
+protected:
+    bool onInitialize() override;
+    void onShutdown() override;
+
+private:
+    mutable std::mutex collectors_mutex_;
+    std::vector<Collector> collectors_;
+};
+
+// Замер длительности фазы в пределах области видимости
+class ScopedPhaseTimer {
+public:
+    explicit ScopedPhaseTimer(MetricsModule::Phase phase)
+        : phase_(phase), start_(std::chrono::steady_clock::now()) {
+    }
+    ~ScopedPhaseTimer() {
+        MetricsModule::recordPhase(phase_, std::chrono::steady_clock::now() - start_);
+    }
+
+    ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+    ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+private:
+    MetricsModule::Phase phase_;
+    std::chrono::steady_clock::time_point start_;
+};
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <boost/program_options.hpp>
+#include <cstdint>
 #include <filesystem>
 #include <iostream>
 #include <string>
@@ -15,6 +16,24 @@ struct ServerConfig {
     std::string address = "0.0.0.0";
     int         port = 8080;
     std::string directory = "static";
+    std::string nft_table;  // nftables-таблица для банов DoS-защиты, пусто — выключено
+    std::string database = "dbname=postgres user=postgres password=postgres host=127.0.0.1 port=54855";
+    double      rate_limit = 50.0;   // Токенов в секунду на клиента
+    double      rate_burst = 200.0;  // Ёмкость корзины
+    unsigned    trace_sample = 0;    // Трассировать 1 из N запросов, 0 — выключено
+    size_t      trace_buffer = 16384; // Спанов в кольцевом буфере трассировки
+    bool        trace_admin = false;  // Маршрут /admin/trace (выгрузка и смена сэмплирования)
+    int         idle_timeout = 60;   // Секунд простоя keep-alive до закрытия
+    int         read_timeout = 15;   // Секунд на приём запроса целиком
+    int         write_timeout = 30;  // Секунд на отправку ответа
+    size_t      max_connections = 10000;      // 0 — без лимита
+    size_t      max_connections_per_ip = 256; // 0 — без лимита
+    uint32_t    header_limit = 8 * 1024;      // Байт на строку запроса и заголовки
+    uint64_t    body_limit = 1024 * 1024;     // Байт тела запроса
+    int         consistency_check = 600; // Секунд между сверками счётчиков клиентов, 0 — выключена
+    int         drain_timeout = 10;  // Секунд на завершение активных сессий при остановке
+    std::string control_socket;      // Unix-сокет горячего перезапуска, пусто — выключен
+    bool        takeover = false;    // Забрать слушающий сокет у работающего процесса через control_socket
 
     // Метод для парсинга и валидации аргументов
     static ServerConfig parse(int argc, char* argv[]) {
@@ -28,7 +47,43 @@ struct ServerConfig {
             ("port,p", po::value<int>(&config.port)->default_value(8080),
                 "Port to listen on")
             ("directory,d", po::value<std::string>(&config.directory)->default_value("static"),
-                "Path to static files directory");
+                "Path to static files directory")
+            ("nft-table", po::value<std::string>(&config.nft_table)->default_value(""),
+                "nftables table with banned_v4/banned_v6 sets for DoS bans (e.g. \"inet modular_server\")")
+            ("database", po::value<std::string>(&config.database)->default_value(config.database),
+                "PostgreSQL connection string")
+            ("rate-limit", po::value<double>(&config.rate_limit)->default_value(50.0),
+                "Per-client request rate (tokens per second)")
+            ("rate-burst", po::value<double>(&config.rate_burst)->default_value(200.0),
+                "Per-client burst size (token bucket capacity)")
+            ("trace-sample", po::value<unsigned>(&config.trace_sample)->default_value(0),
+                "Trace 1 of N requests (random sampling), 0 disables tracing (export: GET /admin/trace with --trace-admin)")
+            ("trace-buffer", po::value<size_t>(&config.trace_buffer)->default_value(16384),
+                "Trace ring buffer size in spans")
+            ("trace-admin", po::bool_switch(&config.trace_admin),
+                "Expose GET /admin/trace: trace export, ?sample=N and ?clear=1 (off by default)")
+            ("idle-timeout", po::value<int>(&config.idle_timeout)->default_value(60),
+                "Seconds an idle keep-alive connection is kept open")
+            ("read-timeout", po::value<int>(&config.read_timeout)->default_value(15),
+                "Seconds to receive a whole request after its first byte")
+            ("write-timeout", po::value<int>(&config.write_timeout)->default_value(30),
+                "Seconds to send a response")
+            ("max-connections", po::value<size_t>(&config.max_connections)->default_value(10000),
+                "Concurrent connections limit, 0 for unlimited")
+            ("max-connections-per-ip", po::value<size_t>(&config.max_connections_per_ip)->default_value(256),
+                "Concurrent connections limit per client IP, 0 for unlimited")
+            ("header-limit", po::value<uint32_t>(&config.header_limit)->default_value(8 * 1024),
+                "Max bytes of request line and headers (431 above)")
+            ("body-limit", po::value<uint64_t>(&config.body_limit)->default_value(1024 * 1024),
+                "Max bytes of request body (413 above)")
+            ("consistency-check", po::value<int>(&config.consistency_check)->default_value(600),
+                "Seconds between background checks of denormalized client counters, 0 disables them")
+            ("drain-timeout", po::value<int>(&config.drain_timeout)->default_value(10),
+                "Seconds to let active sessions finish on SIGTERM before closing them")
+            ("control-socket", po::value<std::string>(&config.control_socket)->default_value(""),
+                "Unix socket path for hot restart (listening socket handoff), empty disables it")
+            ("takeover", po::bool_switch(&config.takeover),
+                "Take the listening socket over from the process serving --control-socket, then let it drain");
 
         po::variables_map vm;
         try {
@@ -46,6 +101,31 @@ struct ServerConfig {
                 std::exit(EXIT_FAILURE);
             }
 
+            if (config.rate_limit <= 0 || config.rate_burst <= 0) {
+                std::cerr << "Error: rate-limit and rate-burst must be positive\n";
+                std::exit(EXIT_FAILURE);
+            }
+
+            if (config.idle_timeout <= 0 || config.read_timeout <= 0 || config.write_timeout <= 0) {
+                std::cerr << "Error: timeouts must be positive\n";
+                std::exit(EXIT_FAILURE);
+            }
+
+            if (config.drain_timeout < 0 || config.consistency_check < 0) {
+                std::cerr << "Error: drain-timeout and consistency-check must not be negative\n";
+                std::exit(EXIT_FAILURE);
+            }
+
+            if (config.takeover && config.control_socket.empty()) {
+                std::cerr << "Error: --takeover requires --control-socket\n";
+                std::exit(EXIT_FAILURE);
+            }
+
+            if (config.trace_buffer == 0) {
+                std::cerr << "Error: trace-buffer must be positive\n";
+                std::exit(EXIT_FAILURE);
+            }
+
             // Проверка существования директории (не критично, только предупреждение)
             if (!fs::exists(config.directory)) {
                 std::cerr << "Warning: directory '" << config.directory << "' does not exist\n";
@@ -0,0 +1,170 @@
+﻿#include "TracingModule.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace {
+    struct SpanEvent {
+        uint64_t trace_id = 0;
+        const char* name = nullptr;
+        int64_t start_ns = 0;
+        int64_t duration_ns = 0;
+        uint32_t thread = 0;
+        uint8_t detail_size = 0;
+        char detail[TracingModule::kDetailSize];
+    };
+
+    // Запись только от сэмплированных запросов, поэтому хватает одного мьютекса
+    struct Ring {
+        std::mutex mutex;
+        std::vector<SpanEvent> events;
+        size_t next = 0;
+        uint64_t recorded = 0;
+    };
+
+    Ring& ring() {
+        static Ring instance;
+        return instance;
+    }
+
+    // Точка отсчёта для ts в экспорте
+    const TracingModule::Clock::time_point epoch = TracingModule::Clock::now();
+
+    // Короткий номер потока для tid: стабилен в пределах процесса
+    uint32_t threadIndex() {
+        static std::atomic<uint32_t> counter{ 0 };
+        thread_local uint32_t index = counter.fetch_add(1, std::memory_order_relaxed) + 1;
+        return index;
+    }
+
+    void appendEscaped(std::string& out, std::string_view value) {
+        for (char c : value) {
+            switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"': out += "\\\""; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(c));
+                    out += buf;
+                }
+                else {
+                    out += c;
+                }
+                break;
+            }
+        }
+    }
+
+    // Микросекунды с тремя знаками: Chrome trace принимает дробные ts/dur
+    void appendMicros(std::string& out, int64_t nanos) {
+        char buf[32];
+        int n = std::snprintf(buf, sizeof(buf), "%lld.%03lld",
+            static_cast<long long>(nanos / 1000), static_cast<long long>(nanos % 1000));
+        out.append(buf, static_cast<size_t>(n));
+    }
+}
+
+TracingModule::TracingModule() : BaseModule("Tracing Module") {
+}
+
+TracingModule::TracingModule(const Settings& settings) : BaseModule("Tracing Module"), settings_(settings) {
+}
+
+bool TracingModule::onInitialize() {
+    auto& r = ring();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.events.assign(std::max<size_t>(settings_.capacity, 1), SpanEvent{});
+        r.next = 0;
+        r.recorded = 0;
+    }
+    setSampleEvery(settings_.sample_every);
+    return true;
+}
+
+void TracingModule::onShutdown() {
+    setSampleEvery(0);
+}
+
+void TracingModule::recordSpan(TraceContext context, const char* name,
+    Clock::time_point start, Clock::time_point end, std::string_view detail) {
+    if (!context) return;
+
+    SpanEvent event;
+    event.trace_id = context.trace_id;
+    event.name = name;
+    event.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch).count();
+    event.duration_ns = std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), 0);
+    event.thread = threadIndex();
+    event.detail_size = static_cast<uint8_t>(std::min(detail.size(), kDetailSize));
+    std::memcpy(event.detail, detail.data(), event.detail_size);
+
+    auto& r = ring();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.events.empty()) return;  // Модуль ещё не инициализирован
+    r.events[r.next] = event;
+    r.next = (r.next + 1) % r.events.size();
+    ++r.recorded;
+}
+
+std::string TracingModule::renderChromeTrace() const {
+    std::vector<SpanEvent> snapshot;
+    {
+        auto& r = ring();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        size_t count = static_cast<size_t>(std::min<uint64_t>(r.recorded, r.events.size()));
+        snapshot.reserve(count);
+        size_t first = (r.next + r.events.size() - count) % std::max<size_t>(r.events.size(), 1);
+        for (size_t i = 0; i < count; ++i) {
+            snapshot.push_back(r.events[(first + i) % r.events.size()]);
+        }
+    }
+
+    std::string out;
+    out.reserve(64 + snapshot.size() * 160);
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& event : snapshot) {
+        if (!first) out += ',';
+        first = false;
+        out += "\n{\"name\":\"";
+        appendEscaped(out, event.name);
+        out += "\",\"cat\":\"request\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+        out += std::to_string(event.thread);
+        out += ",\"ts\":";
+        appendMicros(out, event.start_ns);
+        out += ",\"dur\":";
+        appendMicros(out, event.duration_ns);
+        out += ",\"args\":{\"trace_id\":";
+        out += std::to_string(event.trace_id);
+        if (event.detail_size > 0) {
+            out += ",\"detail\":\"";
+            appendEscaped(out, std::string_view(event.detail, event.detail_size));
+            out += '"';
+        }
+        out += "}}";
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+void TracingModule::clear() {
+    auto& r = ring();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.next = 0;
+    r.recorded = 0;
+}
+
+TracingModule::Stats TracingModule::getStats() const {
+    auto& r = ring();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    Stats stats;
+    stats.traces_started = next_trace_id_.load(std::memory_order_relaxed) - 1;
+    stats.spans_recorded = r.recorded;
+    stats.spans_overwritten = r.recorded > r.events.size() ? r.recorded - r.events.size() : 0;
+    return stats;
+}
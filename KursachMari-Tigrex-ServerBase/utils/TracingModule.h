@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include "BaseModule.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/*
+# TracingModule
+    Трассировка отдельных запросов: где именно ушло время — parse, маршрут, ожидание потока БД,
+    конкретные SQL-запросы, сборка JSON, сериализация, запись в сокет.
+
+    - Решение о сэмплировании принимается один раз на запрос (session::on_read): в среднем один
+      из N запросов получает trace_id, остальные — пустой контекст.
+    - Контекст лежит в thread_local и переносится на другой поток явно: DatabaseModule::post
+      захватывает его при постановке задачи и восстанавливает на потоке БД (TraceContextScope).
+    - TraceSpan при пустом контексте — одна проверка thread_local, без часов и без записи.
+      При sample_every = 0 (по умолчанию) вся трассировка сводится к этим проверкам.
+    - Спаны сэмплированных запросов пишутся в кольцевой буфер фиксированного размера
+      (старые затираются) и отдаются в формате Chrome trace (chrome://tracing, ui.perfetto.dev).
+*/
+
+struct TraceContext {
+    uint64_t trace_id = 0;  // 0 — запрос не сэмплирован
+
+    explicit operator bool() const { return trace_id != 0; }
+};
+
+class TracingModule : public BaseModule {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Settings {
+        uint32_t sample_every = 0;   // Трассировать в среднем 1 из N запросов; 0 — выключено
+        size_t capacity = 16384;     // Спанов в кольцевом буфере
+    };
+
+    struct Stats {
+        uint64_t traces_started = 0;
+        uint64_t spans_recorded = 0;
+        uint64_t spans_overwritten = 0;  // Вытеснены из буфера до экспорта
+    };
+
+    // Длина detail у спана; длиннее — обрезается
+    static constexpr size_t kDetailSize = 64;
+
+    TracingModule();
+    explicit TracingModule(const Settings& settings);
+
+    // Начало запроса: сэмплированный контекст или пустой. Без сэмплирования — одна relaxed-загрузка
+    static TraceContext startTrace() {
+        uint32_t every = sample_every_.load(std::memory_order_relaxed);
+        if (every == 0) return {};
+        // Случайный выбор (xorshift), а не каждый N-й по счёту: иначе чередующиеся запросы
+        // одного клиента (страница, затем API) попадали бы в выборку только одной стороной
+        thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ reinterpret_cast<uintptr_t>(&state);
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        if (state % every != 0) return {};
+        return { next_trace_id_.fetch_add(1, std::memory_order_relaxed) };
+    }
+
+    static TraceContext current() { return current_; }
+    static void setCurrent(TraceContext context) { current_ = context; }
+
+    // Спан с явными границами — для фаз, которые начинаются и заканчиваются в разных callback'ах.
+    // name должен жить всё время работы (строковый литерал)
+    static void recordSpan(TraceContext context, const char* name,
+        Clock::time_point start, Clock::time_point end, std::string_view detail = {});
+
+    static void setSampleEvery(uint32_t every) { sample_every_.store(every, std::memory_order_relaxed); }
+    static uint32_t sampleEvery() { return sample_every_.load(std::memory_order_relaxed); }
+
+    // {"traceEvents":[...]} — от старых спанов к новым
+    std::string renderChromeTrace() const;
+    void clear();
+    Stats getStats() const;
+
+protected:
+    bool onInitialize() override;
+    void onShutdown() override;
+
+private:
+    Settings settings_;
+
+    static inline std::atomic<uint32_t> sample_every_{ 0 };
+    static inline std::atomic<uint64_t> next_trace_id_{ 1 };
+    static inline thread_local TraceContext current_{};
+};
+
+// Спан на область видимости в текущем контексте потока
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) : context_(TracingModule::current()) {
+        if (context_) {
+            name_ = name;
+            start_ = TracingModule::Clock::now();
+        }
+    }
+    ~TraceSpan() {
+        if (context_) {
+            TracingModule::recordSpan(context_, name_, start_, TracingModule::Clock::now());
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    TraceContext context_;
+    const char* name_ = nullptr;
+    TracingModule::Clock::time_point start_;
+};
+
+// Вызов f() внутри спана, результат f() возвращается как есть:
+// auto rows = traced("sql.clients", [&] { return txn.exec("SELECT ..."); });
+template<class F>
+decltype(auto) traced(const char* name, F&& f) {
+    TraceSpan span(name);
+    return std::forward<F>(f)();
+}
+
+// Установка контекста потока на область видимости (на чужом потоке или на время обработчика)
+class TraceContextScope {
+public:
+    explicit TraceContextScope(TraceContext context) : previous_(TracingModule::current()) {
+        TracingModule::setCurrent(context);
+    }
+    ~TraceContextScope() {
+        TracingModule::setCurrent(previous_);
+    }
+
+    TraceContextScope(const TraceContextScope&) = delete;
+    TraceContextScope& operator=(const TraceContextScope&) = delete;
+
+private:
+    TraceContext previous_;
+};
@@ -0,0 +1,62 @@
+﻿#pragma once
+
+// Сервер под нагрузкой для стендов (POSIX): fork/exec с выводом в лог-файл, SIGTERM при разрушении.
+// Общий для bench_http_load и bench_idle_connections
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+class BenchServerProcess {
+public:
+    // args[0] — путь к серверу
+    BenchServerProcess(std::vector<std::string> args, const std::filesystem::path& log_path) : log_path_(log_path) {
+        pid_ = ::fork();
+        if (pid_ < 0) throw std::runtime_error("fork failed");
+        if (pid_ == 0) {
+            // Вывод сервера — в файл, чтобы не смешивался с отчётом
+            std::FILE* log = std::freopen(log_path_.c_str(), "w", stdout);
+            if (log) ::dup2(::fileno(stdout), STDERR_FILENO);
+            std::vector<char*> argv;
+            for (auto& arg : args) argv.push_back(arg.data());
+            argv.push_back(nullptr);
+            ::execv(argv[0], argv.data());
+            std::_Exit(127);
+        }
+    }
+
+    ~BenchServerProcess() {
+        if (pid_ > 0) {
+            ::kill(pid_, SIGTERM);
+            int status = 0;
+            ::waitpid(pid_, &status, 0);
+        }
+        std::error_code ec;
+        std::filesystem::remove(log_path_, ec);
+    }
+
+    BenchServerProcess(const BenchServerProcess&) = delete;
+    BenchServerProcess& operator=(const BenchServerProcess&) = delete;
+
+    bool alive() const {
+        int status = 0;
+        return ::waitpid(pid_, &status, WNOHANG) == 0;
+    }
+
+    pid_t pid() const { return pid_; }
+    const std::filesystem::path& logPath() const { return log_path_; }
+
+private:
+    pid_t pid_ = -1;
+    std::filesystem::path log_path_;
+};
+#endif
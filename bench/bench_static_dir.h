@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// Временная static/ для микробенчмарков FileCache и маршрутизации:
+// страницы ошибок, small (2 КБ), large (256 КБ) и pages/p0..p<pages-1> по 8 КБ
+class BenchStaticDir {
+public:
+    explicit BenchStaticDir(int pages = 400) {
+        namespace fs = std::filesystem;
+        path_ = fs::temp_directory_path() / ("modular_server_microbench_" + std::to_string(
+            std::chrono::system_clock::now().time_since_epoch().count()));
+        fs::create_directories(path_ / "pages");
+        write("index.html", std::string(512, 'i'));
+        write("errorNotFound.html", std::string(1024, 'n'));
+        write("attention.html", std::string(1024, 'a'));
+        write("small.css", std::string(2 * 1024, 's'));
+        write("large.js", std::string(256 * 1024, 'l'));
+        for (int i = 0; i < pages; ++i) {
+            write("pages/p" + std::to_string(i) + ".html", std::string(8 * 1024, 'p'));
+        }
+    }
+
+    ~BenchStaticDir() {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+
+    BenchStaticDir(const BenchStaticDir&) = delete;
+    BenchStaticDir& operator=(const BenchStaticDir&) = delete;
+
+    const std::filesystem::path& path() const { return path_; }
+    std::string string() const { return path_.string(); }
+
+private:
+    void write(const std::string& name, const std::string& content) {
+        std::ofstream out(path_ / name, std::ios::binary);
+        out << content;
+    }
+
+    std::filesystem::path path_;
+};
@@ -0,0 +1,299 @@
+﻿// Стенд согласованности узлов: несколько процессов сервера на одной базе, как за балансировщиком.
+// Запись идёт через один узел, остальные должны увидеть её по NOTIFY (GET /api/version) за миллисекунды.
+//
+//   bench_coherence --server ./KursachMari-Tigrex-ServerBase --database "<conninfo>"
+//                   [--nodes 3] [--writes 200] [--port 18490] [--timeout-ms 2000]
+//
+// На каждую запись: базовая версия — наибольшая среди узлов, затем PUT /api/clients/{id} через узел
+// writes % nodes, затем опрос всех узлов, пока их версия не превысит базовую. Отчёт — задержка
+// применения отдельно для узла-писателя и для остальных (p50/p99/max), число таймаутов и совпадение
+// версий в конце. Код возврата ненулевой при таймаутах или расхождении.
+// Стенд создаёт одного клиента и удаляет его в конце — используйте одноразовую базу.
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include "bench_static_dir.h"
+#include "bench_server_process.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+
+namespace {
+
+    namespace net = boost::asio;
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+    using tcp = net::ip::tcp;
+    using Clock = std::chrono::steady_clock;
+
+    using Request = http::request<http::string_body>;
+    using Response = http::response<http::string_body>;
+
+    struct Options {
+        std::string server;
+        std::string database;
+        unsigned short port = 18490;
+        int nodes = 3;
+        int writes = 200;
+        int timeout_ms = 2000;
+    };
+
+    [[noreturn]] void usage(const char* error) {
+        if (error) std::cerr << "Error: " << error << "\n\n";
+        std::cerr <<
+            "Usage: bench_coherence --server <path> --database <conninfo> [options]\n"
+            "  --server PATH       server executable\n"
+            "  --database CONNINFO PostgreSQL connection string shared by all nodes\n"
+            "  --nodes N           server processes (default 3)\n"
+            "  --writes N          writes, round-robin over nodes (default 200)\n"
+            "  --port N            first node port, the rest follow (default 18490)\n"
+            "  --timeout-ms N      max time for a node to apply a write (default 2000)\n";
+        std::exit(error ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    Options parseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) usage(("missing value for " + arg).c_str());
+                return argv[++i];
+            };
+            if (arg == "--server") options.server = value();
+            else if (arg == "--database") options.database = value();
+            else if (arg == "--nodes") options.nodes = std::max(2, std::stoi(value()));
+            else if (arg == "--writes") options.writes = std::max(1, std::stoi(value()));
+            else if (arg == "--port") options.port = static_cast<unsigned short>(std::stoi(value()));
+            else if (arg == "--timeout-ms") options.timeout_ms = std::max(1, std::stoi(value()));
+            else if (arg == "--help" || arg == "-h") usage(nullptr);
+            else usage(("unknown option " + arg).c_str());
+        }
+        if (options.server.empty()) usage("--server is required");
+        if (options.database.empty()) usage("--database is required");
+        return options;
+    }
+
+    // Блокирующее keep-alive соединение с одним узлом
+    class Connection {
+    public:
+        explicit Connection(unsigned short port) : socket_(ioc_), endpoint_(net::ip::make_address("127.0.0.1"), port) {}
+
+        std::optional<Response> roundTrip(const Request& req) {
+            for (int attempt = 0; attempt < 2; ++attempt) {
+                beast::error_code ec;
+                if (!socket_.is_open()) {
+                    socket_.connect(endpoint_, ec);
+                    if (ec) {
+                        socket_.close(ec);
+                        return std::nullopt;
+                    }
+                    socket_.set_option(tcp::no_delay(true), ec);
+                }
+                http::write(socket_, req, ec);
+                if (!ec) {
+                    Response res;
+                    http::read(socket_, buffer_, res, ec);
+                    if (!ec) {
+                        if (res.need_eof()) reset();
+                        return res;
+                    }
+                }
+                reset();
+            }
+            return std::nullopt;
+        }
+
+    private:
+        void reset() {
+            beast::error_code ec;
+            socket_.close(ec);
+            buffer_.clear();
+        }
+
+        net::io_context ioc_;
+        tcp::socket socket_;
+        tcp::endpoint endpoint_;
+        beast::flat_buffer buffer_;
+    };
+
+    Request makeRequest(http::verb method, std::string target, std::string body = {}) {
+        Request req{ method, target, 11 };
+        req.set(http::field::host, "127.0.0.1");
+        req.set(http::field::user_agent, "bench_coherence");
+        req.keep_alive(true);
+        if (!body.empty()) {
+            req.set(http::field::content_type, "application/json");
+            req.body() = std::move(body);
+        }
+        req.prepare_payload();
+        return req;
+    }
+
+    // Достаточно для ответов сервера: {"id":42,...}, {"version":17,...}
+    std::optional<uint64_t> extractNumber(const std::string& json, const std::string& key) {
+        auto pos = json.find("\"" + key + "\":");
+        if (pos == std::string::npos) return std::nullopt;
+        pos += key.size() + 3;
+        while (pos < json.size() && json[pos] == ' ') ++pos;
+        uint64_t value = 0;
+        bool any = false;
+        while (pos < json.size() && json[pos] >= '0' && json[pos] <= '9') {
+            value = value * 10 + static_cast<uint64_t>(json[pos++] - '0');
+            any = true;
+        }
+        return any ? std::make_optional(value) : std::nullopt;
+    }
+
+    struct Node {
+        explicit Node(unsigned short node_port) : port(node_port), conn(node_port) {}
+
+        std::optional<uint64_t> version() {
+            auto res = conn.roundTrip(makeRequest(http::verb::get, "/api/version"));
+            if (!res || res->result() != http::status::ok) return std::nullopt;
+            return extractNumber(res->body(), "version");
+        }
+
+        bool connected() {
+            auto res = conn.roundTrip(makeRequest(http::verb::get, "/api/version"));
+            return res && res->result() == http::status::ok && res->body().find("\"connected\":true") != std::string::npos;
+        }
+
+        unsigned short port;
+        Connection conn;
+        std::unique_ptr<BenchServerProcess> process;
+    };
+
+    double percentile(std::vector<uint64_t>& sorted, double q) {
+        if (sorted.empty()) return 0;
+        size_t index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1));
+        return static_cast<double>(sorted[index]) / 1000.0;
+    }
+
+    void printRow(const char* name, std::vector<uint64_t>& samples) {
+        std::sort(samples.begin(), samples.end());
+        std::printf("%-10s %8zu %10.3f %10.3f %10.3f\n", name, samples.size(),
+            percentile(samples, 0.50), percentile(samples, 0.99), samples.empty() ? 0.0 : static_cast<double>(samples.back()) / 1000.0);
+    }
+
+}
+#endif
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    std::cerr << "bench_coherence: starting server processes is implemented for POSIX only" << std::endl;
+    return EXIT_FAILURE;
+#else
+    Options options = parseOptions(argc, argv);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    BenchStaticDir static_dir(0);
+    std::vector<std::unique_ptr<Node>> nodes;
+    for (int i = 0; i < options.nodes; ++i) {
+        auto node = std::make_unique<Node>(static_cast<unsigned short>(options.port + i));
+        node->process = std::make_unique<BenchServerProcess>(std::vector<std::string>{
+            options.server,
+            "--address", "127.0.0.1",
+            "--port", std::to_string(node->port),
+            "--directory", static_dir.string(),
+            "--database", options.database,
+            "--rate-limit", "1e9",
+            "--rate-burst", "1e9",
+            "--max-connections-per-ip", "0",
+            }, static_dir.string() + "_node" + std::to_string(i) + ".log");
+        nodes.push_back(std::move(node));
+    }
+
+    // Узел готов, когда отвечает и его ChangeFeed слушает канал
+    for (auto& node : nodes) {
+        bool ready = false;
+        for (int attempt = 0; attempt < 200 && !ready; ++attempt) {
+            ready = node->connected();
+            if (!ready) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        if (!ready || !node->process->alive()) {
+            std::cerr << "Node on port " << node->port << " did not become ready, see " << node->process->logPath() << std::endl;
+            std::ifstream log(node->process->logPath());
+            std::cerr << log.rdbuf() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto created = nodes[0]->conn.roundTrip(makeRequest(http::verb::post, "/api/clients",
+        R"({"name":"Coherence client","contact":"bench@example.com","status":"active"})"));
+    auto client_id = created && created->result() == http::status::created ? extractNumber(created->body(), "id") : std::nullopt;
+    if (!client_id) {
+        std::cerr << "Creating the test client failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::string client_path = "/api/clients/" + std::to_string(*client_id);
+
+    std::vector<uint64_t> writer_ns, remote_ns;
+    int timeouts = 0, failed_writes = 0;
+    const auto timeout = std::chrono::milliseconds(options.timeout_ms);
+
+    for (int w = 0; w < options.writes; ++w) {
+        uint64_t baseline = 0;
+        for (auto& node : nodes) baseline = std::max(baseline, node->version().value_or(0));
+
+        size_t writer = static_cast<size_t>(w) % nodes.size();
+        auto res = nodes[writer]->conn.roundTrip(makeRequest(http::verb::put, client_path,
+            R"({"name":"Coherence client )" + std::to_string(w) + R"("})"));
+        auto written = Clock::now();
+        if (!res || res->result() != http::status::ok) {
+            ++failed_writes;
+            continue;
+        }
+
+        // Опрос по кругу: каждый узел снимается с опроса, как только его версия превысила базовую
+        std::vector<bool> seen(nodes.size(), false);
+        size_t remaining = nodes.size();
+        while (remaining > 0) {
+            auto now = Clock::now();
+            if (now - written > timeout) {
+                timeouts += static_cast<int>(remaining);
+                break;
+            }
+            for (size_t n = 0; n < nodes.size(); ++n) {
+                if (seen[n]) continue;
+                if (nodes[n]->version().value_or(0) <= baseline) continue;
+                seen[n] = true;
+                --remaining;
+                auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - written).count());
+                (n == writer ? writer_ns : remote_ns).push_back(ns);
+            }
+        }
+    }
+
+    nodes[0]->conn.roundTrip(makeRequest(http::verb::delete_, client_path));
+
+    // После последней записи (и удаления) версии всех узлов должны сойтись
+    std::this_thread::sleep_for(timeout);
+    std::vector<uint64_t> finals;
+    for (auto& node : nodes) finals.push_back(node->version().value_or(0));
+    bool converged = std::all_of(finals.begin(), finals.end(), [&](uint64_t v) { return v == finals.front() && v > 0; });
+
+    std::printf("%d nodes, %d writes via PUT %s\n\n", options.nodes, options.writes, client_path.c_str());
+    std::printf("%-10s %8s %10s %10s %10s\n", "apply", "samples", "p50 ms", "p99 ms", "max ms");
+    printRow("writer", writer_ns);
+    printRow("remote", remote_ns);
+    std::printf("\nfailed writes: %d, timeouts: %d, final versions:", failed_writes, timeouts);
+    for (uint64_t v : finals) std::printf(" %llu", static_cast<unsigned long long>(v));
+    std::printf(" (%s)\n", converged ? "converged" : "DIVERGED");
+
+    return failed_writes == 0 && timeouts == 0 && converged ? EXIT_SUCCESS : EXIT_FAILURE;
+#endif
+}
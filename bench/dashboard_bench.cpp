@@ -0,0 +1,148 @@
+﻿// Агрегаты дашборда /api/all-data: столбцы DashboardColumns против обхода записей и против SQL.
+// SQL-вариант регистрируется, только если задана MODULAR_SERVER_BENCH_DATABASE: данные кладутся во временные
+// таблицы сессии (pg_temp), постоянные таблицы базы не трогаются
+#include "DashboardColumns.h"
+#include "Entities.h"
+
+#include <benchmark/benchmark.h>
+#include <pqxx/pqxx>
+
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace {
+
+    const char* const kStatuses[] = { "planning", "running", "completed", "paused" };
+
+    Entities::Campaign makeCampaign(int id) {
+        Entities::Campaign c;
+        c.id = id;
+        c.client_id = id / 3 + 1;
+        c.status = kStatuses[id % 4];
+        c.budget = 15000.0 + id % 1000;
+        c.spent = 7250.25;
+        if (id % 3) c.roi = 12.5;
+        return c;
+    }
+
+    Entities::TeamMember makeMember(int id) {
+        Entities::TeamMember m;
+        m.id = id;
+        m.fullname = "Member";
+        m.role = "manager";
+        m.workload = 40.0 + id % 60;
+        return m;
+    }
+
+    constexpr int kTeamSize = 200;
+
+    DashboardColumns makeColumns(int campaigns) {
+        DashboardColumns columns;
+        for (int i = 1; i <= campaigns; ++i) columns.upsert(makeCampaign(i));
+        for (int i = 1; i <= kTeamSize; ++i) columns.upsert(makeMember(i));
+        return columns;
+    }
+
+    // Полный проход по столбцам: так считается дашборд после загрузки реплики
+    void BM_DashboardColumnsScan(benchmark::State& state) {
+        DashboardColumns columns = makeColumns(static_cast<int>(state.range(0)));
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(columns.scan());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_DashboardColumnsScan)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+    // Обычный случай: между двумя /api/all-data изменилась одна кампания — пересчитывается один блок
+    void BM_DashboardColumnsAfterWrite(benchmark::State& state) {
+        const int count = static_cast<int>(state.range(0));
+        DashboardColumns columns = makeColumns(count);
+        columns.totals();
+        int id = 1;
+        for (auto _ : state) {
+            Entities::Campaign c = makeCampaign(id);
+            c.budget += 1.0;
+            columns.upsert(c);
+            benchmark::DoNotOptimize(columns.totals());
+            id = id % count + 1;
+        }
+    }
+    BENCHMARK(BM_DashboardColumnsAfterWrite)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+    // Прежняя схема в памяти: обход std::map записей со сравнением строк статуса
+    void BM_DashboardRowWise(benchmark::State& state) {
+        std::map<int, Entities::Campaign> campaigns;
+        for (int i = 1; i <= state.range(0); ++i) campaigns.emplace(i, makeCampaign(i));
+        std::map<int, Entities::TeamMember> team;
+        for (int i = 1; i <= kTeamSize; ++i) team.emplace(i, makeMember(i));
+
+        for (auto _ : state) {
+            int64_t running = 0, budget = 0, spent = 0, roi = 0, roi_count = 0, workload = 0, workload_count = 0;
+            for (const auto& [id, c] : campaigns) {
+                if (c.status == "running") {
+                    ++running;
+                    budget += std::llround(c.budget * 100.0);
+                    spent += std::llround(c.spent * 100.0);
+                }
+                else if (c.status == "completed" && c.roi) {
+                    roi += std::llround(*c.roi * 100.0);
+                    ++roi_count;
+                }
+            }
+            for (const auto& [id, m] : team) {
+                if (m.workload) {
+                    workload += std::llround(*m.workload * 100.0);
+                    ++workload_count;
+                }
+            }
+            benchmark::DoNotOptimize(running + budget + spent + roi + roi_count + workload + workload_count);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_DashboardRowWise)->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+    // Те же запросы, что ApiProcessor::handleGetAllData, по временным таблицам с тем же числом строк
+    void BM_DashboardSql(benchmark::State& state, std::string conn_str) {
+        pqxx::connection conn(conn_str);
+        {
+            pqxx::work txn(conn);
+            txn.exec("CREATE TEMP TABLE campaigns (id SERIAL PRIMARY KEY, status TEXT NOT NULL, "
+                "budget NUMERIC(15,2) NOT NULL, spent NUMERIC(15,2), roi NUMERIC(6,2))");
+            txn.exec("CREATE TEMP TABLE team (id SERIAL PRIMARY KEY, workload NUMERIC(5,2))");
+            txn.exec_params("INSERT INTO campaigns (status, budget, spent, roi) "
+                "SELECT (ARRAY['planning','running','completed','paused'])[i % 4 + 1], 15000 + i % 1000, 7250.25, "
+                "CASE WHEN i % 3 <> 0 THEN 12.5 END FROM generate_series(1, $1) AS i", static_cast<int>(state.range(0)));
+            txn.exec_params("INSERT INTO team (workload) SELECT 40 + i % 60 FROM generate_series(1, $1) AS i", kTeamSize);
+            txn.commit();
+        }
+        {
+            pqxx::nontransaction txn(conn);
+            txn.exec("ANALYZE pg_temp.campaigns");
+            txn.exec("ANALYZE pg_temp.team");
+        }
+
+        for (auto _ : state) {
+            pqxx::work txn(conn);
+            auto agg = txn.exec("SELECT COUNT(*), COALESCE(SUM(budget), 0), COALESCE(SUM(spent), 0) "
+                "FROM pg_temp.campaigns WHERE status = 'running'");
+            auto roi = txn.exec("SELECT AVG(roi) FROM pg_temp.campaigns WHERE status = 'completed' AND roi IS NOT NULL");
+            auto workload = txn.exec("SELECT AVG(workload) FROM pg_temp.team");
+            benchmark::DoNotOptimize(agg[0][1].as<double>() + roi[0][0].as<double>() + workload[0][0].as<double>());
+            txn.commit();
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    // Регистрация при старте: без базы SQL-варианта просто нет в списке
+    const bool kSqlRegistered = [] {
+        const char* conn_str = std::getenv("MODULAR_SERVER_BENCH_DATABASE");
+        if (!conn_str || !*conn_str) return false;
+        benchmark::RegisterBenchmark("BM_DashboardSql", BM_DashboardSql, std::string(conn_str))
+            ->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+        return true;
+        }();
+
+}
@@ -0,0 +1,138 @@
+﻿// Микробенчмарк rate limiter'а: шардированный token bucket против прежней схемы
+// (один std::mutex + unordered_map по строке IP).
+#include "DoSProtectionModule.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    namespace ip = boost::asio::ip;
+
+    // Прежний алгоритм isAllowed — для сравнения
+    class LegacyLimiter {
+        struct ClientInfo {
+            int request_count = 0;
+            std::chrono::steady_clock::time_point last_request;
+            std::chrono::steady_clock::time_point ban_until;
+        };
+        std::unordered_map<std::string, ClientInfo> clients_;
+        std::mutex mutex_;
+
+    public:
+        bool isAllowed(const std::string& ip) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = std::chrono::steady_clock::now();
+            auto& info = clients_[ip];
+            if (now < info.ban_until) return false;
+            if (now - info.last_request > std::chrono::minutes(1)) info.request_count = 1;
+            else ++info.request_count;
+            info.last_request = now;
+            if (info.request_count > 100) {
+                info.ban_until = now + std::chrono::minutes(5);
+                return false;
+            }
+            return true;
+        }
+    };
+
+    std::vector<ip::address> makeAddresses(size_t count, bool v6) {
+        std::vector<ip::address> result;
+        result.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            if (v6) {
+                ip::address_v6::bytes_type bytes{};
+                bytes[0] = 0x20; bytes[1] = 0x01;
+                bytes[12] = static_cast<unsigned char>(i >> 24);
+                bytes[13] = static_cast<unsigned char>(i >> 16);
+                bytes[14] = static_cast<unsigned char>(i >> 8);
+                bytes[15] = static_cast<unsigned char>(i);
+                result.emplace_back(ip::address_v6(bytes));
+            }
+            else {
+                result.emplace_back(ip::address_v4(static_cast<uint32_t>(0x0A000000u + i)));
+            }
+        }
+        return result;
+    }
+
+    // Лимиты заведомо не срабатывают: меряем стоимость самой проверки
+    DoSProtectionModule::Settings unlimitedSettings() {
+        DoSProtectionModule::Settings settings;
+        settings.capacity = 1e12;
+        settings.refill_per_second = 1e12;
+        return settings;
+    }
+
+    DoSProtectionModule& sharedLimiter() {
+        static DoSProtectionModule limiter(unlimitedSettings());
+        return limiter;
+    }
+
+    LegacyLimiter& sharedLegacy() {
+        static LegacyLimiter limiter;
+        return limiter;
+    }
+
+}
+
+static void BM_TokenBucket_SameClient(benchmark::State& state) {
+    DoSProtectionModule limiter(unlimitedSettings());
+    auto address = ip::make_address("192.168.1.10");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(limiter.isAllowed(address));
+    }
+}
+BENCHMARK(BM_TokenBucket_SameClient);
+
+static void BM_TokenBucket_ManyClients(benchmark::State& state) {
+    DoSProtectionModule limiter(unlimitedSettings());
+    auto addresses = makeAddresses(static_cast<size_t>(state.range(0)), state.range(1) != 0);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(limiter.isAllowed(addresses[i], 2.0));
+        if (++i == addresses.size()) i = 0;
+    }
+}
+BENCHMARK(BM_TokenBucket_ManyClients)->Args({ 1024, 0 })->Args({ 100000, 0 })->Args({ 100000, 1 });
+
+static void BM_TokenBucket_RouteCost(benchmark::State& state) {
+    DoSProtectionModule limiter;
+    limiter.setRouteCost("/api/", 2.0);
+    limiter.setRouteCost("/api/all-data", 10.0);
+    limiter.setRouteCost("/static/", 0.5);
+    std::string_view path = "/api/clients/42";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(limiter.routeCost(path));
+    }
+}
+BENCHMARK(BM_TokenBucket_RouteCost);
+
+// Каждый поток — свои клиенты, общий limiter: показывает конкуренцию за блокировки
+static void BM_TokenBucket_Contended(benchmark::State& state) {
+    auto& limiter = sharedLimiter();
+    auto addresses = makeAddresses(4096, false);
+    size_t i = static_cast<size_t>(state.thread_index()) * 512;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(limiter.isAllowed(addresses[i % addresses.size()]));
+        ++i;
+    }
+}
+BENCHMARK(BM_TokenBucket_Contended)->ThreadRange(1, 16)->UseRealTime();
+
+static void BM_Legacy_Contended(benchmark::State& state) {
+    auto& limiter = sharedLegacy();
+    auto addresses = makeAddresses(4096, false);
+    size_t i = static_cast<size_t>(state.thread_index()) * 512;
+    for (auto _ : state) {
+        // Как в старом main: адрес -> строка -> map
+        benchmark::DoNotOptimize(limiter.isAllowed(addresses[i % addresses.size()].to_string()));
+        ++i;
+    }
+}
+BENCHMARK(BM_Legacy_Contended)->ThreadRange(1, 16)->UseRealTime();
@@ -0,0 +1,100 @@
+﻿// Микробенчмарк FileCache: get_file (попадание, промах, вытеснение), refresh_file и normalize_route
+#include "FileCache.h"
+#include "bench_static_dir.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+    struct Fixture {
+        BenchStaticDir static_dir;
+        FileCache cache{ static_dir.string(), true, 100 };
+
+        Fixture() {
+            cache.initialize();
+        }
+    };
+
+    Fixture& fixture() {
+        static Fixture instance;
+        return instance;
+    }
+
+}
+
+static void BM_GetFile_HitSmall(benchmark::State& state) {
+    auto& cache = fixture().cache;
+    cache.get_file("/small");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.get_file("/small"));
+    }
+}
+BENCHMARK(BM_GetFile_HitSmall);
+
+// get_file возвращает копию CachedFile: стоимость растёт с размером файла
+static void BM_GetFile_HitLarge(benchmark::State& state) {
+    auto& cache = fixture().cache;
+    cache.get_file("/large");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.get_file("/large"));
+    }
+}
+BENCHMARK(BM_GetFile_HitLarge);
+
+// Маршрута нет в карте — так проходит каждый API-запрос при зарегистрированном /*
+static void BM_GetFile_MissUnknown(benchmark::State& state) {
+    auto& cache = fixture().cache;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.get_file("/api/clients/42"));
+    }
+}
+BENCHMARK(BM_GetFile_MissUnknown);
+
+// Обход 400 страниц при ёмкости 100: каждый вызов читает файл с диска и вытесняет запись
+static void BM_GetFile_MissEvicted(benchmark::State& state) {
+    auto& cache = fixture().cache;
+    std::vector<std::string> routes;
+    for (int i = 0; i < 400; ++i) routes.push_back("/pages/p" + std::to_string(i));
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.get_file(routes[i]));
+        if (++i == routes.size()) i = 0;
+    }
+}
+BENCHMARK(BM_GetFile_MissEvicted);
+
+// RequestHandler вызывает refresh_file перед каждым get_file
+static void BM_RefreshFile_Cached(benchmark::State& state) {
+    auto& cache = fixture().cache;
+    cache.get_file("/small");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.refresh_file("/small"));
+    }
+}
+BENCHMARK(BM_RefreshFile_Cached);
+
+static void BM_RefreshFile_Unknown(benchmark::State& state) {
+    auto& cache = fixture().cache;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(cache.refresh_file("/api/clients/42"));
+    }
+}
+BENCHMARK(BM_RefreshFile_Unknown);
+
+static void BM_NormalizeRoute(benchmark::State& state) {
+    auto& f = fixture();
+    std::vector<std::filesystem::path> paths = {
+        f.static_dir.path() / "index.html",
+        f.static_dir.path() / "small.css",
+        f.static_dir.path() / "pages" / "p42.html",
+    };
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(f.cache.normalize_route(paths[i]));
+        if (++i == paths.size()) i = 0;
+    }
+}
+BENCHMARK(BM_NormalizeRoute);
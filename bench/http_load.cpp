@@ -0,0 +1,574 @@
+﻿// Нагрузочный стенд: поднимает сервер на временной static/ и гоняет сценарии по keep-alive соединениям.
+// На каждый сценарий — пропускная способность и перцентили задержки (p50/p99/p999).
+//
+//   bench_http_load --server ./KursachMari-Tigrex-ServerBase [--database "<conninfo>"]
+//                   [--connections 8] [--duration 5] [--sizes 100,1000,5000] [--only static_hit,api_all_data]
+//
+// Без --database (или если БД недоступна) API-сценарии пропускаются.
+// С базой стенд сам наполняет таблицы через POST и удаляет созданных клиентов в конце —
+// используйте отдельную, одноразовую базу.
+#include <boost/asio/connect.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include "bench_server_process.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+    namespace net = boost::asio;
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+    namespace fs = std::filesystem;
+    using tcp = net::ip::tcp;
+    using Clock = std::chrono::steady_clock;
+
+    using Request = http::request<http::string_body>;
+    using Response = http::response<http::string_body>;
+
+    struct Options {
+        std::string server;
+        std::string database;
+        std::string only;
+        unsigned short port = 18480;
+        int connections = 8;
+        double duration = 5.0;
+        double warmup = 1.0;
+        std::vector<int> sizes{ 100, 1000, 5000 };
+    };
+
+    [[noreturn]] void usage(const char* error) {
+        if (error) std::cerr << "Error: " << error << "\n\n";
+        std::cerr <<
+            "Usage: bench_http_load --server <path> [options]\n"
+            "  --server PATH       server executable\n"
+            "  --database CONNINFO PostgreSQL connection string (API scenarios are skipped without it)\n"
+            "  --port N            port for the server under test (default 18480)\n"
+            "  --connections N     concurrent keep-alive connections (default 8)\n"
+            "  --duration SEC      measured time per scenario (default 5)\n"
+            "  --warmup SEC        unmeasured time per scenario (default 1)\n"
+            "  --sizes A,B,C       client counts for /api/all-data (default 100,1000,5000)\n"
+            "  --only A,B          run only scenarios whose name starts with one of these prefixes\n";
+        std::exit(error ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    Options parseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) usage(("missing value for " + arg).c_str());
+                return argv[++i];
+            };
+            if (arg == "--server") options.server = value();
+            else if (arg == "--database") options.database = value();
+            else if (arg == "--port") options.port = static_cast<unsigned short>(std::stoi(value()));
+            else if (arg == "--connections") options.connections = std::max(1, std::stoi(value()));
+            else if (arg == "--duration") options.duration = std::stod(value());
+            else if (arg == "--warmup") options.warmup = std::stod(value());
+            else if (arg == "--only") options.only = value();
+            else if (arg == "--sizes") {
+                options.sizes.clear();
+                std::stringstream list(value());
+                for (std::string item; std::getline(list, item, ',');) {
+                    if (!item.empty()) options.sizes.push_back(std::stoi(item));
+                }
+                std::sort(options.sizes.begin(), options.sizes.end());
+            }
+            else if (arg == "--help" || arg == "-h") usage(nullptr);
+            else usage(("unknown option " + arg).c_str());
+        }
+        if (options.server.empty()) usage("--server is required");
+        return options;
+    }
+
+    // ------------------- Окружение сервера -------------------
+
+    // Временная static/: страницы ошибок, два файла разного размера и набор страниц,
+    // которых больше, чем вмещает FileCache (100 записей), — для сценария промахов
+    class TempStaticDir {
+    public:
+        static constexpr int kMissPages = 400;
+
+        TempStaticDir() {
+            path_ = fs::temp_directory_path() / ("modular_server_bench_" + std::to_string(
+                std::chrono::system_clock::now().time_since_epoch().count()));
+            fs::create_directories(path_ / "pages");
+            write("index.html", page("index", 512));
+            write("errorNotFound.html", page("Not Found", 1024));
+            write("attention.html", page("Attention", 1024));
+            write("small.css", std::string(2 * 1024, 'a'));
+            write("large.js", std::string(256 * 1024, 'b'));
+            for (int i = 0; i < kMissPages; ++i) {
+                write("pages/p" + std::to_string(i) + ".html", page("page " + std::to_string(i), 8 * 1024));
+            }
+        }
+
+        ~TempStaticDir() {
+            std::error_code ec;
+            fs::remove_all(path_, ec);
+        }
+
+        const fs::path& path() const { return path_; }
+
+    private:
+        static std::string page(const std::string& title, size_t size) {
+            std::string html = "<!DOCTYPE html><html><head><title>" + title + "</title></head><body>";
+            html.resize(std::max(size, html.size() + 16), 'x');
+            return html + "</body></html>";
+        }
+
+        void write(const std::string& name, const std::string& content) {
+            std::ofstream out(path_ / name, std::ios::binary);
+            out << content;
+        }
+
+        fs::path path_;
+    };
+
+#ifndef _WIN32
+    class ServerProcess : public BenchServerProcess {
+    public:
+        ServerProcess(const Options& options, const fs::path& static_dir)
+            : BenchServerProcess(arguments(options, static_dir), static_dir.parent_path() / (static_dir.filename().string() + ".log")) {
+        }
+
+    private:
+        static std::vector<std::string> arguments(const Options& options, const fs::path& static_dir) {
+            std::vector<std::string> args = {
+                options.server,
+                "--address", "127.0.0.1",
+                "--port", std::to_string(options.port),
+                "--directory", static_dir.string(),
+                // Лимитер и лимиты соединений не должны участвовать в замерах
+                "--rate-limit", "1e9",
+                "--rate-burst", "1e9",
+                "--max-connections-per-ip", "0",
+            };
+            if (!options.database.empty()) {
+                args.push_back("--database");
+                args.push_back(options.database);
+            }
+            return args;
+        }
+    };
+#endif
+
+    // ------------------- HTTP-клиент -------------------
+
+    // Блокирующее keep-alive соединение; переподключается, если сервер закрыл сокет
+    class Connection {
+    public:
+        explicit Connection(unsigned short port) : socket_(ioc_), endpoint_(net::ip::make_address("127.0.0.1"), port) {}
+
+        std::optional<Response> roundTrip(const Request& req) {
+            for (int attempt = 0; attempt < 2; ++attempt) {
+                beast::error_code ec;
+                if (!socket_.is_open()) {
+                    socket_.connect(endpoint_, ec);
+                    if (ec) {
+                        socket_.close(ec);
+                        return std::nullopt;
+                    }
+                    socket_.set_option(tcp::no_delay(true), ec);
+                }
+                http::write(socket_, req, ec);
+                if (!ec) {
+                    Response res;
+                    http::read(socket_, buffer_, res, ec);
+                    if (!ec) {
+                        if (res.need_eof()) reset();
+                        return res;
+                    }
+                }
+                reset();  // Сервер закрыл соединение между запросами — повторяем на новом
+            }
+            return std::nullopt;
+        }
+
+    private:
+        void reset() {
+            beast::error_code ec;
+            socket_.close(ec);
+            buffer_.clear();
+        }
+
+        net::io_context ioc_;
+        tcp::socket socket_;
+        tcp::endpoint endpoint_;
+        beast::flat_buffer buffer_;
+    };
+
+    Request makeRequest(http::verb method, std::string target, std::string body = {}) {
+        Request req{ method, target, 11 };
+        req.set(http::field::host, "127.0.0.1");
+        req.set(http::field::user_agent, "bench_http_load");
+        req.keep_alive(true);
+        if (!body.empty()) {
+            req.set(http::field::content_type, "application/json");
+            req.body() = std::move(body);
+        }
+        req.prepare_payload();
+        return req;
+    }
+
+    // Достаточно для ответов ApiProcessor: {"id":42,...}
+    std::optional<int> extractId(const std::string& json) {
+        auto pos = json.find("\"id\":");
+        if (pos == std::string::npos) return std::nullopt;
+        pos += 5;
+        while (pos < json.size() && json[pos] == ' ') ++pos;
+        int value = 0;
+        bool any = false;
+        while (pos < json.size() && json[pos] >= '0' && json[pos] <= '9') {
+            value = value * 10 + (json[pos++] - '0');
+            any = true;
+        }
+        return any ? std::make_optional(value) : std::nullopt;
+    }
+
+    bool waitUntilReady(unsigned short port, std::chrono::seconds timeout) {
+        auto deadline = Clock::now() + timeout;
+        while (Clock::now() < deadline) {
+            Connection conn(port);
+            auto res = conn.roundTrip(makeRequest(http::verb::get, "/status"));
+            if (res && res->result() == http::status::ok) return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        return false;
+    }
+
+    // ------------------- Сценарии -------------------
+
+    // Состояние одного соединения: генератор случайных чисел и кампании, созданные этим соединением
+    struct WorkerState {
+        std::mt19937 rng;
+        uint64_t iteration = 0;
+        std::vector<int> created_campaigns;
+    };
+
+    struct Scenario {
+        std::string name;
+        std::function<Request(WorkerState&)> next;
+        std::function<bool(WorkerState&, const Response&)> accept;  // Ответ ожидаемый?
+    };
+
+    bool isStatus(const Response& res, http::status status) {
+        return res.result() == status;
+    }
+
+    struct Result {
+        std::string name;
+        uint64_t requests = 0;
+        uint64_t errors = 0;
+        double seconds = 0;
+        double p50_us = 0, p99_us = 0, p999_us = 0, max_us = 0;
+    };
+
+    double percentile(std::vector<uint64_t>& sorted, double q) {
+        if (sorted.empty()) return 0;
+        size_t index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1));
+        return static_cast<double>(sorted[index]) / 1000.0;
+    }
+
+    // Замкнутый цикл: каждое соединение шлёт следующий запрос сразу после ответа.
+    // Прогрев идёт тем же циклом, но в статистику не попадает
+    Result runScenario(const Options& options, const Scenario& scenario) {
+        std::atomic<bool> measuring{ false };
+        std::atomic<bool> stop{ false };
+        std::vector<std::vector<uint64_t>> latencies(options.connections);
+        std::vector<uint64_t> errors(options.connections, 0);
+
+        std::vector<std::thread> workers;
+        for (int w = 0; w < options.connections; ++w) {
+            workers.emplace_back([&, w] {
+                Connection conn(options.port);
+                WorkerState state;
+                state.rng.seed(static_cast<unsigned>(w * 7919 + 17));
+                auto& samples = latencies[w];
+                samples.reserve(1 << 16);
+                while (!stop.load(std::memory_order_relaxed)) {
+                    Request req = scenario.next(state);
+                    auto start = Clock::now();
+                    auto res = conn.roundTrip(req);
+                    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+                    ++state.iteration;
+                    bool ok = res && scenario.accept(state, *res);
+                    if (!measuring.load(std::memory_order_relaxed)) continue;
+                    samples.push_back(static_cast<uint64_t>(elapsed));
+                    if (!ok) ++errors[w];
+                    if (!res) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                });
+        }
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.warmup));
+        measuring.store(true);
+        auto started = Clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(options.duration));
+        measuring.store(false);
+        auto finished = Clock::now();
+        stop.store(true);
+        for (auto& worker : workers) worker.join();
+
+        std::vector<uint64_t> all;
+        Result result;
+        result.name = scenario.name;
+        for (int w = 0; w < options.connections; ++w) {
+            all.insert(all.end(), latencies[w].begin(), latencies[w].end());
+            result.errors += errors[w];
+        }
+        std::sort(all.begin(), all.end());
+        result.requests = all.size();
+        result.seconds = std::chrono::duration<double>(finished - started).count();
+        result.p50_us = percentile(all, 0.50);
+        result.p99_us = percentile(all, 0.99);
+        result.p999_us = percentile(all, 0.999);
+        result.max_us = all.empty() ? 0 : static_cast<double>(all.back()) / 1000.0;
+        return result;
+    }
+
+    void printHeader(const Options& options) {
+        std::printf("\nconnections=%d duration=%.1fs warmup=%.1fs\n\n", options.connections, options.duration, options.warmup);
+        std::printf("%-26s %10s %8s %12s %10s %10s %10s %10s\n",
+            "scenario", "requests", "errors", "req/s", "p50(us)", "p99(us)", "p999(us)", "max(us)");
+    }
+
+    void printResult(const Result& r) {
+        std::printf("%-26s %10llu %8llu %12.1f %10.1f %10.1f %10.1f %10.1f\n",
+            r.name.c_str(), static_cast<unsigned long long>(r.requests), static_cast<unsigned long long>(r.errors),
+            r.seconds > 0 ? static_cast<double>(r.requests) / r.seconds : 0.0,
+            r.p50_us, r.p99_us, r.p999_us, r.max_us);
+        std::fflush(stdout);
+    }
+
+    bool selected(const Options& options, const std::string& name) {
+        if (options.only.empty()) return true;
+        std::stringstream list(options.only);
+        for (std::string prefix; std::getline(list, prefix, ',');) {
+            if (!prefix.empty() && name.rfind(prefix, 0) == 0) return true;
+        }
+        return false;
+    }
+
+    // ------------------- Данные для API -------------------
+
+    // Наполнение через публичный API: клиент + кампания + задача на каждого клиента.
+    // Идёт в несколько соединений, id созданных клиентов запоминаются для очистки
+    class Dataset {
+    public:
+        explicit Dataset(const Options& options) : options_(options) {}
+
+        ~Dataset() { cleanup(); }
+
+        bool available() {
+            Connection conn(options_.port);
+            auto res = conn.roundTrip(makeRequest(http::verb::get, "/api/all-data"));
+            return res && res->result() == http::status::ok;
+        }
+
+        // Доводит число созданных клиентов до target
+        bool growTo(size_t target) {
+            const size_t base = clients_.size();
+            size_t missing = target > base ? target - base : 0;
+            if (missing == 0) return true;
+
+            std::atomic<size_t> next{ 0 };
+            std::atomic<bool> failed{ false };
+            std::vector<std::thread> workers;
+            for (int w = 0; w < options_.connections; ++w) {
+                workers.emplace_back([&] {
+                    Connection conn(options_.port);
+                    for (size_t i = next++; i < missing && !failed; i = next++) {
+                        if (!seedOne(conn, base + i)) failed = true;
+                    }
+                    });
+            }
+            for (auto& worker : workers) worker.join();
+            return !failed;
+        }
+
+        const std::vector<int>& clients() const { return clients_; }
+
+        int randomClient(std::mt19937& rng) const {
+            std::uniform_int_distribution<size_t> pick(0, clients_.size() - 1);
+            return clients_[pick(rng)];
+        }
+
+        void cleanup() {
+            if (clients_.empty()) return;
+            Connection conn(options_.port);
+            for (int id : clients_) {
+                // ON DELETE CASCADE убирает кампании и задачи клиента
+                conn.roundTrip(makeRequest(http::verb::delete_, "/api/clients/" + std::to_string(id)));
+            }
+            clients_.clear();
+        }
+
+    private:
+        bool seedOne(Connection& conn, size_t n) {
+            auto client = conn.roundTrip(makeRequest(http::verb::post, "/api/clients",
+                R"({"name":"Bench client )" + std::to_string(n) + R"(","contact":"bench@example.com","status":"active"})"));
+            auto client_id = client && client->result() == http::status::created ? extractId(client->body()) : std::nullopt;
+            if (!client_id) return false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                clients_.push_back(*client_id);
+            }
+
+            auto campaign = conn.roundTrip(makeRequest(http::verb::post, "/api/campaigns",
+                R"({"clientId":)" + std::to_string(*client_id) + R"(,"name":"Bench campaign","status":"running","budget":15000.5})"));
+            auto campaign_id = campaign && campaign->result() == http::status::created ? extractId(campaign->body()) : std::nullopt;
+            if (!campaign_id) return false;
+
+            auto task = conn.roundTrip(makeRequest(http::verb::post, "/api/tasks",
+                R"({"campaignId":)" + std::to_string(*campaign_id) + R"(,"title":"Bench task","status":"todo"})"));
+            return task && task->result() == http::status::created;
+        }
+
+        const Options& options_;
+        std::mutex mutex_;
+        std::vector<int> clients_;
+    };
+
+    Scenario staticScenario(std::string name, std::vector<std::string> targets) {
+        return {
+            std::move(name),
+            [targets = std::move(targets)](WorkerState& state) {
+                return makeRequest(http::verb::get, targets[state.iteration % targets.size()]);
+            },
+            [](WorkerState&, const Response& res) { return isStatus(res, http::status::ok); }
+        };
+    }
+
+    std::vector<Scenario> staticScenarios() {
+        std::vector<Scenario> scenarios;
+        scenarios.push_back(staticScenario("static_hit_small", { "/small" }));
+        scenarios.push_back(staticScenario("static_hit_large", { "/large" }));
+
+        // Обход по кругу страниц больше ёмкости кэша: LRU каждый раз вытесняет нужную
+        std::vector<std::string> pages;
+        for (int i = 0; i < TempStaticDir::kMissPages; ++i) pages.push_back("/pages/p" + std::to_string(i));
+        scenarios.push_back(staticScenario("static_miss", std::move(pages)));
+
+        scenarios.push_back({ "not_found_page",
+            [](WorkerState& state) { return makeRequest(http::verb::get, "/no/such/page/" + std::to_string(state.iteration % 64)); },
+            [](WorkerState&, const Response& res) { return isStatus(res, http::status::not_found); } });
+        scenarios.push_back({ "not_found_api",
+            [](WorkerState&) { return makeRequest(http::verb::get, "/api/no-such-endpoint"); },
+            [](WorkerState&, const Response& res) { return isStatus(res, http::status::not_found); } });
+        return scenarios;
+    }
+
+    Scenario allDataScenario(size_t size) {
+        return { "api_all_data_" + std::to_string(size),
+            [](WorkerState&) { return makeRequest(http::verb::get, "/api/all-data"); },
+            [](WorkerState&, const Response& res) { return isStatus(res, http::status::ok); } };
+    }
+
+    // Смесь записи: правка клиента, создание кампании, удаление ранее созданной этим же соединением.
+    // read_percent — доля GET /api/all-data в потоке
+    Scenario crudScenario(std::string name, const Dataset& dataset, int read_percent) {
+        return { std::move(name),
+            [&dataset, read_percent](WorkerState& state) {
+                int roll = std::uniform_int_distribution<int>(0, 99)(state.rng);
+                if (roll < read_percent) {
+                    return makeRequest(http::verb::get, "/api/all-data");
+                }
+                roll = std::uniform_int_distribution<int>(0, 99)(state.rng);
+                if (roll < 40) {
+                    static const char* statuses[] = { "active", "prospect", "archived" };
+                    return makeRequest(http::verb::put, "/api/clients/" + std::to_string(dataset.randomClient(state.rng)),
+                        std::string(R"({"status":")") + statuses[state.iteration % 3] + R"("})");
+                }
+                if (roll < 70 || state.created_campaigns.empty()) {
+                    return makeRequest(http::verb::post, "/api/campaigns",
+                        R"({"clientId":)" + std::to_string(dataset.randomClient(state.rng)) + R"(,"name":"Mix campaign","budget":500.25})");
+                }
+                int id = state.created_campaigns.back();
+                state.created_campaigns.pop_back();
+                return makeRequest(http::verb::delete_, "/api/campaigns/" + std::to_string(id));
+            },
+            [](WorkerState& state, const Response& res) {
+                if (res.result() == http::status::created) {
+                    if (auto id = extractId(res.body())) state.created_campaigns.push_back(*id);
+                    return true;
+                }
+                return res.result() == http::status::ok;
+            } };
+    }
+
+}
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    std::cerr << "bench_http_load: starting the server is implemented for POSIX only" << std::endl;
+    return EXIT_FAILURE;
+#else
+    Options options = parseOptions(argc, argv);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    TempStaticDir static_dir;
+    ServerProcess server(options, static_dir.path());
+    if (!waitUntilReady(options.port, std::chrono::seconds(15)) || !server.alive()) {
+        std::cerr << "Server did not become ready, see " << server.logPath() << std::endl;
+        std::ifstream log(server.logPath());
+        std::cerr << log.rdbuf() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    printHeader(options);
+    for (const auto& scenario : staticScenarios()) {
+        if (selected(options, scenario.name)) printResult(runScenario(options, scenario));
+    }
+
+    Dataset dataset(options);
+    if (options.database.empty() || !dataset.available()) {
+        std::printf("\nAPI scenarios skipped: %s\n",
+            options.database.empty() ? "no --database given" : "database is not available (GET /api/all-data != 200)");
+        return EXIT_SUCCESS;
+    }
+
+    for (int size : options.sizes) {
+        std::string name = "api_all_data_" + std::to_string(size);
+        if (!selected(options, name)) continue;
+        if (!dataset.growTo(static_cast<size_t>(size))) {
+            std::fprintf(stderr, "Seeding %d clients failed\n", size);
+            return EXIT_FAILURE;
+        }
+        printResult(runScenario(options, allDataScenario(static_cast<size_t>(size))));
+    }
+
+    // Смеси идут на наборе, оставшемся после сценариев all-data (наибольший размер)
+    if (!dataset.clients().empty()) {
+        for (auto& scenario : { crudScenario("api_crud_write", dataset, 0), crudScenario("api_crud_read80", dataset, 80) }) {
+            if (selected(options, scenario.name)) printResult(runScenario(options, scenario));
+        }
+    }
+    return EXIT_SUCCESS;
+#endif
+}
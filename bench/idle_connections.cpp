@@ -0,0 +1,341 @@
+﻿// Стенд простаивающих соединений: память сервера и лимиты при тысячах keep-alive и slow-loris клиентов.
+// Поднимает сервер с короткими таймаутами, открывает соединения ступенями и снимает VmRSS сервера.
+//
+//   bench_idle_connections --server ./KursachMari-Tigrex-ServerBase [--steps 1000,2000,4000]
+//                          [--idle-timeout 3] [--read-timeout 3] [--per-ip 256]
+//
+// Этапы:
+//   keepalive_N  — N соединений, каждое сделало один запрос и молчит (ступени нарастающим итогом);
+//   idle_expired — через idle-timeout сервер должен закрыть их все, alive = 0;
+//   slowloris_N  — N соединений прислали половину заголовков и молчат;
+//   read_expired — через read-timeout сервер должен закрыть их все;
+//   over_cap     — сверх --max-connections (равен наибольшей ступени): alive не больше лимита;
+//   per_ip       — с одного адреса больше --per-ip соединений: alive = --per-ip.
+//
+// Соединения раскладываются по адресам 127.0.0.2..127.0.0.x (Linux маршрутизирует весь 127/8 на lo),
+// чтобы ступени не упирались в лимит на IP. RSS читается из /proc, стенд только для Linux.
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include "bench_static_dir.h"
+#include "bench_server_process.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+namespace {
+
+    namespace net = boost::asio;
+    using tcp = net::ip::tcp;
+
+    struct Options {
+        std::string server;
+        unsigned short port = 18481;
+        std::vector<size_t> steps{ 1000, 2000, 4000 };
+        int idle_timeout = 3;
+        int read_timeout = 3;
+        size_t per_ip = 256;
+    };
+
+    // Соединений на один исходный адрес в ступенях: заведомо ниже лимита на IP
+    constexpr size_t kConnectionsPerSource = 200;
+
+    [[noreturn]] void usage(const char* error) {
+        if (error) std::cerr << "Error: " << error << "\n\n";
+        std::cerr <<
+            "Usage: bench_idle_connections --server <path> [options]\n"
+            "  --server PATH       server executable\n"
+            "  --port N            port for the server under test (default 18481)\n"
+            "  --steps A,B,C       idle connection counts, cumulative (default 1000,2000,4000)\n"
+            "  --idle-timeout SEC  server --idle-timeout (default 3)\n"
+            "  --read-timeout SEC  server --read-timeout (default 3)\n"
+            "  --per-ip N          server --max-connections-per-ip (default 256)\n";
+        std::exit(error ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    Options parseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) usage(("missing value for " + arg).c_str());
+                return argv[++i];
+            };
+            if (arg == "--server") options.server = value();
+            else if (arg == "--port") options.port = static_cast<unsigned short>(std::stoi(value()));
+            else if (arg == "--idle-timeout") options.idle_timeout = std::max(1, std::stoi(value()));
+            else if (arg == "--read-timeout") options.read_timeout = std::max(1, std::stoi(value()));
+            else if (arg == "--per-ip") options.per_ip = static_cast<size_t>(std::max(1, std::stoi(value())));
+            else if (arg == "--steps") {
+                options.steps.clear();
+                std::stringstream list(value());
+                for (std::string item; std::getline(list, item, ',');) {
+                    if (!item.empty()) options.steps.push_back(static_cast<size_t>(std::stoul(item)));
+                }
+                std::sort(options.steps.begin(), options.steps.end());
+            }
+            else if (arg == "--help" || arg == "-h") usage(nullptr);
+            else usage(("unknown option " + arg).c_str());
+        }
+        if (options.server.empty()) usage("--server is required");
+        if (options.steps.empty()) usage("--steps is empty");
+        return options;
+    }
+
+    // Соединений нужно больше, чем разрешает мягкий лимит дескрипторов по умолчанию.
+    // Сервер наследует поднятый лимит через fork
+    size_t raiseFileLimit() {
+        rlimit limit{};
+        if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) return 1024;
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+        ::getrlimit(RLIMIT_NOFILE, &limit);
+        return static_cast<size_t>(limit.rlim_cur);
+    }
+
+    size_t rssKiB(pid_t pid) {
+        std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+        for (std::string line; std::getline(status, line);) {
+            if (line.rfind("VmRSS:", 0) == 0) return static_cast<size_t>(std::stoul(line.substr(6)));
+        }
+        return 0;
+    }
+
+    class Client {
+    public:
+        explicit Client(unsigned short port) : server_(net::ip::make_address("127.0.0.1"), port) {}
+
+        // Открыть соединение с адреса 127.0.0.<source>
+        std::unique_ptr<tcp::socket> connect(unsigned source) {
+            auto socket = std::make_unique<tcp::socket>(ioc_);
+            boost::system::error_code ec;
+            socket->open(tcp::v4(), ec);
+            if (!ec) socket->bind({ net::ip::make_address_v4("127.0.0." + std::to_string(source)), 0 }, ec);
+            if (!ec) socket->connect(server_, ec);
+            if (ec) return nullptr;
+            return socket;
+        }
+
+        // Один полный запрос: соединение прошло цикл чтения/записи и ушло в простой keep-alive
+        static bool roundTrip(tcp::socket& socket) {
+            static const std::string request = "GET /status HTTP/1.1\r\nHost: bench\r\n\r\n";
+            boost::system::error_code ec;
+            net::write(socket, net::buffer(request), ec);
+            if (ec) return false;
+            // Ответ дочитывается целиком (по Content-Length): иначе остаток тела в сокете
+            // выглядел бы для alive() как закрытие
+            std::string response;
+            char chunk[1024];
+            size_t header_end = std::string::npos;
+            while ((header_end = response.find("\r\n\r\n")) == std::string::npos) {
+                size_t n = socket.read_some(net::buffer(chunk), ec);
+                if (ec) return false;
+                response.append(chunk, n);
+            }
+            size_t length = 0;
+            auto field = response.find("Content-Length: ");
+            if (field != std::string::npos && field < header_end) {
+                length = static_cast<size_t>(std::stoul(response.substr(field + 16)));
+            }
+            while (response.size() < header_end + 4 + length) {
+                size_t n = socket.read_some(net::buffer(chunk), ec);
+                if (ec) return false;
+                response.append(chunk, n);
+            }
+            return response.rfind("HTTP/1.1 200", 0) == 0;
+        }
+
+        // Начало запроса без конца заголовков — клиент slow-loris
+        static bool sendPartial(tcp::socket& socket) {
+            static const std::string partial = "GET /status HTTP/1.1\r\nHost: bench\r\nX-Slow: ";
+            boost::system::error_code ec;
+            net::write(socket, net::buffer(partial), ec);
+            return !ec;
+        }
+
+        // Соединение ещё открыто сервером: подглядывание без ожидания говорит "нет данных", а не EOF/RST.
+        // Напрямую через recv: неблокирующий read_some у Asio не отличает "нет данных" от пустого чтения
+        static bool alive(tcp::socket& socket) {
+            char byte;
+            ssize_t n = ::recv(socket.native_handle(), &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+
+    private:
+        net::io_context ioc_;
+        tcp::endpoint server_;
+    };
+
+    using Sockets = std::vector<std::unique_ptr<tcp::socket>>;
+
+    size_t countAlive(Sockets& sockets) {
+        return static_cast<size_t>(std::count_if(sockets.begin(), sockets.end(),
+            [](auto& socket) { return socket && Client::alive(*socket); }));
+    }
+
+    void closeAll(Sockets& sockets) {
+        for (auto& socket : sockets) {
+            boost::system::error_code ec;
+            if (socket) socket->close(ec);
+        }
+        sockets.clear();
+    }
+
+    unsigned sourceFor(size_t index) {
+        return static_cast<unsigned>(2 + index / kConnectionsPerSource);
+    }
+
+    // delta_kib — от RSS до первой ступени; bytes/conn — прирост RSS за этап на живое соединение
+    struct Report {
+        pid_t pid;
+        size_t baseline_kib = 0;
+
+        size_t rss() const { return rssKiB(pid); }
+
+        void header() const {
+            std::printf("%-16s %8s %8s %14s %12s %12s\n", "stage", "opened", "alive", "server_rss_kib", "delta_kib", "bytes/conn");
+        }
+
+        // stage_start_kib = 0 — этап не про память, bytes/conn не считается
+        void row(const std::string& stage, size_t opened, size_t alive, size_t stage_start_kib = 0) const {
+            size_t now = rss();
+            long long delta = static_cast<long long>(now) - static_cast<long long>(baseline_kib);
+            std::printf("%-16s %8zu %8zu %14zu %12lld", stage.c_str(), opened, alive, now, delta);
+            if (stage_start_kib > 0 && alive > 0) {
+                long long grown = static_cast<long long>(now) - static_cast<long long>(stage_start_kib);
+                std::printf(" %12lld\n", grown * 1024 / static_cast<long long>(alive));
+            }
+            else {
+                std::printf(" %12s\n", "-");
+            }
+            std::fflush(stdout);
+        }
+    };
+
+    void settle() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    }
+
+}
+#endif
+
+int main(int argc, char* argv[]) {
+#ifndef __linux__
+    std::cerr << "bench_idle_connections: Linux only (loopback source addresses, /proc RSS)" << std::endl;
+    return EXIT_FAILURE;
+#else
+    Options options = parseOptions(argc, argv);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    const size_t largest = options.steps.back();
+    const size_t fd_limit = raiseFileLimit();
+    // Клиент и сервер в одном лимите дескрипторов: по одному с каждой стороны плюс запас
+    if (largest * 2 + options.per_ip + 256 > fd_limit) {
+        std::fprintf(stderr, "RLIMIT_NOFILE %zu is too low for %zu connections\n", fd_limit, largest);
+        return EXIT_FAILURE;
+    }
+
+    BenchStaticDir static_dir(0);
+    BenchServerProcess server({
+        options.server,
+        "--address", "127.0.0.1",
+        "--port", std::to_string(options.port),
+        "--directory", static_dir.string(),
+        "--rate-limit", "1e9",
+        "--rate-burst", "1e9",
+        "--idle-timeout", std::to_string(options.idle_timeout),
+        "--read-timeout", std::to_string(options.read_timeout),
+        "--max-connections", std::to_string(largest),
+        "--max-connections-per-ip", std::to_string(options.per_ip),
+        }, static_dir.path().string() + ".log");
+
+    Client client(options.port);
+    bool ready = false;
+    for (int attempt = 0; attempt < 150 && !ready; ++attempt) {
+        if (auto socket = client.connect(2)) ready = Client::roundTrip(*socket);
+        if (!ready) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (!ready || !server.alive()) {
+        std::cerr << "Server did not become ready, see " << server.logPath() << std::endl;
+        std::ifstream log(server.logPath());
+        std::cerr << log.rdbuf() << std::endl;
+        return EXIT_FAILURE;
+    }
+    settle();
+
+    Report report{ server.pid() };
+    report.baseline_kib = rssKiB(server.pid());
+    std::printf("idle-timeout %ds, read-timeout %ds, max-connections %zu, per-ip %zu\n\n",
+        options.idle_timeout, options.read_timeout, largest, options.per_ip);
+    report.header();
+    report.row("baseline", 0, 0);
+
+    // Keep-alive после одного запроса
+    Sockets sockets;
+    for (size_t step : options.steps) {
+        while (sockets.size() < step) {
+            auto socket = client.connect(sourceFor(sockets.size()));
+            if (socket && !Client::roundTrip(*socket)) socket.reset();
+            sockets.push_back(std::move(socket));
+        }
+        settle();
+        report.row("keepalive_" + std::to_string(step), sockets.size(), countAlive(sockets), report.baseline_kib);
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(options.idle_timeout + 1));
+    report.row("idle_expired", sockets.size(), countAlive(sockets));
+    closeAll(sockets);
+
+    // Slow-loris: заголовки не дописываются. Память после keep-alive этапа уже выделена и переиспользуется,
+    // поэтому прирост считается от RSS перед этапом
+    const size_t before_slowloris = report.rss();
+    for (size_t i = 0; i < largest; ++i) {
+        auto socket = client.connect(sourceFor(i));
+        if (socket && !Client::sendPartial(*socket)) socket.reset();
+        sockets.push_back(std::move(socket));
+    }
+    settle();
+    report.row("slowloris_" + std::to_string(largest), sockets.size(), countAlive(sockets), before_slowloris);
+
+    std::this_thread::sleep_for(std::chrono::seconds(options.read_timeout + 1));
+    report.row("read_expired", sockets.size(), countAlive(sockets));
+    closeAll(sockets);
+    settle();
+
+    // Глобальный лимит: сверх него сервер закрывает соединение сразу после accept
+    const size_t over = largest + std::max<size_t>(largest / 10, 100);
+    for (size_t i = 0; i < over; ++i) {
+        sockets.push_back(client.connect(sourceFor(i)));
+    }
+    settle();
+    report.row("over_cap", sockets.size(), countAlive(sockets));
+    closeAll(sockets);
+    settle();
+
+    // Лимит на IP: всё с одного адреса
+    const unsigned single_source = 250;
+    for (size_t i = 0; i < options.per_ip + 50; ++i) {
+        sockets.push_back(client.connect(single_source));
+    }
+    settle();
+    report.row("per_ip", sockets.size(), countAlive(sockets));
+    closeAll(sockets);
+    return EXIT_SUCCESS;
+#endif
+}
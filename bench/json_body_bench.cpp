@@ -0,0 +1,60 @@
+﻿// Микробенчмарк разбора тела записи: прежний bj::parse с копиями полей в std::string против JsonBody
+#include "JsonBody.h"
+
+#include <benchmark/benchmark.h>
+
+#include <boost/json.hpp>
+
+#include <optional>
+#include <string>
+
+namespace {
+
+    // Типичное тело POST /api/tasks; description растягивается, чтобы увидеть цену копий
+    std::string makeTaskBody(std::size_t description_size) {
+        return R"({"campaignId":12,"assigneeId":3,"title":"Подготовить медиаплан",)"
+            R"("description":")" + std::string(description_size, 'x') + R"(",)"
+            R"("status":"in_progress","dueDate":"2026-11-01"})";
+    }
+
+}
+
+static void BM_TaskBody_Parse(benchmark::State& state) {
+    std::string text = makeTaskBody(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        boost::json::value jv = boost::json::parse(text);
+        const boost::json::object& body = jv.as_object();
+        int campaign_id = static_cast<int>(body.at("campaignId").as_int64());
+        std::string title = body.at("title").as_string().c_str();
+        std::optional<std::string> description = std::string(body.at("description").as_string().c_str());
+        std::string status = body.at("status").as_string().c_str();
+        std::optional<std::string> due_date = std::string(body.at("dueDate").as_string().c_str());
+        benchmark::DoNotOptimize(campaign_id);
+        benchmark::DoNotOptimize(title.data());
+        benchmark::DoNotOptimize(description->data());
+        benchmark::DoNotOptimize(status.data());
+        benchmark::DoNotOptimize(due_date->data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK(BM_TaskBody_Parse)->Arg(64)->Arg(1024)->Arg(16 * 1024);
+
+static void BM_TaskBody_JsonBody(benchmark::State& state) {
+    std::string text = makeTaskBody(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state) {
+        JsonBody body;
+        if (!body.parse(text)) state.SkipWithError("parse failed");
+        int campaign_id = static_cast<int>(body.integer("campaignId"));
+        pqxx::zview title = body.text("title");
+        std::optional<pqxx::zview> description = body.optionalText("description");
+        pqxx::zview status = body.textOr("status", "todo");
+        std::optional<pqxx::zview> due_date = body.optionalText("dueDate");
+        benchmark::DoNotOptimize(campaign_id);
+        benchmark::DoNotOptimize(title.data());
+        benchmark::DoNotOptimize(description->data());
+        benchmark::DoNotOptimize(status.data());
+        benchmark::DoNotOptimize(due_date->data());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+}
+BENCHMARK(BM_TaskBody_JsonBody)->Arg(64)->Arg(1024)->Arg(16 * 1024);
@@ -0,0 +1,64 @@
+﻿// Микробенчмарк разбора target в API: getQueryParam и parseIdFromPath
+#include "RequestParsing.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace {
+
+    // target с n параметрами, искомый — последний
+    std::string makeTarget(int params) {
+        std::string target = "/api/all-data?";
+        for (int i = 0; i < params - 1; ++i) {
+            target += "p" + std::to_string(i) + "=value" + std::to_string(i) + "&";
+        }
+        return target + "include=dashboard";
+    }
+
+}
+
+static void BM_GetQueryParam_Found(benchmark::State& state) {
+    std::string target = makeTarget(static_cast<int>(state.range(0)));
+    std::string name = "include";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(RequestParsing::getQueryParam(target, name));
+    }
+}
+BENCHMARK(BM_GetQueryParam_Found)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_GetQueryParam_Missing(benchmark::State& state) {
+    std::string target = makeTarget(static_cast<int>(state.range(0)));
+    std::string name = "dryRun";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(RequestParsing::getQueryParam(target, name));
+    }
+}
+BENCHMARK(BM_GetQueryParam_Missing)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_GetQueryParam_NoQuery(benchmark::State& state) {
+    std::string target = "/api/clients/42";
+    std::string name = "include";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(RequestParsing::getQueryParam(target, name));
+    }
+}
+BENCHMARK(BM_GetQueryParam_NoQuery);
+
+static void BM_ParseIdFromPath(benchmark::State& state) {
+    std::string path = "/api/campaigns/123456";
+    std::string prefix = "/api/campaigns/";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(RequestParsing::parseIdFromPath(path, prefix));
+    }
+}
+BENCHMARK(BM_ParseIdFromPath);
+
+static void BM_ParseIdFromPath_NoId(benchmark::State& state) {
+    std::string path = "/api/campaigns/";
+    std::string prefix = "/api/campaigns/";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(RequestParsing::parseIdFromPath(path, prefix));
+    }
+}
+BENCHMARK(BM_ParseIdFromPath_NoId);
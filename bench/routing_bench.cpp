@@ -0,0 +1,134 @@
+﻿// Микробенчмарк RequestHandler::handleRequest: точное совпадение, проверка wildcard /* через FileCache,
+// цикл по regex-маршрутам и оба вида 404. Маршруты повторяют набор из Handlers.h
+#include "RequestHandler.h"
+#include "bench_static_dir.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+
+namespace {
+
+    using Request = RequestHandler::Request;
+    using Response = RequestHandler::Response;
+
+    // Вместо сокета: ответ только "потребляется"
+    struct NullSend {
+        void operator()(Response&& res) const {
+            benchmark::DoNotOptimize(res.body().data());
+        }
+    };
+
+    void noop(const Request&, Response& res) {
+        res.result(http::status::ok);
+    }
+
+    class Router {
+    public:
+        explicit Router(bool with_wildcard)
+            : cache_(static_dir_.string(), true, 100) {
+            cache_.initialize();
+            handler_.addRouteHandler("/api/all-data", noop);
+            handler_.addRouteHandler("/api/clients", noop);
+            handler_.addDynamicRouteHandler("/api/clients/\\d+(?:/)?", noop);
+            handler_.addRouteHandler("/api/campaigns", noop);
+            handler_.addDynamicRouteHandler("/api/campaigns/\\d+(?:/)?", noop);
+            handler_.addRouteHandler("/api/tasks", noop);
+            handler_.addDynamicRouteHandler("/api/tasks/\\d+(?:/)?", noop);
+            handler_.addRouteHandler("/api/team", noop);
+            handler_.addDynamicRouteHandler("/api/team/\\d+(?:/)?", noop);
+            handler_.addRouteHandler("/test", noop);
+            if (with_wildcard) {
+                handler_.addRouteHandler("/*", [](const Request&, Response&) {});
+            }
+            handler_.initialize();
+            handler_.setFileCache(&cache_);
+        }
+
+        void dispatch(const Request& prototype) {
+            Request req = prototype;
+            handler_.handleRequest(std::move(req), NullSend{});
+        }
+
+    private:
+        BenchStaticDir static_dir_;
+        FileCache cache_;
+        RequestHandler handler_;
+    };
+
+    Router& router(bool with_wildcard) {
+        static Router with(true);
+        static Router without(false);
+        return with_wildcard ? with : without;
+    }
+
+    Request makeRequest(const std::string& target) {
+        Request req{ http::verb::get, target, 11 };
+        req.set(http::field::host, "localhost");
+        req.keep_alive(true);
+        return req;
+    }
+
+    void runDispatch(benchmark::State& state, const std::string& target, bool with_wildcard) {
+        auto& r = router(with_wildcard);
+        Request prototype = makeRequest(target);
+        for (auto _ : state) {
+            r.dispatch(prototype);
+        }
+    }
+
+}
+
+// Копия запроса входит во все замеры ниже — это её собственная цена
+static void BM_Dispatch_RequestCopy(benchmark::State& state) {
+    Request prototype = makeRequest("/api/tasks/42");
+    for (auto _ : state) {
+        Request req = prototype;
+        benchmark::DoNotOptimize(req);
+    }
+}
+BENCHMARK(BM_Dispatch_RequestCopy);
+
+static void BM_Dispatch_Exact(benchmark::State& state) {
+    runDispatch(state, "/status", true);
+}
+BENCHMARK(BM_Dispatch_Exact);
+
+// Тот же маршрут без /*: показывает цену проверки FileCache перед картой маршрутов
+static void BM_Dispatch_Exact_NoWildcard(benchmark::State& state) {
+    runDispatch(state, "/status", false);
+}
+BENCHMARK(BM_Dispatch_Exact_NoWildcard);
+
+static void BM_Dispatch_StaticSmall(benchmark::State& state) {
+    runDispatch(state, "/small", true);
+}
+BENCHMARK(BM_Dispatch_StaticSmall);
+
+static void BM_Dispatch_StaticLarge(benchmark::State& state) {
+    runDispatch(state, "/large", true);
+}
+BENCHMARK(BM_Dispatch_StaticLarge);
+
+// Первый и последний regex-маршрут
+static void BM_Dispatch_RegexFirst(benchmark::State& state) {
+    runDispatch(state, "/api/clients/42", true);
+}
+BENCHMARK(BM_Dispatch_RegexFirst);
+
+static void BM_Dispatch_RegexLast(benchmark::State& state) {
+    runDispatch(state, "/api/team/42", true);
+}
+BENCHMARK(BM_Dispatch_RegexLast);
+
+// 404: полный проход по regex и ответ-заглушка
+static void BM_Dispatch_NotFoundApi(benchmark::State& state) {
+    runDispatch(state, "/api/unknown/endpoint", true);
+}
+BENCHMARK(BM_Dispatch_NotFoundApi);
+
+static void BM_Dispatch_NotFoundPage(benchmark::State& state) {
+    runDispatch(state, "/no/such/page", true);
+}
+BENCHMARK(BM_Dispatch_NotFoundPage);
@@ -0,0 +1,181 @@
+﻿// Микробенчмарк конвертеров строк в JSON (ApiConverters) на синтетических данных.
+// FakeResult повторяет то, что делает pqxx: значения хранятся текстом, row["name"] ищет
+// номер столбца по имени при каждом обращении, as<T>() разбирает текст.
+// BM_*ToJson — поиск по имени в каждой строке и bj::object,
+// BM_*Writer — RowWriter с номерами столбцов: сразу JSON-текст, без bj::object (сравнивать с serialize:1)
+#include "ApiConverters.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+    class FakeField {
+    public:
+        explicit FakeField(const std::optional<std::string>* value) : value_(value) {}
+
+        bool is_null() const { return !value_->has_value(); }
+        const char* c_str() const { return value_->has_value() ? (*value_)->c_str() : ""; }
+        size_t size() const { return value_->has_value() ? (*value_)->size() : 0; }
+
+        template<class T>
+        T as() const {
+            if constexpr (std::is_same_v<T, int>) {
+                return static_cast<int>(std::strtol(c_str(), nullptr, 10));
+            }
+            else {
+                return static_cast<T>(std::strtod(c_str(), nullptr));
+            }
+        }
+
+    private:
+        const std::optional<std::string>* value_;
+    };
+
+    class FakeResult;
+
+    class FakeRow {
+    public:
+        FakeRow(const FakeResult* result, size_t index) : result_(result), index_(index) {}
+        FakeField operator[](const char* column) const;
+        FakeField operator[](int column) const;
+
+    private:
+        const FakeResult* result_;
+        size_t index_;
+    };
+
+    class FakeResult {
+    public:
+        explicit FakeResult(std::vector<std::string> columns) : columns_(std::move(columns)) {}
+
+        void addRow(std::vector<std::optional<std::string>> values) { rows_.push_back(std::move(values)); }
+
+        size_t size() const { return rows_.size(); }
+        FakeRow operator[](size_t index) const { return FakeRow(this, index); }
+
+        // Как pqxx::result::column_number: линейный поиск по именам
+        size_t column_number(const char* name) const {
+            for (size_t i = 0; i < columns_.size(); ++i) {
+                if (std::strcmp(columns_[i].c_str(), name) == 0) return i;
+            }
+            std::abort();
+        }
+
+        const std::optional<std::string>* value(size_t row, size_t column) const { return &rows_[row][column]; }
+
+    private:
+        std::vector<std::string> columns_;
+        std::vector<std::vector<std::optional<std::string>>> rows_;
+    };
+
+    FakeField FakeRow::operator[](const char* column) const {
+        return FakeField(result_->value(index_, result_->column_number(column)));
+    }
+
+    FakeField FakeRow::operator[](int column) const {
+        return FakeField(result_->value(index_, static_cast<size_t>(column)));
+    }
+
+    // Столбцы в порядке SELECT * по схеме из DatabaseModule
+    FakeResult makeClients(size_t count) {
+        FakeResult result({ "id", "name", "contact", "status", "total_budget", "campaigns_count", "created_at", "updated_at" });
+        for (size_t i = 0; i < count; ++i) {
+            result.addRow({ std::to_string(i + 1), "Client " + std::to_string(i), i % 3 ? std::optional<std::string>("client@example.com") : std::nullopt,
+                "active", "125000.50", std::to_string(i % 7), "2025-01-10 12:00:00", "2025-01-10 12:00:00" });
+        }
+        return result;
+    }
+
+    FakeResult makeCampaigns(size_t count) {
+        FakeResult result({ "id", "client_id", "name", "status", "budget", "spent", "start_date", "end_date", "roi", "created_at", "updated_at" });
+        for (size_t i = 0; i < count; ++i) {
+            bool completed = i % 4 == 0;
+            result.addRow({ std::to_string(i + 1), std::to_string(i / 3 + 1), "Campaign " + std::to_string(i), completed ? "completed" : "running",
+                "15000.00", "7250.25", "2025-02-01", completed ? std::optional<std::string>("2025-03-01") : std::nullopt,
+                completed ? std::optional<std::string>("12.50") : std::nullopt, "2025-01-10 12:00:00", "2025-01-10 12:00:00" });
+        }
+        return result;
+    }
+
+    FakeResult makeTasks(size_t count) {
+        FakeResult result({ "id", "campaign_id", "assignee_id", "title", "description", "status", "due_date", "created_at", "updated_at" });
+        for (size_t i = 0; i < count; ++i) {
+            result.addRow({ std::to_string(i + 1), std::to_string(i / 2 + 1), i % 2 ? std::optional<std::string>("3") : std::nullopt,
+                "Task " + std::to_string(i), i % 5 ? std::optional<std::string>("Prepare creatives for the \"spring\" launch") : std::nullopt,
+                "in_progress", "2025-04-15", "2025-01-10 12:00:00", "2025-01-10 12:00:00" });
+        }
+        return result;
+    }
+
+    template<class Convert>
+    void runConvert(benchmark::State& state, const FakeResult& rows, Convert convert, bool serialize) {
+        for (auto _ : state) {
+            bj::array arr;
+            arr.reserve(rows.size());
+            for (size_t i = 0; i < rows.size(); ++i) {
+                arr.emplace_back(convert(rows[i]));
+            }
+            if (serialize) {
+                benchmark::DoNotOptimize(bj::serialize(arr));
+            }
+            else {
+                benchmark::DoNotOptimize(arr.data());
+            }
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * rows.size()));
+    }
+
+    template<class Writer>
+    void runWrite(benchmark::State& state, const FakeResult& rows) {
+        Writer writer(rows);
+        for (auto _ : state) {
+            std::string body;
+            body.reserve(writer.estimate(rows));
+            JsonWriter out(body);
+            ApiConverters::writeArray(out, writer, rows);
+            benchmark::DoNotOptimize(body.data());
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * rows.size()));
+    }
+
+}
+
+static void BM_ClientToJson(benchmark::State& state) {
+    auto rows = makeClients(static_cast<size_t>(state.range(0)));
+    runConvert(state, rows, [](const FakeRow& row) { return ApiConverters::clientToJson(row); }, state.range(1) != 0);
+}
+BENCHMARK(BM_ClientToJson)->ArgsProduct({ { 100, 1000 }, { 0, 1 } })->ArgNames({ "rows", "serialize" });
+
+static void BM_CampaignToJson(benchmark::State& state) {
+    auto rows = makeCampaigns(static_cast<size_t>(state.range(0)));
+    runConvert(state, rows, [](const FakeRow& row) { return ApiConverters::campaignToJson(row); }, state.range(1) != 0);
+}
+BENCHMARK(BM_CampaignToJson)->ArgsProduct({ { 100, 1000 }, { 0, 1 } })->ArgNames({ "rows", "serialize" });
+
+static void BM_TaskToJson(benchmark::State& state) {
+    auto rows = makeTasks(static_cast<size_t>(state.range(0)));
+    runConvert(state, rows, [](const FakeRow& row) { return ApiConverters::taskToJson(row); }, state.range(1) != 0);
+}
+BENCHMARK(BM_TaskToJson)->ArgsProduct({ { 100, 1000 }, { 0, 1 } })->ArgNames({ "rows", "serialize" });
+
+static void BM_ClientWriter(benchmark::State& state) {
+    runWrite<ApiConverters::ClientWriter>(state, makeClients(static_cast<size_t>(state.range(0))));
+}
+BENCHMARK(BM_ClientWriter)->Arg(100)->Arg(1000)->ArgName("rows");
+
+static void BM_CampaignWriter(benchmark::State& state) {
+    runWrite<ApiConverters::CampaignWriter>(state, makeCampaigns(static_cast<size_t>(state.range(0))));
+}
+BENCHMARK(BM_CampaignWriter)->Arg(100)->Arg(1000)->ArgName("rows");
+
+static void BM_TaskWriter(benchmark::State& state) {
+    runWrite<ApiConverters::TaskWriter>(state, makeTasks(static_cast<size_t>(state.range(0))));
+}
+BENCHMARK(BM_TaskWriter)->Arg(100)->Arg(1000)->ArgName("rows");
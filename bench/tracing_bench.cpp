@@ -0,0 +1,88 @@
+﻿// Микробенчмарк трассировки: цена спанов при выключенном сэмплировании и запись в кольцевой буфер
+#include "TracingModule.h"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+    // Модуль с буфером; частота задаётся в самом бенчмарке
+    TracingModule& tracing() {
+        static TracingModule module(TracingModule::Settings{ 0, 16384 });
+        static bool initialized = module.initialize();
+        (void)initialized;
+        return module;
+    }
+
+    // Форма запроса /api/all-data: корневой контекст, db-задача и 14 вложенных спанов
+    void simulateRequest() {
+        TraceContext context = TracingModule::startTrace();
+        TraceContextScope scope(context);
+        TraceSpan db("db");
+        for (int i = 0; i < 14; ++i) {
+            TraceSpan span("sql.clients");
+            benchmark::ClobberMemory();
+        }
+    }
+
+}
+
+static void BM_StartTrace_Off(benchmark::State& state) {
+    tracing();
+    TracingModule::setSampleEvery(0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(TracingModule::startTrace());
+    }
+}
+BENCHMARK(BM_StartTrace_Off);
+
+static void BM_Span_Unsampled(benchmark::State& state) {
+    tracing();
+    TracingModule::setSampleEvery(0);
+    for (auto _ : state) {
+        TraceSpan span("sql.clients");
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_Span_Unsampled);
+
+static void BM_Span_Sampled(benchmark::State& state) {
+    tracing();
+    TraceContextScope scope(TraceContext{ 1 });
+    for (auto _ : state) {
+        TraceSpan span("sql.clients");
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_Span_Sampled);
+
+// Аргумент — sample_every: 0 (выключено), 1 (каждый запрос), 100
+static void BM_Request(benchmark::State& state) {
+    tracing();
+    TracingModule::setSampleEvery(static_cast<uint32_t>(state.range(0)));
+    for (auto _ : state) {
+        simulateRequest();
+    }
+    TracingModule::setSampleEvery(0);
+}
+BENCHMARK(BM_Request)->Arg(0)->Arg(1)->Arg(100);
+
+static void BM_Request_Sampled_Threaded(benchmark::State& state) {
+    tracing();
+    if (state.thread_index() == 0) TracingModule::setSampleEvery(1);
+    for (auto _ : state) {
+        simulateRequest();
+    }
+    if (state.thread_index() == 0) TracingModule::setSampleEvery(0);
+}
+BENCHMARK(BM_Request_Sampled_Threaded)->Threads(1)->Threads(4);
+
+static void BM_RenderChromeTrace(benchmark::State& state) {
+    auto& module = tracing();
+    TracingModule::setSampleEvery(1);
+    for (int i = 0; i < 2000; ++i) simulateRequest();
+    TracingModule::setSampleEvery(0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(module.renderChromeTrace());
+    }
+}
+BENCHMARK(BM_RenderChromeTrace);
@@ -20,11 +20,18 @@ class DataCache {
             team: [],             // {id, fullname, role, workload}
             lastUpdated: null
         };
+        // Версия данных из последнего ответа на запись (?include=version), для сверки с /api/version
+        this.dataVersion = null;
 
         this.apiBaseUrl = options.apiBaseUrl || '/api';
         this.enablePersistence = typeof options.enablePersistence === 'boolean' ? options.enablePersistence : true;
 
+        // Живые обновления: пока поток событий открыт, кэш не устаревает и после записи не перечитывается
+        this.live = false;
+        this._events = null;
+
         this._loadFromStorage();
+        if (options.liveUpdates !== false) this._connectEvents();
     }
 
     // --- Persistence & helpers ---
@@ -58,6 +65,7 @@ class DataCache {
 
     _isCacheExpired() {
         if (!this.cache.lastUpdated) return true;
+        if (this.live) return false; // Изменения приходят с сервера сами
         const diffInMinutes = (Date.now() - new Date(this.cache.lastUpdated)) / (1000 * 60);
         return diffInMinutes > 5; // 5 минут TTL
     }
@@ -105,6 +113,98 @@ class DataCache {
         }
     }
 
+    // --- Живые обновления (SSE /api/events) ---
+    _connectEvents() {
+        if (typeof EventSource === 'undefined') return;
+        const source = new EventSource(`${this.apiBaseUrl}/events`);
+        source.addEventListener('open', () => {
+            // Пока потока не было, изменения могли пройти мимо — один полный снимок при (пере)подключении
+            this.live = true;
+            this.fetchAllData(true);
+        });
+        // EventSource переподключается сам; до этого работаем по старой схеме (TTL и перечитывание после записи)
+        source.addEventListener('error', () => { this.live = false; });
+        source.addEventListener('change', (e) => {
+            try {
+                this._applyChange(JSON.parse(e.data));
+            } catch (err) {
+                console.warn('Bad change event:', err);
+            }
+        });
+        // Сервер потерял связь с БД и не знает, что пропустил
+        source.addEventListener('resync', () => this.fetchAllData(true));
+        this._events = source;
+    }
+
+    // {table, op: insert|update|delete, id, row} — row в том же виде, что в /api/all-data
+    _applyChange(change) {
+        const key = DataCache.TABLES[change.table];
+        if (!key) return;
+        const list = this.cache[key];
+        const idx = list.findIndex(item => item.id === change.id);
+        if (change.op === 'delete') {
+            if (idx !== -1) list.splice(idx, 1);
+        } else if (change.row) {
+            if (idx !== -1) list[idx] = change.row;
+            else list.push(change.row);
+        }
+        this.recalculateWorkload();
+        this._markUpdated();
+    }
+
+    // Ответ сервера на создание: временная запись получает настоящий id.
+    // Событие об этой же строке может прийти раньше ответа — тогда временная запись просто убирается
+    _replaceTempItem(list, tempId, serverResp) {
+        if (!serverResp || !serverResp.id) return;
+        const idx = list.findIndex(item => item.id === tempId);
+        if (idx === -1) return;
+        if (list.some(item => item.id === serverResp.id)) list.splice(idx, 1);
+        else list[idx] = { ...list[idx], ...serverResp };
+    }
+
+    // Запись просит у сервера всё, что иначе пришлось бы перечитывать через /api/all-data
+    _withIncludes(path) {
+        return `${path}?include=${DataCache.MUTATION_INCLUDES}`;
+    }
+
+    _upsertItem(list, row) {
+        const idx = list.findIndex(item => item.id === row.id);
+        if (idx !== -1) list[idx] = { ...list[idx], ...row };
+        else list.push(row);
+    }
+
+    // Ответ {data, dashboard, cascade: {deleted, updated}, version}. false — ответа нет (оффлайн, старый сервер),
+    // тогда остаётся прежний путь с перечитыванием
+    _applyMutation(key, resp, tempId) {
+        if (!resp || resp.data === undefined) return false;
+        const list = this.cache[key];
+        if (tempId !== undefined) this._replaceTempItem(list, tempId, resp.data);
+        else if (resp.data.deletedId !== undefined) {
+            const idx = list.findIndex(item => item.id === resp.data.deletedId);
+            if (idx !== -1) list.splice(idx, 1);
+        } else this._upsertItem(list, resp.data);
+
+        const cascade = resp.cascade || {};
+        for (const [table, ids] of Object.entries(cascade.deleted || {})) {
+            const cascadeKey = DataCache.TABLES[table];
+            if (cascadeKey) this.cache[cascadeKey] = this.cache[cascadeKey].filter(item => !ids.includes(item.id));
+        }
+        for (const [table, rows] of Object.entries(cascade.updated || {})) {
+            const cascadeKey = DataCache.TABLES[table];
+            if (cascadeKey) rows.forEach(row => this._upsertItem(this.cache[cascadeKey], row));
+        }
+
+        this.recalculateWorkload();
+        if (resp.dashboard) this.cache.dashboard = { ...resp.dashboard };
+        if (resp.version !== undefined) this.dataVersion = resp.version;
+        this._markUpdated();
+        return true;
+    }
+
+    async _refreshAfterWrite() {
+        if (!this.live) await this.fetchAllData(true);
+    }
+
     // --- Вычисление дашборда и связанных метрик ---
     _computeDashboard() {
         const activeClients = this.cache.clients.filter(c => c.status === 'active').length;
@@ -213,12 +313,8 @@ class DataCache {
         this._markUpdated();
 
         try {
-            const serverResp = await this._syncToServer('POST', '/clients', clientData);
-            if (serverResp && serverResp.id) {
-                const idx = this.cache.clients.findIndex(c => c.id === tempId);
-                if (idx !== -1) this.cache.clients[idx] = { ...this.cache.clients[idx], ...serverResp };
-            }
-            await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('POST', this._withIncludes('/clients'), clientData);
+            if (!this._applyMutation('clients', serverResp, tempId)) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
@@ -234,8 +330,8 @@ class DataCache {
         this._markUpdated();
 
         try {
-            await this._syncToServer('PUT', `/clients/${clientId}`, client);
-            await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('PUT', this._withIncludes(`/clients/${clientId}`), client);
+            if (!this._applyMutation('clients', serverResp)) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
@@ -246,24 +342,29 @@ class DataCache {
         const idx = this.cache.clients.findIndex(c => c.id === clientId);
         if (idx === -1) throw new Error('Client not found');
 
-        // Удаляем связанные кампании и задачи
-        const campaignsToDelete = this.cache.campaigns.filter(c => c.clientId === clientId);
-        for (const camp of campaignsToDelete) {
-            await this.deleteCampaign(camp.id, false); // false — не рекурсивно триггерить fetchAllData
-        }
+        // Связанные кампании и задачи сервер удаляет в той же транзакции (/cascade) — здесь только убираем их из кэша
+        const campaignIds = new Set(this.cache.campaigns.filter(c => c.clientId === clientId).map(c => c.id));
+        this.cache.campaigns = this.cache.campaigns.filter(c => !campaignIds.has(c.id));
+        this.cache.tasks = this.cache.tasks.filter(t => !campaignIds.has(t.campaignId));
 
         this.cache.clients.splice(idx, 1);
-        this._computeDashboard();
+        this.recalculateWorkload();
         this._markUpdated();
 
         try {
-            await this._syncToServer('DELETE', `/clients/${clientId}`);
-            await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('DELETE', this._withIncludes(`/clients/${clientId}/cascade`));
+            if (!this._applyMutation('clients', serverResp)) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
     }
 
+    // Что удалит deleteClient: {campaigns, tasks} по данным сервера. null — сервер недоступен
+    async previewClientDelete(clientId) {
+        const resp = await this._syncToServer('DELETE', `/clients/${clientId}/cascade?dryRun=true`);
+        return resp ? resp.counts : null;
+    }
+
     // --- CRUD: Campaigns ---
     async addCampaign(campaignData) {
         const tempId = Date.now();
@@ -290,12 +391,8 @@ class DataCache {
         this._markUpdated();
 
         try {
-            const serverResp = await this._syncToServer('POST', '/campaigns', campaignData);
-            if (serverResp && serverResp.id) {
-                const idx = this.cache.campaigns.findIndex(c => c.id === tempId);
-                if (idx !== -1) this.cache.campaigns[idx] = { ...this.cache.campaigns[idx], ...serverResp };
-            }
-            await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('POST', this._withIncludes('/campaigns'), campaignData);
+            if (!this._applyMutation('campaigns', serverResp, tempId)) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
@@ -329,8 +426,8 @@ class DataCache {
         this._markUpdated();
 
         try {
-            await this._syncToServer('PUT', `/campaigns/${campaignId}`, campaign);
-            await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('PUT', this._withIncludes(`/campaigns/${campaignId}`), campaign);
+            if (!this._applyMutation('campaigns', serverResp)) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
@@ -361,8 +458,8 @@ class DataCache {
         this._markUpdated();
 
         try {
-            await this._syncToServer('DELETE', `/campaigns/${campaignId}`);
-            if (refresh) await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('DELETE', this._withIncludes(`/campaigns/${campaignId}`));
+            if (!this._applyMutation('campaigns', serverResp) && refresh) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
@@ -379,12 +476,8 @@ class DataCache {
         this._markUpdated();
 
         try {
-            const serverResp = await this._syncToServer('POST', '/tasks', taskData);
-            if (serverResp && serverResp.id) {
-                const idx = this.cache.tasks.findIndex(t => t.id === tempId);
-                if (idx !== -1) this.cache.tasks[idx] = { ...this.cache.tasks[idx], ...serverResp };
-            }
-            await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('POST', this._withIncludes('/tasks'), taskData);
+            if (!this._applyMutation('tasks', serverResp, tempId)) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
@@ -401,8 +494,8 @@ class DataCache {
         this._markUpdated();
 
         try {
-            await this._syncToServer('PUT', `/tasks/${taskId}`, task);
-            await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('PUT', this._withIncludes(`/tasks/${taskId}`), task);
+            if (!this._applyMutation('tasks', serverResp)) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
@@ -419,8 +512,8 @@ class DataCache {
         this._markUpdated();
 
         try {
-            await this._syncToServer('DELETE', `/tasks/${taskId}`);
-            await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('DELETE', this._withIncludes(`/tasks/${taskId}`));
+            if (!this._applyMutation('tasks', serverResp)) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
@@ -436,12 +529,8 @@ class DataCache {
         this._markUpdated();
 
         try {
-            const serverResp = await this._syncToServer('POST', '/team', memberData);
-            if (serverResp && serverResp.id) {
-                const idx = this.cache.team.findIndex(m => m.id === tempId);
-                if (idx !== -1) this.cache.team[idx] = { ...this.cache.team[idx], ...serverResp };
-            }
-            await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('POST', this._withIncludes('/team'), memberData);
+            if (!this._applyMutation('team', serverResp, tempId)) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
@@ -457,8 +546,8 @@ class DataCache {
         this._markUpdated();
 
         try {
-            await this._syncToServer('PUT', `/team/${memberId}`, member);
-            await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('PUT', this._withIncludes(`/team/${memberId}`), member);
+            if (!this._applyMutation('team', serverResp)) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
@@ -478,8 +567,8 @@ class DataCache {
         this._markUpdated();
 
         try {
-            await this._syncToServer('DELETE', `/team/${memberId}`);
-            await this.fetchAllData(true);
+            const serverResp = await this._syncToServer('DELETE', this._withIncludes(`/team/${memberId}`));
+            if (!this._applyMutation('team', serverResp)) await this._refreshAfterWrite();
         } catch (error) {
             throw error;
         }
@@ -495,6 +584,10 @@ class DataCache {
     }
 }
 
+// Таблица БД -> список в кэше (имена таблиц приходят в событиях change)
+DataCache.TABLES = { clients: 'clients', campaigns: 'campaigns', tasks: 'tasks', team: 'team' };
+DataCache.MUTATION_INCLUDES = 'dashboard,cascade,version';
+
 // Глобальная инициализация
 if (!window.dataCache) {
     window.dataCache = new DataCache({ enablePersistence: true });
@@ -0,0 +1,111 @@
+#!/usr/bin/env bash
+# Двухэтапная PGO-сборка сервера с замером результата.
+#
+#   tools/pgo.sh [gcc|clang]
+#
+# 1. Базовая сборка linux-<cc>-lto (без профиля) и её замер bench_http_load.
+# 2. Инструментированная сборка linux-<cc>-pgo-generate; тренировочный прогон — те же HTTP-сценарии
+#    (статика, 404, а с PGO_DATABASE — /api/all-data и CRUD). Профиль пишется, когда сервер
+#    завершается по SIGTERM от стенда.
+# 3. Пересборка linux-<cc>-pgo-use с профилем и замер.
+# 4. Таблица сравнения req/s и p99 по сценариям: out/pgo/<cc>-compare.txt
+#
+# Переменные окружения:
+#   PGO_DATABASE          строка подключения к одноразовой PostgreSQL для API-сценариев (по умолчанию — без API)
+#   PGO_TRAIN_DURATION    секунд на сценарий в тренировочном прогоне (по умолчанию 5)
+#   PGO_MEASURE_DURATION  секунд на сценарий в замерах (по умолчанию 10)
+#   PGO_CONNECTIONS       число соединений стенда (по умолчанию 8)
+#   PGO_SIZES             размеры /api/all-data (по умолчанию 100,1000)
+set -euo pipefail
+
+COMPILER="${1:-gcc}"
+case "$COMPILER" in
+    gcc|clang) ;;
+    *) echo "usage: $0 [gcc|clang]" >&2; exit 2 ;;
+esac
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+SERVER_NAME="KursachMari-Tigrex-ServerBase"
+OUT_DIR="$ROOT/out/pgo"
+PROFILE_DIR="$OUT_DIR/$COMPILER"
+
+BASELINE_PRESET="linux-$COMPILER-lto"
+GENERATE_PRESET="linux-$COMPILER-pgo-generate"
+USE_PRESET="linux-$COMPILER-pgo-use"
+
+LOAD_ARGS=(--connections "${PGO_CONNECTIONS:-8}" --sizes "${PGO_SIZES:-100,1000}")
+DB_ARGS=()
+if [[ -n "${PGO_DATABASE:-}" ]]; then
+    DB_ARGS=(--database "$PGO_DATABASE")
+fi
+
+build_dir() {
+    # pgo-generate и pgo-use собираются в одном каталоге: GCC ищет профиль по путям объектных файлов
+    case "$1" in
+        *-pgo-*) echo "$ROOT/out/build/linux-$COMPILER-pgo" ;;
+        *) echo "$ROOT/out/build/$1" ;;
+    esac
+}
+
+build() {
+    local preset="$1"
+    echo "==> Building $preset"
+    cmake --preset "$preset" >/dev/null
+    cmake --build --preset "$preset" --target "$SERVER_NAME" bench_http_load
+}
+
+load() {
+    local preset="$1"; shift
+    local dir
+    dir="$(build_dir "$preset")"
+    "$dir/bench/bench_http_load" --server "$dir/$SERVER_NAME/$SERVER_NAME" \
+        "${LOAD_ARGS[@]}" ${DB_ARGS[@]+"${DB_ARGS[@]}"} "$@"
+}
+
+mkdir -p "$OUT_DIR"
+
+# 1. База: та же оптимизация (-O3 + LTO), но без профиля
+build "$BASELINE_PRESET"
+echo "==> Measuring baseline"
+load "$BASELINE_PRESET" --duration "${PGO_MEASURE_DURATION:-10}" --warmup 2 | tee "$OUT_DIR/$COMPILER-baseline.txt"
+
+# 2. Инструментированная сборка и тренировка на реальных HTTP-сценариях
+rm -rf "$PROFILE_DIR"
+mkdir -p "$PROFILE_DIR"
+build "$GENERATE_PRESET"
+echo "==> Training run"
+load "$GENERATE_PRESET" --duration "${PGO_TRAIN_DURATION:-5}" --warmup 1 > "$OUT_DIR/$COMPILER-training.txt"
+
+if [[ "$COMPILER" == "clang" ]]; then
+    shopt -s nullglob
+    raw=("$PROFILE_DIR"/*.profraw)
+    if (( ${#raw[@]} == 0 )); then
+        echo "No .profraw files in $PROFILE_DIR: the server did not exit cleanly" >&2
+        exit 1
+    fi
+    "${LLVM_PROFDATA:-llvm-profdata}" merge -output="$PROFILE_DIR/default.profdata" "${raw[@]}"
+elif [[ -z "$(find "$PROFILE_DIR" -name '*.gcda' -print -quit)" ]]; then
+    echo "No .gcda files in $PROFILE_DIR: the server did not exit cleanly" >&2
+    exit 1
+fi
+
+# 3. Сборка с профилем и замер
+build "$USE_PRESET"
+echo "==> Measuring PGO build"
+load "$USE_PRESET" --duration "${PGO_MEASURE_DURATION:-10}" --warmup 2 | tee "$OUT_DIR/$COMPILER-pgo.txt"
+
+# 4. Сравнение: строки результатов bench_http_load — 8 колонок, вторая числовая
+awk '
+    NF == 8 && $2 ~ /^[0-9]+$/ {
+        if (FILENAME == ARGV[1]) { base_rps[$1] = $4; base_p99[$1] = $6; order[++n] = $1 }
+        else { pgo_rps[$1] = $4; pgo_p99[$1] = $6 }
+    }
+    END {
+        printf "%-26s %12s %12s %8s %10s %10s\n", "scenario", "base req/s", "pgo req/s", "delta", "base p99", "pgo p99"
+        for (i = 1; i <= n; ++i) {
+            s = order[i]
+            if (!(s in pgo_rps)) continue
+            delta = base_rps[s] > 0 ? (pgo_rps[s] / base_rps[s] - 1) * 100 : 0
+            printf "%-26s %12.1f %12.1f %+7.1f%% %10.1f %10.1f\n", s, base_rps[s], pgo_rps[s], delta, base_p99[s], pgo_p99[s]
+        }
+    }' "$OUT_DIR/$COMPILER-baseline.txt" "$OUT_DIR/$COMPILER-pgo.txt" | tee "$OUT_DIR/$COMPILER-compare.txt"